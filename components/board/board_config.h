@@ -0,0 +1,198 @@
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "driver/gpio.h"
+#include "soc/adc_channel.h"
+#include "soc/soc_caps.h"
+#if SOC_TOUCH_SENSOR_SUPPORTED
+#include "soc/touch_sensor_channel.h"
+#endif
+
+// Wiring and zone tables of the controller board, the one place to edit when the
+// hardware changes. Everything below is checked at compile time, so a pin used twice,
+// an output on an input-only pad or a zone that cannot fit its period fails the build.
+
+// #define DEBUG
+
+// ===== PINS =====
+// One block per chip. Analog inputs are plain GPIO numbers, the ADC1 channel is looked
+// up from them. ADC2 is unusable with Wi-Fi. The tank electrodes are only wired on the
+// ESP32, the one chip with the touch sensor tank_touch.c drives.
+#if CONFIG_IDF_TARGET_ESP32
+// Outputs
+#define MOTOR_DRIVER_PIN         GPIO_NUM_14       // GPIO pin for motor driver control
+#define LIGHT_PIN                GPIO_NUM_2        // GPIO pin for built-in LED light
+#define SENSOR_POWER_PIN         GPIO_NUM_25       // Switches sensor supply so they draw nothing between epochs
+
+// Digital inputs
+#define BUTTON_PIN               GPIO_NUM_26       // Active low to GND, wakes deep sleep so must be an RTC pin
+#define FLOW_METER_PIN           GPIO_NUM_27       // Hall-effect flow sensor output, RTC pin for the ULP counter
+
+// Analog inputs, ADC1 is GPIO 32-39
+#define TANK_LEVEL_GPIO          34
+#define TEMP_NTC_GPIO            32                // NTC to ground with a fixed resistor to the sensor supply
+#define PRESSURE_GPIO            33                // 0.5-4.5 V transducer behind a divider
+#define BATTERY_GPIO             36                // 1:2 divider on the sensor supply side
+#define ZONE0_MOISTURE_GPIO      35
+
+// Bare electrodes read as touch pads at two heights, the band between them keeps the
+// level from flapping. Must be touch channels.
+#define TANK_LOW_TOUCH_GPIO      15                // At the reserve level
+#define TANK_HIGH_TOUCH_GPIO     13                // Top of the band, a refill has to cover it
+
+// E-paper
+#define EPAPER_MOSI_PIN          GPIO_NUM_23
+#define EPAPER_SCLK_PIN          GPIO_NUM_18
+#define EPAPER_CS_PIN            GPIO_NUM_5
+#define EPAPER_DC_PIN            GPIO_NUM_17
+#define EPAPER_RST_PIN           GPIO_NUM_16
+#define EPAPER_BUSY_PIN          GPIO_NUM_4
+
+// Pads that stay powered in deep sleep and can wake the chip
+#define BOARD_RTC_GPIO_MASK      0xFF0E00F015ULL   // 0, 2, 4, 12-15, 25-27, 32-39
+
+#elif CONFIG_IDF_TARGET_ESP32S3
+// Outputs, clear of the strapping pins 0, 3, 45 and 46
+#define MOTOR_DRIVER_PIN         GPIO_NUM_13
+#define LIGHT_PIN                GPIO_NUM_21
+#define SENSOR_POWER_PIN         GPIO_NUM_14
+
+// Digital inputs, RTC pins for the deep sleep wakeup and the ULP counter
+#define BUTTON_PIN               GPIO_NUM_11
+#define FLOW_METER_PIN           GPIO_NUM_12
+
+// Analog inputs, ADC1 is GPIO 1-10
+#define TANK_LEVEL_GPIO          1
+#define TEMP_NTC_GPIO            2
+#define PRESSURE_GPIO            4
+#define BATTERY_GPIO             5
+#define ZONE0_MOISTURE_GPIO      6
+
+// E-paper, clear of the octal PSRAM on GPIO 33-37
+#define EPAPER_MOSI_PIN          GPIO_NUM_15
+#define EPAPER_SCLK_PIN          GPIO_NUM_16
+#define EPAPER_CS_PIN            GPIO_NUM_17
+#define EPAPER_DC_PIN            GPIO_NUM_18
+#define EPAPER_RST_PIN           GPIO_NUM_39
+#define EPAPER_BUSY_PIN          GPIO_NUM_40
+
+#define BOARD_RTC_GPIO_MASK      0x3FFFFFULL       // 0-21
+
+#elif CONFIG_IDF_TARGET_ESP32C6
+// Outputs, clear of the USB pins 12-13, UART0 on 16-17 and the strapping pins 9 and 15
+#define MOTOR_DRIVER_PIN         GPIO_NUM_7
+#define LIGHT_PIN                GPIO_NUM_8        // RGB LED on the DevKitC-1, lit as plain white
+#define SENSOR_POWER_PIN         GPIO_NUM_10
+
+// Digital inputs, LP pins for the deep sleep wakeup
+#define BUTTON_PIN               GPIO_NUM_5
+#define FLOW_METER_PIN           GPIO_NUM_6
+
+// Analog inputs, ADC1 is GPIO 0-6
+#define TANK_LEVEL_GPIO          0
+#define TEMP_NTC_GPIO            1
+#define PRESSURE_GPIO            2
+#define BATTERY_GPIO             3
+#define ZONE0_MOISTURE_GPIO      4
+
+// E-paper
+#define EPAPER_MOSI_PIN          GPIO_NUM_18
+#define EPAPER_SCLK_PIN          GPIO_NUM_19
+#define EPAPER_CS_PIN            GPIO_NUM_20
+#define EPAPER_DC_PIN            GPIO_NUM_21
+#define EPAPER_RST_PIN           GPIO_NUM_22
+#define EPAPER_BUSY_PIN          GPIO_NUM_23
+
+#define BOARD_RTC_GPIO_MASK      0xFFULL           // 0-7
+
+#else
+// The ESP32-C3 is not supported: it has 13 GPIOs beside flash and the USB console for
+// the board's 16 signals
+#error "No pin table for this chip, see board_config.h"
+#endif
+
+// ===== ZONES =====
+#ifdef DEBUG
+#define WATERING_INTERVAL_MIN    6                 // Minutes between watering cycles
+#define WATERING_DURATION_MIN    1                 // Minutes to keep water flowing
+#else
+#define WATERING_INTERVAL_MIN    (8 * 60)
+#define WATERING_DURATION_MIN    10                // Minutes to keep water flowing
+#endif
+#define FROST_CIRCULATION_ZONE   0                 // Zone opened for anti-freeze circulation
+
+// One X(...) per zone, in zone order:
+//   X(period_min, duration_min, offset_min, moisture_gpio, target_pct, dry_pct, priority, min_ml, pulse_s, soak_s)
+// period_min      Start to start. The interval is counted from the end of a cycle, hence + duration.
+// target_pct      Moisture a full cycle brings the zone back to
+// dry_pct         At or below this the zone needs a full cycle
+// priority        Share of a short tank, higher wins
+// min_ml          Smaller doses are skipped as useless
+// pulse_s, soak_s Longest run before runoff starts and the rest between pulses, 0 = water in
+//                 one block. e.g. 3 * 60 with a 20 * 60 soak on clay.
+#define BOARD_ZONES(X) \
+    X(WATERING_INTERVAL_MIN + WATERING_DURATION_MIN, WATERING_DURATION_MIN, 0, ZONE0_MOISTURE_GPIO, 60, 20, 1, 1000, 0, 0)
+
+#define BOARD_ZONE_ONE(...)      + 1
+#define ZONE_COUNT               (0 BOARD_ZONES(BOARD_ZONE_ONE))
+
+// ===== DERIVED =====
+#define BOARD_ADC1_CHANNEL(gpio)  BOARD_ADC1_CHANNEL_(gpio)
+#define BOARD_ADC1_CHANNEL_(gpio) ADC1_GPIO##gpio##_CHANNEL    // Undefined, so a build error, off ADC1
+
+#define TANK_LEVEL_CHANNEL       BOARD_ADC1_CHANNEL(TANK_LEVEL_GPIO)
+#define TEMP_NTC_CHANNEL         BOARD_ADC1_CHANNEL(TEMP_NTC_GPIO)
+#define PRESSURE_CHANNEL         BOARD_ADC1_CHANNEL(PRESSURE_GPIO)
+#define BATTERY_CHANNEL          BOARD_ADC1_CHANNEL(BATTERY_GPIO)
+
+#if SOC_TOUCH_SENSOR_VERSION == 1
+#define BOARD_TOUCH_CHANNEL(gpio)  BOARD_TOUCH_CHANNEL_(gpio)
+#define BOARD_TOUCH_CHANNEL_(gpio) TOUCH_PAD_GPIO##gpio##_CHANNEL  // Undefined, so a build error, off touch
+
+#define TANK_LOW_TOUCH_PAD       BOARD_TOUCH_CHANNEL(TANK_LOW_TOUCH_GPIO)
+#define TANK_HIGH_TOUCH_PAD      BOARD_TOUCH_CHANNEL(TANK_HIGH_TOUCH_GPIO)
+#define BOARD_TOUCH_INPUTS(X)    X(TANK_LOW_TOUCH_GPIO) X(TANK_HIGH_TOUCH_GPIO)
+#else
+#define BOARD_TOUCH_INPUTS(X)
+#endif
+
+// ===== COMPILE-TIME CHECKS =====
+#define BOARD_BIT(pin)           (1ULL << (pin))
+#define BOARD_OUTPUTS(X) \
+    X(MOTOR_DRIVER_PIN) X(LIGHT_PIN) X(SENSOR_POWER_PIN) \
+    X(EPAPER_MOSI_PIN) X(EPAPER_SCLK_PIN) X(EPAPER_CS_PIN) X(EPAPER_DC_PIN) X(EPAPER_RST_PIN)
+#define BOARD_INPUTS(X) \
+    X(BUTTON_PIN) X(FLOW_METER_PIN) X(EPAPER_BUSY_PIN) \
+    X(TANK_LEVEL_GPIO) X(TEMP_NTC_GPIO) X(PRESSURE_GPIO) X(BATTERY_GPIO) \
+    BOARD_TOUCH_INPUTS(X)
+#define BOARD_PIN_SUM(pin)       + BOARD_BIT(pin)
+#define BOARD_PIN_OR(pin)        | BOARD_BIT(pin)
+#define BOARD_ZONE_PIN_SUM(period, duration, offset, gpio, ...) + BOARD_BIT(gpio)
+#define BOARD_ZONE_PIN_OR(period, duration, offset, gpio, ...)  | BOARD_BIT(gpio)
+
+#define BOARD_OUTPUT_MASK        (0 BOARD_OUTPUTS(BOARD_PIN_OR))
+#define BOARD_PIN_MASK           (BOARD_OUTPUT_MASK BOARD_INPUTS(BOARD_PIN_OR) BOARD_ZONES(BOARD_ZONE_PIN_OR))
+
+// A pin listed twice makes the sum carry, so it no longer matches the OR
+_Static_assert((0 BOARD_OUTPUTS(BOARD_PIN_SUM) BOARD_INPUTS(BOARD_PIN_SUM) BOARD_ZONES(BOARD_ZONE_PIN_SUM))
+               == BOARD_PIN_MASK, "Two board functions share a GPIO");
+_Static_assert((BOARD_PIN_MASK & ~(uint64_t)SOC_GPIO_VALID_GPIO_MASK) == 0, "GPIO does not exist on this chip");
+_Static_assert((BOARD_OUTPUT_MASK & ~(uint64_t)SOC_GPIO_VALID_OUTPUT_GPIO_MASK) == 0, "Output on an input-only GPIO");
+_Static_assert(BOARD_BIT(BUTTON_PIN) & BOARD_RTC_GPIO_MASK, "BUTTON_PIN is a wake source and must be an RTC GPIO");
+#if CONFIG_ULP_COPROC_TYPE_FSM
+_Static_assert(BOARD_BIT(FLOW_METER_PIN) & BOARD_RTC_GPIO_MASK, "FLOW_METER_PIN is counted by the ULP and must be an RTC GPIO");
+#endif
+
+_Static_assert(ZONE_COUNT > 0 && ZONE_COUNT <= 32, "Zones are tracked in 32-bit masks");
+_Static_assert(FROST_CIRCULATION_ZONE < ZONE_COUNT, "FROST_CIRCULATION_ZONE is not a zone");
+
+// Wall time of a cycle once pulse_s splits it and soak_s rests follow every pulse but the last
+#define BOARD_CYCLE_S(duration_min, pulse_s, soak_s) \
+    ((duration_min) * 60 + ((pulse_s) ? (soak_s) * (((duration_min) * 60 + (pulse_s) - 1) / ((pulse_s) ? (pulse_s) : 1) - 1) : 0))
+#define BOARD_ZONE_CHECK(period, duration, offset, gpio, target, dry, priority, min_ml, pulse_s, soak_s) \
+    _Static_assert((duration) > 0 && (duration) < (period), "Zone duration must be shorter than its period"); \
+    _Static_assert((offset) < (period), "Zone offset must be inside its period"); \
+    _Static_assert((dry) < (target) && (target) <= 100, "Zone needs dry_pct < target_pct <= 100"); \
+    _Static_assert(BOARD_CYCLE_S(duration, pulse_s, soak_s) < (period) * 60, "Zone pulses and soaks overrun its period");
+BOARD_ZONES(BOARD_ZONE_CHECK)
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Thin hardware layer under the irrigation logic: outputs, time and timers, sleep,
+// ADC and key/blob storage. hal_esp.c plus one chip file (hal_esp32.c, hal_esp32c6.c,
+// hal_esp32s3.c) implement it on the device, hal_host.c on the host.
+
+// ===== ERRORS =====
+// Same values as the esp_err_t codes, so device callers mix both freely
+typedef int hal_err_t;
+
+#define HAL_OK                   0
+#define HAL_FAIL                 -1
+#define HAL_ERR_NO_MEM           0x101
+#define HAL_ERR_INVALID_ARG      0x102
+#define HAL_ERR_INVALID_SIZE     0x104
+#define HAL_ERR_NOT_FOUND        0x105             // Storage key never written
+#define HAL_ERR_NOT_SUPPORTED    0x106             // Feature missing on this chip
+
+#define HAL_NEVER                INT64_MAX         // No timer wakeup
+
+// Chip family the backend was built for, e.g. "esp32c6" or "host"
+const char *hal_target_name(void);
+
+// ===== OUTPUTS =====
+// Push-pull outputs, driven low by init
+hal_err_t hal_output_init(uint64_t pin_mask);
+
+void hal_output_set(int pin, bool on);
+
+// Latch the current level so it survives light and deep sleep, or release it again
+hal_err_t hal_output_hold(int pin, bool hold);
+
+// ===== TIME AND TIMERS =====
+// Start the monotonic clock. Call first thing at boot, before anything reads the time.
+hal_err_t hal_time_init(void);
+
+// Monotonic microseconds. Keeps counting through deep sleep and every reset short of a
+// power cut, so deadlines kept in RTC memory stay valid. 64-bit, never wraps in practice.
+int64_t hal_time_us(void);
+
+typedef struct hal_timer *hal_timer_t;
+typedef void (*hal_timer_cb_t)(void *arg);
+
+// One-shot timer whose callback runs in task context
+hal_err_t hal_timer_create(hal_timer_cb_t cb, void *arg, const char *name, hal_timer_t *out);
+
+// Fire once at an absolute hal_time_us(), replacing any earlier deadline. Past deadlines fire at once.
+void hal_timer_start_at(hal_timer_t timer, int64_t at_us);
+
+void hal_timer_stop(hal_timer_t timer);
+
+// ===== SLEEP =====
+typedef enum {
+    HAL_RESET_POWER_ON = 0,    // Power-up or external reset, RTC memory is gone
+    HAL_RESET_DEEP_SLEEP,      // Woke from deep sleep, RTC memory kept
+    HAL_RESET_SOFTWARE,        // Restart requested by the firmware
+    HAL_RESET_FAULT,           // Panic, watchdog or brownout
+} hal_reset_t;
+
+typedef enum {
+    HAL_WAKE_TIMER = 0,
+    HAL_WAKE_GPIO,             // Any pin or pad source, e.g. the button
+    HAL_WAKE_OTHER,
+} hal_wake_t;
+
+hal_reset_t hal_reset_reason(void);
+
+// Light sleep until at_us or an enabled wake source, whichever comes first
+hal_wake_t hal_sleep_light_until(int64_t at_us);
+
+// Deep sleep until at_us (HAL_NEVER for none) or an enabled wake source. Held outputs keep their level.
+__attribute__((noreturn)) void hal_sleep_deep_until(int64_t at_us);
+
+// ===== ADC =====
+// ADC1 oneshot conversions at full-range attenuation, calibrated where the eFuses allow
+hal_err_t hal_adc_init(void);
+
+hal_err_t hal_adc_config(int channel);
+
+hal_err_t hal_adc_read(int channel, int *raw);
+
+// Calibrated millivolts at the pin, or a linear estimate on uncalibrated chips
+hal_err_t hal_adc_read_mv(int channel, int *mv);
+
+// ===== ADC MONITOR =====
+// Returns true if it woke a higher priority task, like an ISR callback
+typedef bool (*hal_adc_monitor_cb_t)(bool high, void *arg);
+
+// Convert channel continuously in hardware at a low rate and call cb once when a reading
+// drops below low_raw or rises above high_raw (-1 leaves that side open). cb may run in
+// an ISR. Conversions pause in light sleep and pick up again on wakeup. One channel at a
+// time, hal_adc_read keeps working alongside. HAL_ERR_NOT_SUPPORTED where the ADC has no
+// threshold monitor, e.g. the classic ESP32.
+hal_err_t hal_adc_monitor_start(int channel, int low_raw, int high_raw, hal_adc_monitor_cb_t cb, void *arg);
+
+void hal_adc_monitor_stop(void);
+
+// ===== STORAGE =====
+// Erases and reformats the partition if it is full or from a newer layout
+hal_err_t hal_storage_init(void);
+
+// len is the buffer size on entry and the stored size on return. HAL_ERR_NOT_FOUND if never written.
+hal_err_t hal_storage_read(const char *ns, const char *key, void *buf, size_t *len);
+
+// Written and committed before returning
+hal_err_t hal_storage_write(const char *ns, const char *key, const void *buf, size_t len);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_adc/adc_cali.h"
+
+// Chip-specific half of the ESP backend, implemented once per family by
+// hal_esp32.c, hal_esp32c6.c or hal_esp32s3.c
+
+// Pin voltage at full scale with 12 dB attenuation, for chips without calibration eFuses
+extern const int hal_backend_adc_full_scale_mv;
+
+// Calibration scheme for ADC1 at 12 dB. Fails if the eFuses were never burned.
+esp_err_t hal_backend_adc_cali(adc_cali_handle_t *out);
+
+// Arm the pad holds that keep held outputs latched while the digital domain is off
+void hal_backend_deep_sleep_hold(void);
@@ -0,0 +1,411 @@
+#include "board_hal.h"
+
+#include "driver/gpio.h"
+#include "esp_adc/adc_oneshot.h"
+#include "soc/soc_caps.h"
+#if SOC_ADC_MONITOR_SUPPORTED
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_monitor.h"
+#endif
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_rtc_time.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "hal_backend.h"
+
+#define TAG "HAL"
+#define ADC_ATTEN                ADC_ATTEN_DB_12
+#define ADC_MAX_RAW              4095
+#define CLOCK_MAGIC              0x4D4F4E4FU       // "MONO"
+
+typedef struct {
+    uint32_t magic;
+    int64_t  floor_us;         // Clock when last going to sleep or restarting
+} clock_floor_t;
+
+static RTC_NOINIT_ATTR clock_floor_t clock_floor;
+static int64_t clock_offset_us;                   // RTC time at boot minus esp_timer time
+static adc_oneshot_unit_handle_t adc;
+static adc_cali_handle_t adc_cali;                // NULL on uncalibrated chips
+
+static void monitor_pause(void);
+static void monitor_resume(void);
+
+// ===== OUTPUTS =====
+
+hal_err_t hal_output_init(uint64_t pin_mask)
+{
+    gpio_config_t io_conf = {
+        .pin_bit_mask = pin_mask,
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE
+    };
+
+    ESP_RETURN_ON_ERROR(gpio_config(&io_conf), TAG, "output config");
+    for (int pin = 0; pin < 64; pin++) {
+        if (pin_mask & (1ULL << pin)) {
+            gpio_set_level(pin, 0);
+        }
+    }
+    return ESP_OK;
+}
+
+void hal_output_set(int pin, bool on)
+{
+    gpio_set_level(pin, on);
+}
+
+hal_err_t hal_output_hold(int pin, bool hold)
+{
+    return hold ? gpio_hold_en(pin) : gpio_hold_dis(pin);
+}
+
+// ===== TIME AND TIMERS =====
+
+static void save_clock_floor(void)
+{
+    clock_floor.floor_us = hal_time_us();
+    clock_floor.magic = CLOCK_MAGIC;
+}
+
+// esp_timer runs off the crystal but restarts at every boot. The RTC counter keeps going
+// through deep sleep and resets, on the less accurate slow clock, so it only places the
+// boot and esp_timer measures from there.
+hal_err_t hal_time_init(void)
+{
+    int64_t boot_us = (int64_t)esp_rtc_get_time_us();
+
+    // Resets that clear the RTC counter but keep RTC memory carry on from the last
+    // sleep or restart rather than go back in time
+    if (esp_reset_reason() != ESP_RST_POWERON && clock_floor.magic == CLOCK_MAGIC
+        && boot_us < clock_floor.floor_us) {
+        boot_us = clock_floor.floor_us;
+    }
+    clock_offset_us = boot_us - esp_timer_get_time();
+    return esp_register_shutdown_handler(save_clock_floor);
+}
+
+int64_t hal_time_us(void)
+{
+    return esp_timer_get_time() + clock_offset_us;
+}
+
+hal_err_t hal_timer_create(hal_timer_cb_t cb, void *arg, const char *name, hal_timer_t *out)
+{
+    const esp_timer_create_args_t args = {
+        .callback = cb,
+        .arg = arg,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = name,
+    };
+
+    return esp_timer_create(&args, (esp_timer_handle_t *)out);
+}
+
+void hal_timer_start_at(hal_timer_t timer, int64_t at_us)
+{
+    int64_t delay_us = at_us - hal_time_us();
+
+    esp_timer_stop((esp_timer_handle_t)timer);
+    esp_timer_start_once((esp_timer_handle_t)timer, delay_us > 0 ? delay_us : 0);
+}
+
+void hal_timer_stop(hal_timer_t timer)
+{
+    esp_timer_stop((esp_timer_handle_t)timer);
+}
+
+// ===== SLEEP =====
+
+hal_reset_t hal_reset_reason(void)
+{
+    switch (esp_reset_reason()) {
+    case ESP_RST_DEEPSLEEP:
+        return HAL_RESET_DEEP_SLEEP;
+    case ESP_RST_SW:
+        return HAL_RESET_SOFTWARE;
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+    case ESP_RST_BROWNOUT:
+        return HAL_RESET_FAULT;
+    default:
+        return HAL_RESET_POWER_ON;
+    }
+}
+
+static void arm_timer_wakeup(int64_t at_us)
+{
+    if (at_us == HAL_NEVER) {
+        esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+        return;
+    }
+    int64_t delay_us = at_us - hal_time_us();
+    esp_sleep_enable_timer_wakeup(delay_us > 0 ? delay_us : 1);
+}
+
+hal_wake_t hal_sleep_light_until(int64_t at_us)
+{
+    arm_timer_wakeup(at_us);
+    esp_light_sleep_start();
+
+    switch (esp_sleep_get_wakeup_cause()) {
+    case ESP_SLEEP_WAKEUP_TIMER:
+        return HAL_WAKE_TIMER;
+    case ESP_SLEEP_WAKEUP_EXT0:
+    case ESP_SLEEP_WAKEUP_EXT1:
+    case ESP_SLEEP_WAKEUP_GPIO:
+    case ESP_SLEEP_WAKEUP_TOUCHPAD:
+        return HAL_WAKE_GPIO;
+    default:
+        return HAL_WAKE_OTHER;
+    }
+}
+
+void hal_sleep_deep_until(int64_t at_us)
+{
+    arm_timer_wakeup(at_us);
+    hal_backend_deep_sleep_hold();
+    save_clock_floor();
+    esp_deep_sleep_start();
+}
+
+// ===== ADC =====
+
+hal_err_t hal_adc_init(void)
+{
+    const adc_oneshot_unit_init_cfg_t unit_cfg = {
+        .unit_id = ADC_UNIT_1,
+    };
+
+    ESP_RETURN_ON_ERROR(adc_oneshot_new_unit(&unit_cfg, &adc), TAG, "adc unit");
+    if (hal_backend_adc_cali(&adc_cali) != ESP_OK) {
+        adc_cali = NULL;
+        ESP_LOGW(TAG, "ADC not calibrated, millivolts are estimates");
+    }
+    return ESP_OK;
+}
+
+hal_err_t hal_adc_config(int channel)
+{
+    const adc_oneshot_chan_cfg_t chan_cfg = {
+        .atten = ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+
+    return adc_oneshot_config_channel(adc, channel, &chan_cfg);
+}
+
+hal_err_t hal_adc_read(int channel, int *raw)
+{
+    monitor_pause();
+    esp_err_t err = adc_oneshot_read(adc, channel, raw);
+    monitor_resume();
+    return err;
+}
+
+hal_err_t hal_adc_read_mv(int channel, int *mv)
+{
+    int raw;
+
+    ESP_RETURN_ON_ERROR(hal_adc_read(channel, &raw), TAG, "read");
+    if (adc_cali != NULL) {
+        return adc_cali_raw_to_voltage(adc_cali, raw, mv);
+    }
+    *mv = raw * hal_backend_adc_full_scale_mv / ADC_MAX_RAW;
+    return ESP_OK;
+}
+
+// ===== ADC MONITOR =====
+#if SOC_ADC_MONITOR_SUPPORTED
+
+#define MONITOR_FRAME_BYTES      (SOC_ADC_DIGI_RESULT_BYTES * 16)
+
+static adc_continuous_handle_t monitor_adc;
+static adc_monitor_handle_t monitor;
+static bool monitor_running;
+static hal_adc_monitor_cb_t monitor_cb;
+static void *monitor_arg;
+static volatile bool monitor_fired;
+
+// The interrupt repeats on every conversion past the threshold until the monitor is
+// stopped, the caller only hears the first one
+static bool IRAM_ATTR monitor_fire(bool high)
+{
+    if (monitor_fired) {
+        return false;
+    }
+    monitor_fired = true;
+    return monitor_cb(high, monitor_arg);
+}
+
+static bool IRAM_ATTR on_over_high(adc_monitor_handle_t handle, const adc_monitor_evt_data_t *data, void *arg)
+{
+    return monitor_fire(true);
+}
+
+static bool IRAM_ATTR on_below_low(adc_monitor_handle_t handle, const adc_monitor_evt_data_t *data, void *arg)
+{
+    return monitor_fire(false);
+}
+
+// Continuous mode holds ADC1 while it runs, so oneshot reads step in between
+static void monitor_pause(void)
+{
+    if (monitor_running) {
+        adc_continuous_stop(monitor_adc);
+    }
+}
+
+static void monitor_resume(void)
+{
+    if (monitor_running) {
+        adc_continuous_start(monitor_adc);
+    }
+}
+
+hal_err_t hal_adc_monitor_start(int channel, int low_raw, int high_raw, hal_adc_monitor_cb_t cb, void *arg)
+{
+    const adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = MONITOR_FRAME_BYTES * 2,
+        .conv_frame_size = MONITOR_FRAME_BYTES,
+    };
+    adc_digi_pattern_config_t pattern = {
+        .atten = ADC_ATTEN,
+        .channel = channel,
+        .unit = ADC_UNIT_1,
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+    };
+    // Nobody reads the results, the monitor looks at each conversion on its way to DMA
+    const adc_continuous_config_t dig_cfg = {
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = SOC_ADC_SAMPLE_FREQ_THRES_LOW,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+    };
+    const adc_monitor_config_t monitor_cfg = {
+        .adc_unit = ADC_UNIT_1,
+        .channel = channel,
+        .h_threshold = high_raw,
+        .l_threshold = low_raw,
+    };
+    const adc_monitor_evt_cbs_t cbs = {
+        .on_over_high_thresh = on_over_high,
+        .on_below_low_thresh = on_below_low,
+    };
+
+    hal_adc_monitor_stop();
+    monitor_cb = cb;
+    monitor_arg = arg;
+    monitor_fired = false;
+
+    esp_err_t err = adc_continuous_new_handle(&handle_cfg, &monitor_adc);
+    if (err == ESP_OK) {
+        err = adc_continuous_config(monitor_adc, &dig_cfg);
+    }
+    if (err == ESP_OK) {
+        err = adc_new_continuous_monitor(monitor_adc, &monitor_cfg, &monitor);
+    }
+    if (err == ESP_OK) {
+        err = adc_continuous_monitor_register_event_callbacks(monitor, &cbs, NULL);
+    }
+    if (err == ESP_OK) {
+        err = adc_continuous_monitor_enable(monitor);
+    }
+    if (err == ESP_OK) {
+        err = adc_continuous_start(monitor_adc);
+        monitor_running = (err == ESP_OK);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ADC monitor: %s", esp_err_to_name(err));
+        hal_adc_monitor_stop();
+    }
+    return err;
+}
+
+void hal_adc_monitor_stop(void)
+{
+    if (monitor_running) {
+        adc_continuous_stop(monitor_adc);
+        monitor_running = false;
+    }
+    if (monitor != NULL) {
+        adc_continuous_monitor_disable(monitor);
+        adc_del_continuous_monitor(monitor);
+        monitor = NULL;
+    }
+    if (monitor_adc != NULL) {
+        adc_continuous_deinit(monitor_adc);
+        monitor_adc = NULL;
+    }
+}
+
+#else
+
+static void monitor_pause(void)
+{
+}
+
+static void monitor_resume(void)
+{
+}
+
+hal_err_t hal_adc_monitor_start(int channel, int low_raw, int high_raw, hal_adc_monitor_cb_t cb, void *arg)
+{
+    return HAL_ERR_NOT_SUPPORTED;
+}
+
+void hal_adc_monitor_stop(void)
+{
+}
+
+#endif
+
+// ===== STORAGE =====
+
+hal_err_t hal_storage_init(void)
+{
+    esp_err_t err = nvs_flash_init();
+
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_LOGW(TAG, "Storage partition reformatted");
+        nvs_flash_erase();
+        err = nvs_flash_init();
+    }
+    return err;
+}
+
+hal_err_t hal_storage_read(const char *ns, const char *key, void *buf, size_t *len)
+{
+    nvs_handle_t nvs;
+
+    // A namespace that was never written does not exist yet, which is the same as a missing key
+    esp_err_t err = nvs_open(ns, NVS_READONLY, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_get_blob(nvs, key, buf, len);
+        nvs_close(nvs);
+    }
+    return (err == ESP_ERR_NVS_NOT_FOUND) ? HAL_ERR_NOT_FOUND : err;
+}
+
+hal_err_t hal_storage_write(const char *ns, const char *key, const void *buf, size_t len)
+{
+    nvs_handle_t nvs;
+
+    ESP_RETURN_ON_ERROR(nvs_open(ns, NVS_READWRITE, &nvs), TAG, "open");
+    esp_err_t err = nvs_set_blob(nvs, key, buf, len);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
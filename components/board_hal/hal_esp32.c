@@ -0,0 +1,30 @@
+#include "board_hal.h"
+
+#include "driver/gpio.h"
+#include "hal_backend.h"
+
+// Classic ESP32: line-fitting calibration from the eFuse Vref or two-point values,
+// and digital pads only hold through deep sleep while the global pad hold is on
+
+const int hal_backend_adc_full_scale_mv = 3100;
+
+const char *hal_target_name(void)
+{
+    return "esp32";
+}
+
+esp_err_t hal_backend_adc_cali(adc_cali_handle_t *out)
+{
+    const adc_cali_line_fitting_config_t cfg = {
+        .unit_id = ADC_UNIT_1,
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+
+    return adc_cali_create_scheme_line_fitting(&cfg, out);
+}
+
+void hal_backend_deep_sleep_hold(void)
+{
+    gpio_deep_sleep_hold_en();
+}
@@ -0,0 +1,30 @@
+#include "board_hal.h"
+
+#include "sdkconfig.h"
+#include "hal_backend.h"
+
+// ESP32-C6: curve-fitting calibration, and each pad holds its level through deep sleep
+// on its own.
+
+const int hal_backend_adc_full_scale_mv = 3300;
+
+const char *hal_target_name(void)
+{
+    return CONFIG_IDF_TARGET;
+}
+
+esp_err_t hal_backend_adc_cali(adc_cali_handle_t *out)
+{
+    const adc_cali_curve_fitting_config_t cfg = {
+        .unit_id = ADC_UNIT_1,
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+
+    return adc_cali_create_scheme_curve_fitting(&cfg, out);
+}
+
+void hal_backend_deep_sleep_hold(void)
+{
+    // Pads held with hal_output_hold stay held, there is no global hold to enable
+}
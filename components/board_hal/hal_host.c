@@ -0,0 +1,333 @@
+#include "hal_host.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct hal_timer {
+    hal_timer_cb_t cb;
+    void          *arg;
+    int64_t        at_us;
+    bool           armed;
+};
+
+typedef struct {
+    char    ns[16];
+    char    key[16];
+    size_t  len;
+    uint8_t data[HAL_HOST_MAX_BLOB];
+} blob_t;
+
+static int64_t now_us;
+static hal_reset_t reset_reason;
+static uint64_t output_level;
+static uint64_t output_held;
+static struct hal_timer timers[HAL_HOST_MAX_TIMERS];
+static int timer_count;
+static int adc_raw[HAL_HOST_MAX_CHANNELS];
+static bool monitor_supported = true;
+static struct {
+    int                  channel;
+    int                  low_raw;
+    int                  high_raw;
+    hal_adc_monitor_cb_t cb;
+    void                *arg;
+    bool                 armed;
+} monitor;
+static blob_t blobs[HAL_HOST_MAX_BLOBS];
+static int blob_count;
+static void (*deep_sleep_hook)(int64_t wake_at_us);
+
+// ===== MOCK CONTROLS =====
+
+void hal_host_reset(hal_reset_t reason)
+{
+    if (reason == HAL_RESET_POWER_ON) {
+        now_us = 0;
+    }
+    reset_reason = reason;
+    output_level = 0;
+    output_held = 0;
+    timer_count = 0;
+    memset(adc_raw, 0, sizeof(adc_raw));
+    monitor.armed = false;
+}
+
+void hal_host_set_time_us(int64_t now)
+{
+    now_us = now;
+}
+
+void hal_host_erase_storage(void)
+{
+    blob_count = 0;
+}
+
+static struct hal_timer *next_due(int64_t until_us)
+{
+    struct hal_timer *next = NULL;
+
+    for (int i = 0; i < timer_count; i++) {
+        if (timers[i].armed && timers[i].at_us <= until_us && (next == NULL || timers[i].at_us < next->at_us)) {
+            next = &timers[i];
+        }
+    }
+    return next;
+}
+
+void hal_host_advance_us(int64_t delta_us)
+{
+    int64_t until_us = now_us + delta_us;
+    struct hal_timer *t;
+
+    // Callbacks may re-arm timers inside the window, so look again after each one
+    while ((t = next_due(until_us)) != NULL) {
+        if (t->at_us > now_us) {
+            now_us = t->at_us;
+        }
+        t->armed = false;
+        t->cb(t->arg);
+    }
+    now_us = until_us;
+}
+
+bool hal_host_output(int pin)
+{
+    return (output_level >> pin) & 1;
+}
+
+bool hal_host_output_held(int pin)
+{
+    return (output_held >> pin) & 1;
+}
+
+// Hardware converts continuously, the mock looks whenever the level is set
+static void check_monitor(void)
+{
+    if (!monitor.armed) {
+        return;
+    }
+    int raw = adc_raw[monitor.channel];
+    if (raw < monitor.low_raw || (monitor.high_raw >= 0 && raw > monitor.high_raw)) {
+        monitor.armed = false;
+        monitor.cb(raw > monitor.high_raw && monitor.high_raw >= 0, monitor.arg);
+    }
+}
+
+void hal_host_set_adc(int channel, int raw)
+{
+    if (channel >= 0 && channel < HAL_HOST_MAX_CHANNELS) {
+        adc_raw[channel] = raw;
+        check_monitor();
+    }
+}
+
+void hal_host_set_adc_monitor(bool supported)
+{
+    monitor_supported = supported;
+}
+
+void hal_host_on_deep_sleep(void (*hook)(int64_t wake_at_us))
+{
+    deep_sleep_hook = hook;
+}
+
+const char *hal_target_name(void)
+{
+    return "host";
+}
+
+// ===== OUTPUTS =====
+
+hal_err_t hal_output_init(uint64_t pin_mask)
+{
+    output_level &= ~pin_mask;
+    return HAL_OK;
+}
+
+void hal_output_set(int pin, bool on)
+{
+    if (pin < 0 || pin >= HAL_HOST_MAX_PINS || hal_host_output_held(pin)) {
+        return;
+    }
+    output_level = on ? (output_level | (1ULL << pin)) : (output_level & ~(1ULL << pin));
+}
+
+hal_err_t hal_output_hold(int pin, bool hold)
+{
+    if (pin < 0 || pin >= HAL_HOST_MAX_PINS) {
+        return HAL_ERR_INVALID_ARG;
+    }
+    output_held = hold ? (output_held | (1ULL << pin)) : (output_held & ~(1ULL << pin));
+    return HAL_OK;
+}
+
+// ===== TIME AND TIMERS =====
+
+hal_err_t hal_time_init(void)
+{
+    return HAL_OK;
+}
+
+int64_t hal_time_us(void)
+{
+    return now_us;
+}
+
+hal_err_t hal_timer_create(hal_timer_cb_t cb, void *arg, const char *name, hal_timer_t *out)
+{
+    (void)name;
+    if (timer_count == HAL_HOST_MAX_TIMERS) {
+        return HAL_ERR_NO_MEM;
+    }
+    timers[timer_count] = (struct hal_timer){ .cb = cb, .arg = arg };
+    *out = &timers[timer_count++];
+    return HAL_OK;
+}
+
+void hal_timer_start_at(hal_timer_t timer, int64_t at_us)
+{
+    timer->at_us = at_us;
+    timer->armed = true;
+}
+
+void hal_timer_stop(hal_timer_t timer)
+{
+    timer->armed = false;
+}
+
+// ===== SLEEP =====
+
+hal_reset_t hal_reset_reason(void)
+{
+    return reset_reason;
+}
+
+// Timers keep running through light sleep, so a due one wakes it like a timer source would
+hal_wake_t hal_sleep_light_until(int64_t at_us)
+{
+    if (at_us != HAL_NEVER && at_us > now_us) {
+        hal_host_advance_us(at_us - now_us);
+    }
+    return HAL_WAKE_TIMER;
+}
+
+void hal_sleep_deep_until(int64_t at_us)
+{
+    timer_count = 0;
+    if (at_us != HAL_NEVER && at_us > now_us) {
+        now_us = at_us;
+    }
+    if (deep_sleep_hook != NULL) {
+        deep_sleep_hook(at_us);
+    }
+    abort();
+}
+
+// ===== ADC =====
+
+hal_err_t hal_adc_init(void)
+{
+    return HAL_OK;
+}
+
+hal_err_t hal_adc_config(int channel)
+{
+    return (channel >= 0 && channel < HAL_HOST_MAX_CHANNELS) ? HAL_OK : HAL_ERR_INVALID_ARG;
+}
+
+hal_err_t hal_adc_read(int channel, int *raw)
+{
+    if (channel < 0 || channel >= HAL_HOST_MAX_CHANNELS) {
+        return HAL_ERR_INVALID_ARG;
+    }
+    *raw = adc_raw[channel];
+    return HAL_OK;
+}
+
+hal_err_t hal_adc_read_mv(int channel, int *mv)
+{
+    int raw;
+    hal_err_t err = hal_adc_read(channel, &raw);
+
+    if (err == HAL_OK) {
+        *mv = (int)(raw * HAL_HOST_MV_PER_RAW);
+    }
+    return err;
+}
+
+// ===== ADC MONITOR =====
+
+hal_err_t hal_adc_monitor_start(int channel, int low_raw, int high_raw, hal_adc_monitor_cb_t cb, void *arg)
+{
+    if (!monitor_supported) {
+        return HAL_ERR_NOT_SUPPORTED;
+    }
+    if (channel < 0 || channel >= HAL_HOST_MAX_CHANNELS) {
+        return HAL_ERR_INVALID_ARG;
+    }
+    monitor.channel = channel;
+    monitor.low_raw = low_raw;
+    monitor.high_raw = high_raw;
+    monitor.cb = cb;
+    monitor.arg = arg;
+    monitor.armed = true;
+    check_monitor();
+    return HAL_OK;
+}
+
+void hal_adc_monitor_stop(void)
+{
+    monitor.armed = false;
+}
+
+// ===== STORAGE =====
+
+static blob_t *find_blob(const char *ns, const char *key)
+{
+    for (int i = 0; i < blob_count; i++) {
+        if (strcmp(blobs[i].ns, ns) == 0 && strcmp(blobs[i].key, key) == 0) {
+            return &blobs[i];
+        }
+    }
+    return NULL;
+}
+
+hal_err_t hal_storage_init(void)
+{
+    return HAL_OK;
+}
+
+hal_err_t hal_storage_read(const char *ns, const char *key, void *buf, size_t *len)
+{
+    blob_t *b = find_blob(ns, key);
+
+    if (b == NULL) {
+        return HAL_ERR_NOT_FOUND;
+    }
+    if (b->len > *len) {
+        return HAL_ERR_INVALID_SIZE;
+    }
+    memcpy(buf, b->data, b->len);
+    *len = b->len;
+    return HAL_OK;
+}
+
+hal_err_t hal_storage_write(const char *ns, const char *key, const void *buf, size_t len)
+{
+    blob_t *b = find_blob(ns, key);
+
+    if (len > HAL_HOST_MAX_BLOB || strlen(ns) >= sizeof(b->ns) || strlen(key) >= sizeof(b->key)) {
+        return HAL_ERR_INVALID_ARG;
+    }
+    if (b == NULL) {
+        if (blob_count == HAL_HOST_MAX_BLOBS) {
+            return HAL_ERR_NO_MEM;
+        }
+        b = &blobs[blob_count++];
+        strcpy(b->ns, ns);
+        strcpy(b->key, key);
+    }
+    memcpy(b->data, buf, len);
+    b->len = len;
+    return HAL_OK;
+}
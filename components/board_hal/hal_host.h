@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "board_hal.h"
+
+// Controls for the host mock backend. Time is virtual and only moves when a test
+// or simulation advances it; due timers fire in deadline order as it passes them.
+
+// ===== HOST MOCK CONFIGURATION =====
+#define HAL_HOST_MAX_PINS        64
+#define HAL_HOST_MAX_TIMERS      16
+#define HAL_HOST_MAX_CHANNELS    10
+#define HAL_HOST_MAX_BLOBS       16
+#define HAL_HOST_MAX_BLOB        4096
+#define HAL_HOST_MV_PER_RAW      (3300.0 / 4095)   // Linear ADC model
+
+// Clear outputs and timers and set the reason the next boot reports. Like the device
+// clock, the virtual one only restarts from 0 on HAL_RESET_POWER_ON. Storage survives
+// any reset, as flash does.
+void hal_host_reset(hal_reset_t reason);
+
+// Jump the clock without firing anything, e.g. to just short of a wrap boundary
+void hal_host_set_time_us(int64_t now);
+
+void hal_host_erase_storage(void);
+
+// Move the virtual clock forward, firing every timer due on the way
+void hal_host_advance_us(int64_t delta_us);
+
+bool hal_host_output(int pin);
+bool hal_host_output_held(int pin);
+
+// Also where the mock ADC monitor looks, so set levels as they change over time
+void hal_host_set_adc(int channel, int raw);
+
+// Pretend the chip has (true, the default) or lacks the ADC threshold monitor
+void hal_host_set_adc_monitor(bool supported);
+
+// Called instead of powering down, with the clock already moved to the wakeup and every
+// timer gone. It should reset the mock and longjmp back into the simulation; without a
+// hook, deep sleep aborts the program.
+void hal_host_on_deep_sleep(void (*hook)(int64_t wake_at_us));
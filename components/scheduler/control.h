@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+// Events delivered to the irrigation task's control queue
+typedef enum {
+    CONTROL_EVENT_PLAN = 0,                        // The next planned start/stop is due
+    CONTROL_EVENT_FLOW_SAMPLE,                     // Time to check flow against the baseline
+    CONTROL_EVENT_IDLE_FLOW,                       // Water moving with every zone closed
+    CONTROL_EVENT_FROST_CHECK,                     // Re-read temperature while frost protection is active
+    CONTROL_EVENT_BUTTON,                          // Manual button released, arg is a button_press_t
+    CONTROL_EVENT_TANK_LOW,                        // Tank reached the reserve while pumping
+    CONTROL_EVENT_TANK_CHECK,                      // Time to poll the tank, chips without the ADC monitor
+    CONTROL_EVENT_SENSE,                           // Time for the next adaptive moisture sample
+} control_event_type_t;
+
+typedef struct {
+    uint16_t type;                                 // control_event_type_t
+    uint16_t arg;                                  // Event specific, e.g. a zone index
+} control_event_t;
+
+#define CONTROL_QUEUE_LENGTH     16
+
+static inline uint32_t control_event_pack(control_event_t ev)
+{
+    return ((uint32_t)ev.type << 16) | ev.arg;
+}
+
+static inline control_event_t control_event_unpack(uint32_t packed)
+{
+    return (control_event_t){ .type = packed >> 16, .arg = packed & 0xFFFF };
+}
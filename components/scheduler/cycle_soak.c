@@ -0,0 +1,59 @@
+#include "cycle_soak.h"
+
+#include <stdbool.h>
+
+int cycle_soak_plan(const soak_zone_t *zones, int zone_count, soak_pulse_t *pulses, int max_pulses)
+{
+    uint32_t remaining[SOAK_MAX_ZONES];
+    uint32_t ready_at[SOAK_MAX_ZONES];
+    uint32_t t = 0;
+    int n = 0;
+
+    if (zone_count > SOAK_MAX_ZONES) {
+        zone_count = SOAK_MAX_ZONES;
+    }
+    for (int z = 0; z < zone_count; z++) {
+        remaining[z] = zones[z].run_s;
+        ready_at[z] = 0;
+    }
+
+    while (true) {
+        int pick = -1;
+        uint32_t next_ready = UINT32_MAX;
+
+        for (int z = 0; z < zone_count; z++) {
+            if (remaining[z] == 0) {
+                continue;
+            }
+            if (ready_at[z] > t) {
+                if (ready_at[z] < next_ready) {
+                    next_ready = ready_at[z];
+                }
+                continue;
+            }
+            if (pick < 0 || remaining[z] > remaining[pick]) {
+                pick = z;
+            }
+        }
+        if (pick < 0) {
+            if (next_ready == UINT32_MAX) {
+                return n;
+            }
+            // Every zone is soaking, the pump idles until the first one is ready
+            t = next_ready;
+            continue;
+        }
+        if (n >= max_pulses) {
+            return -1;
+        }
+
+        uint32_t length = remaining[pick];
+        if (zones[pick].pulse_s && length > zones[pick].pulse_s) {
+            length = zones[pick].pulse_s;
+        }
+        pulses[n++] = (soak_pulse_t){ .start_s = t, .length_s = length, .zone = pick };
+        remaining[pick] -= length;
+        t += length;
+        ready_at[pick] = t + zones[pick].soak_s;
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== PULSE-AND-SOAK CONFIGURATION =====
+#define SOAK_MAX_ZONES           8
+#define SOAK_MAX_PULSES          24                // Pulses scheduled for one batch of zones
+
+typedef struct {
+    uint32_t run_s;            // Total pump time the zone needs this cycle
+    uint32_t pulse_s;          // Longest run before the soil starts shedding water, 0 = no limit
+    uint32_t soak_s;           // Rest after each pulse so the water can soak in
+} soak_zone_t;
+
+typedef struct {
+    uint32_t start_s;          // Offset from the start of the batch
+    uint32_t length_s;
+    uint8_t  zone;
+} soak_pulse_t;
+
+// Split each zone's run time into pulses separated by soak intervals. Zones share one
+// pump, so one zone's pulse fills another zone's soak: whenever the pump is free the
+// ready zone with the most water left goes next. Pulses are returned in time order.
+// Returns the number of pulses, or -1 if they do not fit in max_pulses.
+int cycle_soak_plan(const soak_zone_t *zones, int zone_count, soak_pulse_t *pulses, int max_pulses);
@@ -0,0 +1,96 @@
+#include "moisture_track.h"
+
+#include <math.h>
+
+#define US_PER_H                 3600000000.0f
+#define GAP_GROWTH               1.25f             // Candidate gaps are tried in steps of this factor
+
+void moisture_track_reset(moisture_track_t *t)
+{
+    *t = (moisture_track_t){ .disturbed = true };
+}
+
+// Level variance after dt_h hours without a sample
+static float predicted_var(const moisture_track_t *t, float dt_h)
+{
+    return t->p_pp + 2 * dt_h * t->p_pr + dt_h * dt_h * t->p_rr + TRACK_RATE_DRIFT * dt_h * dt_h * dt_h / 3;
+}
+
+void moisture_track_update(moisture_track_t *t, uint8_t pct, int64_t at_us)
+{
+    if (!t->valid) {
+        *t = (moisture_track_t){
+            .pct = pct, .p_pp = TRACK_PROBE_VAR, .p_rr = TRACK_RATE_RESET_VAR,
+            .at_us = at_us, .valid = true, .disturbed = true,
+        };
+        return;
+    }
+
+    // Predict: constant rate with a slowly wandering rate
+    float dt_h = (at_us > t->at_us) ? (at_us - t->at_us) / US_PER_H : 0;
+    float pp = predicted_var(t, dt_h);
+    float pr = t->p_pr + dt_h * t->p_rr + TRACK_RATE_DRIFT * dt_h * dt_h / 2;
+    float rr = t->p_rr + TRACK_RATE_DRIFT * dt_h;
+    float level = t->pct + t->rate * dt_h;
+
+    // Update with the reading
+    float innovation = pct - level;
+    float s = pp + TRACK_PROBE_VAR;
+    bool surprise = innovation * innovation > TRACK_SURPRISE_SIGMA * TRACK_SURPRISE_SIGMA * s;
+    float k_p = pp / s;
+    float k_r = pr / s;
+
+    t->pct = level + k_p * innovation;
+    t->rate = t->rate + k_r * innovation;
+    t->p_pp = (1 - k_p) * pp;
+    t->p_pr = (1 - k_p) * pr;
+    t->p_rr = rr - k_r * pr;
+    t->at_us = at_us;
+    t->disturbed = surprise;
+
+    // Rain or watering the filter was not told about: trust the reading, relearn the rate
+    if (surprise) {
+        t->pct = pct;
+        t->rate = 0;
+        t->p_pp = TRACK_PROBE_VAR;
+        t->p_pr = 0;
+        t->p_rr = TRACK_RATE_RESET_VAR;
+    }
+}
+
+void moisture_track_disturb(moisture_track_t *t)
+{
+    t->disturbed = true;
+    t->rate = 0;
+    t->p_pr = 0;
+    t->p_rr = TRACK_RATE_RESET_VAR;
+    t->p_pp += TRACK_SIGMA_PCT * TRACK_SIGMA_PCT * 100;
+}
+
+float moisture_track_predict(const moisture_track_t *t, int64_t at_us)
+{
+    return t->pct + t->rate * ((at_us - t->at_us) / US_PER_H);
+}
+
+uint32_t moisture_track_next_s(const moisture_track_t *t, uint8_t dry_pct)
+{
+    float gap_s = TRACK_MIN_S;
+
+    if (!t->valid || t->disturbed) {
+        return TRACK_MIN_S;
+    }
+    // Grow the gap until the next step would break one of the limits
+    while (gap_s < TRACK_MAX_S) {
+        float next_s = fminf(gap_s * GAP_GROWTH, TRACK_MAX_S);
+        float dt_h = next_s / 3600;
+        float level = t->pct + t->rate * dt_h;
+
+        if (fabsf(t->rate) * dt_h > TRACK_STEP_PCT
+            || predicted_var(t, dt_h) > TRACK_SIGMA_PCT * TRACK_SIGMA_PCT
+            || level - TRACK_SIGMA_PCT <= dry_pct) {
+            break;
+        }
+        gap_s = next_s;
+    }
+    return (uint32_t)gap_s;
+}
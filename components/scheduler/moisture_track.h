@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== MOISTURE TRACKING CONFIGURATION =====
+#define TRACK_MIN_S              (10 * 60)         // Shortest gap, right after watering or a surprise
+#define TRACK_MAX_S              (12 * 60 * 60)    // Longest gap, however still the soil is
+#define TRACK_STEP_PCT           2.0f              // Change expected between two samples
+#define TRACK_SIGMA_PCT          2.5f              // Uncertainty allowed to build up between samples
+#define TRACK_PROBE_VAR          1.0f              // Probe noise, pct^2
+#define TRACK_RATE_DRIFT         0.002f            // Rate random walk, (pct/h)^2 per hour
+#define TRACK_RATE_RESET_VAR     4.0f              // Rate uncertainty after a disturbance, (pct/h)^2
+#define TRACK_SURPRISE_SIGMA     3.0f              // Innovations beyond this many sigma count as rain
+
+// Two-state Kalman filter on one zone's soil moisture: level and rate of change. Kept
+// by the caller in RTC memory, one per zone.
+typedef struct {
+    float   pct;               // Moisture estimate
+    float   rate;              // Percentage points per hour, negative while drying
+    float   p_pp;              // Covariance of level, level/rate and rate
+    float   p_pr;
+    float   p_rr;
+    int64_t at_us;             // Time of the estimate
+    bool    valid;             // At least one sample folded in
+    bool    disturbed;         // Watering or rain since the last sample, sample again soon
+} moisture_track_t;
+
+void moisture_track_reset(moisture_track_t *t);
+
+// Fold in a probe reading taken at at_us. A reading far off the prediction, e.g. after
+// rain, re-opens the rate and marks the zone disturbed.
+void moisture_track_update(moisture_track_t *t, uint8_t pct, int64_t at_us);
+
+// Water went in, so the level is about to jump and the old rate no longer holds
+void moisture_track_disturb(moisture_track_t *t);
+
+// Level extrapolated to at_us from the last estimate
+float moisture_track_predict(const moisture_track_t *t, int64_t at_us);
+
+// Seconds until the next sample is worth taking: the longest gap within TRACK_MIN_S and
+// TRACK_MAX_S over which the level should move less than TRACK_STEP_PCT, its
+// uncertainty stays within TRACK_SIGMA_PCT and it cannot yet reach dry_pct.
+uint32_t moisture_track_next_s(const moisture_track_t *t, uint8_t dry_pct);
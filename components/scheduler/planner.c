@@ -0,0 +1,408 @@
+#include "planner.h"
+
+#include <string.h>
+
+#define PLAN_MAGIC               0x504C414EU       // "PLAN"
+#define NO_START                 INT64_MIN         // Cycle already running, only its stop is pending
+
+typedef struct {
+    int64_t start_us;
+    int64_t stop_us;
+    uint8_t zone;
+    uint8_t start_type;
+} cycle_t;
+
+// Scratch space for one compile pass. Kept static so the planner never needs a big stack.
+static cycle_t cycles[PLANNER_MAX_EVENTS];
+static int cycle_count;
+static int event_budget;
+static int64_t first_dropped_us;
+
+static bool plan_valid(const plan_t *plan)
+{
+    return plan->magic == PLAN_MAGIC;
+}
+
+static void reset_scratch(void)
+{
+    cycle_count = 0;
+    event_budget = PLANNER_MAX_EVENTS;
+    first_dropped_us = INT64_MAX;
+}
+
+// Insert a cycle keeping the list sorted by start time. When the event table would
+// overflow, the latest cycle is dropped and the window is later cut before it.
+static void add_cycle(int64_t start_us, int64_t stop_us, uint8_t zone, uint8_t start_type)
+{
+    int cost = (start_us == NO_START) ? 1 : 2;
+
+    while (event_budget < cost && cycle_count > 0) {
+        cycle_t *last = &cycles[cycle_count - 1];
+        if (last->start_us <= start_us) {
+            if (start_us < first_dropped_us) {
+                first_dropped_us = start_us;
+            }
+            return;
+        }
+        if (last->start_us < first_dropped_us) {
+            first_dropped_us = last->start_us;
+        }
+        event_budget += (last->start_us == NO_START) ? 1 : 2;
+        cycle_count--;
+    }
+    if (event_budget < cost) {
+        return;
+    }
+
+    int i = cycle_count;
+    while (i > 0 && cycles[i - 1].start_us > start_us) {
+        cycles[i] = cycles[i - 1];
+        i--;
+    }
+    cycles[i] = (cycle_t){ .start_us = start_us, .stop_us = stop_us, .zone = zone, .start_type = start_type };
+    cycle_count++;
+    event_budget -= cost;
+}
+
+// Carry over pending events into the scratch list. Zones in regen_mask are about to
+// be regenerated, so only a running cycle's stop is kept for them.
+static void collect_pending(const plan_t *plan, uint32_t regen_mask, int64_t running_stop_us[])
+{
+    uint32_t seen = 0;
+
+    for (int i = plan->next; i < plan->count; i++) {
+        const plan_event_t *ev = &plan->events[i];
+        uint32_t bit = 1U << ev->zone;
+        bool first_for_zone = !(seen & bit);
+        seen |= bit;
+
+        if (ev->type == PLAN_EVENT_STOP) {
+            if (first_for_zone) {
+                running_stop_us[ev->zone] = ev->at_us;
+                add_cycle(NO_START, ev->at_us, ev->zone, PLAN_EVENT_START);
+            }
+            continue;
+        }
+        if (regen_mask & bit) {
+            continue;
+        }
+        // Pair the start with the zone's next stop
+        int64_t stop_us = ev->at_us;
+        for (int j = i + 1; j < plan->count; j++) {
+            if (plan->events[j].zone == ev->zone && plan->events[j].type == PLAN_EVENT_STOP) {
+                stop_us = plan->events[j].at_us;
+                break;
+            }
+        }
+        add_cycle(ev->at_us, stop_us, ev->zone, ev->type);
+    }
+}
+
+static void generate_zone(const plan_t *plan, const zone_rule_t *rule, uint8_t zone,
+                          int64_t from_us, int64_t end_us)
+{
+    if (!rule->enabled || rule->interval_s == 0) {
+        return;
+    }
+
+    int64_t interval_us = (int64_t)rule->interval_s * 1000000;
+    int64_t duration_us = (int64_t)rule->duration_s * 1000000;
+    int64_t start_us = plan->anchor_us[zone] + (int64_t)rule->offset_s * 1000000;
+
+    if (start_us < from_us) {
+        start_us += ((from_us - start_us + interval_us - 1) / interval_us) * interval_us;
+    }
+    for (; start_us < end_us && start_us < first_dropped_us; start_us += interval_us) {
+        add_cycle(start_us, start_us + duration_us, zone, PLAN_EVENT_START);
+    }
+}
+
+// Stops sort before starts at the same instant so back-to-back cycles hand over cleanly.
+static bool event_before(const plan_event_t *a, const plan_event_t *b)
+{
+    if (a->at_us != b->at_us) {
+        return a->at_us < b->at_us;
+    }
+    return a->type == PLAN_EVENT_STOP && b->type != PLAN_EVENT_STOP;
+}
+
+static void emit_events(plan_t *plan, int64_t epoch_us, int64_t end_us)
+{
+    int n = 0;
+
+    for (int c = 0; c < cycle_count; c++) {
+        if (cycles[c].start_us != NO_START) {
+            plan->events[n++] = (plan_event_t){ cycles[c].start_us, cycles[c].zone, cycles[c].start_type };
+        }
+        plan->events[n++] = (plan_event_t){ cycles[c].stop_us, cycles[c].zone, PLAN_EVENT_STOP };
+    }
+    for (int i = 1; i < n; i++) {
+        plan_event_t ev = plan->events[i];
+        int j = i;
+        while (j > 0 && event_before(&ev, &plan->events[j - 1])) {
+            plan->events[j] = plan->events[j - 1];
+            j--;
+        }
+        plan->events[j] = ev;
+    }
+
+    plan->epoch_us = epoch_us;
+    plan->end_us = (first_dropped_us < end_us) ? first_dropped_us : end_us;
+    plan->count = n;
+    plan->next = 0;
+    plan->magic = PLAN_MAGIC;
+}
+
+void planner_invalidate(plan_t *plan)
+{
+    memset(plan, 0, sizeof(*plan));
+}
+
+bool planner_needs_build(const plan_t *plan, int64_t now_us)
+{
+    if (!plan_valid(plan)) {
+        return true;
+    }
+    return plan->next >= plan->count && now_us >= plan->end_us;
+}
+
+void planner_build(plan_t *plan, const zone_rule_t *rules, int zone_count, int64_t now_us)
+{
+    int64_t running_stop_us[PLANNER_MAX_ZONES] = { 0 };
+    int64_t from_us = now_us;
+
+    if (zone_count > PLANNER_MAX_ZONES) {
+        zone_count = PLANNER_MAX_ZONES;
+    }
+
+    reset_scratch();
+    if (plan_valid(plan)) {
+        // Continue exactly where the last window ended, however late we are
+        from_us = plan->end_us;
+        collect_pending(plan, UINT32_MAX, running_stop_us);
+    } else {
+        plan->anchored = 0;
+    }
+
+    int64_t end_us = ((now_us > from_us) ? now_us : from_us) + PLANNER_HORIZON_US;
+    for (int z = 0; z < zone_count; z++) {
+        if (!(plan->anchored & (1U << z))) {
+            plan->anchor_us[z] = now_us;
+            plan->anchored |= 1U << z;
+        }
+        int64_t zone_from_us = (running_stop_us[z] > from_us) ? running_stop_us[z] : from_us;
+        // A cycle that would already have stopped has nothing left to water
+        int64_t late_from_us = now_us - (int64_t)rules[z].duration_s * 1000000 + 1;
+        if (late_from_us > zone_from_us) {
+            zone_from_us = late_from_us;
+        }
+        generate_zone(plan, &rules[z], z, zone_from_us, end_us);
+    }
+    emit_events(plan, from_us, end_us);
+}
+
+void planner_replan_zone(plan_t *plan, const zone_rule_t *rules, int zone, int64_t now_us)
+{
+    int64_t running_stop_us[PLANNER_MAX_ZONES] = { 0 };
+
+    if (!plan_valid(plan) || zone < 0 || zone >= PLANNER_MAX_ZONES) {
+        return;
+    }
+
+    reset_scratch();
+    collect_pending(plan, 1U << zone, running_stop_us);
+
+    if (!(plan->anchored & (1U << zone))) {
+        plan->anchor_us[zone] = now_us;
+        plan->anchored |= 1U << zone;
+    }
+    int64_t from_us = (plan->epoch_us > now_us) ? plan->epoch_us : now_us;
+    if (running_stop_us[zone] > from_us) {
+        from_us = running_stop_us[zone];
+    }
+    generate_zone(plan, &rules[zone], zone, from_us, plan->end_us);
+    emit_events(plan, plan->epoch_us, plan->end_us);
+}
+
+bool planner_trim_cycle(plan_t *plan, int zone, int64_t stop_at_us)
+{
+    int i = plan->next;
+
+    if (!plan_valid(plan)) {
+        return false;
+    }
+    while (i < plan->count && !(plan->events[i].zone == zone && plan->events[i].type == PLAN_EVENT_STOP)) {
+        i++;
+    }
+    if (i >= plan->count) {
+        return false;
+    }
+
+    // Only one entry moves, so a single insertion pass restores the order
+    plan_event_t ev = plan->events[i];
+    ev.at_us = (stop_at_us > plan->events[plan->next].at_us) ? stop_at_us : plan->events[plan->next].at_us;
+    while (i > plan->next && event_before(&ev, &plan->events[i - 1])) {
+        plan->events[i] = plan->events[i - 1];
+        i--;
+    }
+    while (i + 1 < plan->count && event_before(&plan->events[i + 1], &ev)) {
+        plan->events[i] = plan->events[i + 1];
+        i++;
+    }
+    plan->events[i] = ev;
+    return true;
+}
+
+// True while ev still belongs to the current cycle of a zone in *open. The zone's
+// next start begins a new cycle and closes it.
+static bool in_current_cycle(uint32_t *open, const plan_event_t *ev)
+{
+    uint32_t bit = 1U << ev->zone;
+
+    if ((*open & bit) && ev->type == PLAN_EVENT_START) {
+        *open &= ~bit;
+    }
+    return (*open & bit) != 0;
+}
+
+bool planner_replace_cycles(plan_t *plan, uint32_t zone_mask, const plan_event_t *events, int count)
+{
+    uint32_t open = zone_mask;
+    int n = plan->next;
+
+    if (!plan_valid(plan)) {
+        return false;
+    }
+
+    // Count what survives first so a failed replace leaves the plan intact
+    int kept = 0;
+    for (int i = plan->next; i < plan->count; i++) {
+        if (!in_current_cycle(&open, &plan->events[i])) {
+            kept++;
+        }
+    }
+    if (plan->next + kept + count > PLANNER_MAX_EVENTS) {
+        return false;
+    }
+
+    open = zone_mask;
+    for (int i = plan->next; i < plan->count; i++) {
+        if (!in_current_cycle(&open, &plan->events[i])) {
+            plan->events[n++] = plan->events[i];
+        }
+    }
+    for (int e = 0; e < count; e++) {
+        int i = n++;
+        while (i > plan->next && event_before(&events[e], &plan->events[i - 1])) {
+            plan->events[i] = plan->events[i - 1];
+            i--;
+        }
+        plan->events[i] = events[e];
+    }
+    plan->count = n;
+    return true;
+}
+
+void planner_scale_cycles(plan_t *plan, int64_t from_us, planner_scale_fn scale, void *ctx)
+{
+    int64_t running_stop_us[PLANNER_MAX_ZONES] = { 0 };
+    int kept = 0;
+
+    if (!plan_valid(plan)) {
+        return;
+    }
+
+    reset_scratch();
+    collect_pending(plan, 0, running_stop_us);
+    for (int c = 0; c < cycle_count; c++) {
+        cycle_t cycle = cycles[c];
+        if (cycle.start_us != NO_START && cycle.start_type == PLAN_EVENT_START && cycle.start_us >= from_us) {
+            plan_event_t start = { cycle.start_us, cycle.zone, PLAN_EVENT_START };
+            uint8_t pct = scale(&start, ctx);
+            if (pct == 0) {
+                continue;
+            }
+            if (pct < 100) {
+                cycle.stop_us = cycle.start_us + (cycle.stop_us - cycle.start_us) * pct / 100;
+            }
+        }
+        cycles[kept++] = cycle;
+    }
+    cycle_count = kept;
+    emit_events(plan, plan->epoch_us, plan->end_us);
+}
+
+void planner_set_anchor(plan_t *plan, int zone, int64_t anchor_us)
+{
+    if (zone < 0 || zone >= PLANNER_MAX_ZONES) {
+        return;
+    }
+    plan->anchor_us[zone] = anchor_us;
+    plan->anchored |= 1U << zone;
+}
+
+bool planner_cycle_continues(const plan_t *plan, int zone)
+{
+    if (!plan_valid(plan)) {
+        return false;
+    }
+    for (int i = plan->next; i < plan->count; i++) {
+        const plan_event_t *ev = &plan->events[i];
+        if (ev->zone == zone && ev->type != PLAN_EVENT_STOP) {
+            return ev->type == PLAN_EVENT_PULSE;
+        }
+    }
+    return false;
+}
+
+const plan_event_t *planner_peek(const plan_t *plan)
+{
+    if (!plan_valid(plan) || plan->next >= plan->count) {
+        return NULL;
+    }
+    return &plan->events[plan->next];
+}
+
+int64_t planner_next_wake_us(const plan_t *plan)
+{
+    const plan_event_t *ev = planner_peek(plan);
+    return ev ? ev->at_us : plan->end_us;
+}
+
+int64_t planner_next_start_us(const plan_t *plan)
+{
+    if (!plan_valid(plan)) {
+        return INT64_MAX;
+    }
+    for (int i = plan->next; i < plan->count; i++) {
+        if (plan->events[i].type == PLAN_EVENT_START) {
+            return plan->events[i].at_us;
+        }
+    }
+    return INT64_MAX;
+}
+
+int64_t planner_next_stop_us(const plan_t *plan, int zone)
+{
+    if (!plan_valid(plan)) {
+        return INT64_MAX;
+    }
+    for (int i = plan->next; i < plan->count; i++) {
+        if (plan->events[i].zone == zone && plan->events[i].type == PLAN_EVENT_STOP) {
+            return plan->events[i].at_us;
+        }
+    }
+    return INT64_MAX;
+}
+
+bool planner_pop_due(plan_t *plan, int64_t now_us, plan_event_t *out)
+{
+    const plan_event_t *ev = planner_peek(plan);
+
+    if (ev == NULL || ev->at_us > now_us) {
+        return false;
+    }
+    *out = *ev;
+    plan->next++;
+    return true;
+}
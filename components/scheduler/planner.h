@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== PLANNER CONFIGURATION =====
+#define PLANNER_MAX_ZONES        8
+#define PLANNER_MAX_EVENTS       64                // Start/stop events held for one horizon
+#define PLANNER_HORIZON_US       (24LL * 60 * 60 * 1000000)  // Plan one day ahead
+
+typedef enum {
+    PLAN_EVENT_START = 0,      // Start of a cycle, allocates water for it
+    PLAN_EVENT_STOP  = 1,
+    PLAN_EVENT_PULSE = 2,      // Resume a cycle already allocated, e.g. after a soak
+} plan_event_type_t;
+
+// Schedule rule for one zone. Cycles start at anchor + offset + k * interval.
+typedef struct {
+    bool     enabled;
+    uint32_t interval_s;       // Seconds between cycle starts
+    uint32_t duration_s;       // Seconds the zone is watered per cycle
+    uint32_t offset_s;         // Delay of the first cycle after the anchor
+} zone_rule_t;
+
+typedef struct {
+    int64_t at_us;             // Absolute time of the event
+    uint8_t zone;
+    uint8_t type;              // plan_event_type_t
+} plan_event_t;
+
+// Compiled plan. Lives in RTC memory so a wakeup only has to pop the next entry.
+typedef struct {
+    uint32_t     magic;
+    uint32_t     anchored;                        // Bitmask of zones with a valid anchor
+    int64_t      anchor_us[PLANNER_MAX_ZONES];    // Per-zone cycle anchor
+    int64_t      epoch_us;                        // Start of the planned window
+    int64_t      end_us;                          // End of the planned window
+    uint16_t     count;
+    uint16_t     next;                            // Index of the next pending event
+    plan_event_t events[PLANNER_MAX_EVENTS];
+} plan_t;
+
+// Drop the compiled plan and all anchors so the next build starts fresh.
+void planner_invalidate(plan_t *plan);
+
+// True if there is no plan or the planned window has been fully consumed.
+bool planner_needs_build(const plan_t *plan, int64_t now_us);
+
+// Compile all zone rules into a sorted event table for the next window. Continues
+// from the end of the previous window, so it is cheap to call once per day. Built late,
+// cycles that would still be running now are kept and start at once, shortened to their
+// planned stop; cycles that would already have ended are left out.
+void planner_build(plan_t *plan, const zone_rule_t *rules, int zone_count, int64_t now_us);
+
+// Re-plan a single zone after its rule changed. Other zones' events are kept as they
+// are and a pending stop for a cycle that is already running is preserved.
+void planner_replan_zone(plan_t *plan, const zone_rule_t *rules, int zone, int64_t now_us);
+
+// Move a zone's next pending stop to stop_at_us, e.g. to shorten a cycle the water
+// budget could not cover in full. Returns false if the zone has no pending stop.
+bool planner_trim_cycle(plan_t *plan, int zone, int64_t stop_at_us);
+
+// Replace the rest of the current cycle of every zone in zone_mask (its pending events
+// up to its next start) with the given events, e.g. pulse-and-soak splits. With no
+// events this drops the rest of the cycle.
+// Returns false and leaves the plan untouched if the events do not fit.
+bool planner_replace_cycles(plan_t *plan, uint32_t zone_mask, const plan_event_t *events, int count);
+
+// Called with each cycle's start event, returns the percentage of its duration to keep
+typedef uint8_t (*planner_scale_fn)(const plan_event_t *start, void *ctx);
+
+// Shrink or drop whole cycles starting at or after from_us, e.g. ahead of forecast rain.
+// A result of 0 drops the cycle, 100 or more leaves it as it is.
+void planner_scale_cycles(plan_t *plan, int64_t from_us, planner_scale_fn scale, void *ctx);
+
+// Anchor a zone's cycles at anchor_us. Takes effect on the next build or replan.
+void planner_set_anchor(plan_t *plan, int zone, int64_t anchor_us);
+
+// True if the zone's current cycle has pulses still to come, e.g. after a soak
+bool planner_cycle_continues(const plan_t *plan, int zone);
+
+// Next pending event, or NULL if the window is exhausted.
+const plan_event_t *planner_peek(const plan_t *plan);
+
+// Time the controller must wake next: the next event, or the end of the window.
+int64_t planner_next_wake_us(const plan_t *plan);
+
+// Time of the next pending cycle start, or INT64_MAX if the window has none left.
+int64_t planner_next_start_us(const plan_t *plan);
+
+// Time of the zone's next pending stop, or INT64_MAX if it has none.
+int64_t planner_next_stop_us(const plan_t *plan, int zone);
+
+// Pop the next event if it is due at now_us. Returns false if nothing is due.
+bool planner_pop_due(plan_t *plan, int64_t now_us, plan_event_t *out);
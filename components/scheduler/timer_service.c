@@ -0,0 +1,91 @@
+#include "timer_service.h"
+
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "board_hal.h"
+
+#define TAG "TIMER_SERVICE"
+
+static timer_wheel_t wheel;
+static hal_timer_t oneshot;
+static SemaphoreHandle_t lock;
+static QueueHandle_t queue;
+static uint64_t armed_tick = WHEEL_NEVER;
+
+static uint64_t now_tick(void)
+{
+    return (uint64_t)hal_time_us() / TIMER_SERVICE_TICK_US;
+}
+
+static void dispatch(wheel_timer_t *timer, void *ctx)
+{
+    control_event_t ev = control_event_unpack(timer->event);
+
+    if (xQueueSend(queue, &ev, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Control queue full, dropped event %d", ev.type);
+    }
+}
+
+// Point the hardware one-shot at the wheel's next expiry. Called with the lock held.
+static void rearm(void)
+{
+    uint64_t next = timer_wheel_next_tick(&wheel);
+
+    if (next == armed_tick) {
+        return;
+    }
+    armed_tick = next;
+    if (next == WHEEL_NEVER) {
+        hal_timer_stop(oneshot);
+        return;
+    }
+    hal_timer_start_at(oneshot, (int64_t)(next * TIMER_SERVICE_TICK_US));
+}
+
+static void oneshot_callback(void *arg)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    armed_tick = WHEEL_NEVER;
+    timer_wheel_advance(&wheel, now_tick());
+    rearm();
+    xSemaphoreGive(lock);
+}
+
+esp_err_t timer_service_init(QueueHandle_t control_queue)
+{
+    queue = control_queue;
+    lock = xSemaphoreCreateMutex();
+    if (lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer_wheel_init(&wheel, now_tick(), dispatch, NULL);
+    return hal_timer_create(oneshot_callback, NULL, "timer_wheel", &oneshot);
+}
+
+void timer_service_start(wheel_timer_t *timer, int64_t at_us, control_event_t event)
+{
+    // Round up so a timer never fires before its deadline
+    uint64_t tick = (at_us > 0) ? ((uint64_t)at_us + TIMER_SERVICE_TICK_US - 1) / TIMER_SERVICE_TICK_US : 0;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    timer->event = control_event_pack(event);
+    timer_wheel_add(&wheel, timer, tick);
+    rearm();
+    xSemaphoreGive(lock);
+}
+
+void timer_service_cancel(wheel_timer_t *timer)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    timer_wheel_cancel(&wheel, timer);
+    rearm();
+    xSemaphoreGive(lock);
+}
+
+int64_t timer_service_next_us(void)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint64_t next = timer_wheel_next_tick(&wheel);
+    xSemaphoreGive(lock);
+    return (next == WHEEL_NEVER) ? INT64_MAX : (int64_t)(next * TIMER_SERVICE_TICK_US);
+}
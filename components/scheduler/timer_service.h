@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "control.h"
+#include "timer_wheel.h"
+
+// ===== TIMER SERVICE CONFIGURATION =====
+#define TIMER_SERVICE_TICK_US    10000             // Wheel resolution (10 ms)
+
+// All logical timers share one timing wheel driven by a single HAL one-shot timer.
+// Expired timers post their event straight into the control queue.
+esp_err_t timer_service_init(QueueHandle_t control_queue);
+
+// Arm (or re-arm) a logical timer for an absolute hal_time_us() time.
+void timer_service_start(wheel_timer_t *timer, int64_t at_us, control_event_t event);
+
+void timer_service_cancel(wheel_timer_t *timer);
+
+// Earliest pending deadline, INT64_MAX if no timer is armed
+int64_t timer_service_next_us(void);
@@ -0,0 +1,172 @@
+#include "timer_wheel.h"
+
+#include <string.h>
+
+#define SLOT_MASK                (WHEEL_SLOTS - 1)
+
+static inline uint64_t rotr64(uint64_t v, unsigned n)
+{
+    n &= 63;
+    return n ? (v >> n) | (v << (64 - n)) : v;
+}
+
+static void link_timer(timer_wheel_t *wheel, wheel_timer_t *timer)
+{
+    uint64_t delta = timer->expires - wheel->now;
+    uint64_t place = timer->expires;
+    unsigned level = 0;
+
+    // Timers further out than the top level covers are parked there and re-placed on cascade
+    if (delta > WHEEL_MAX_DELTA) {
+        delta = WHEEL_MAX_DELTA;
+        place = wheel->now + WHEEL_MAX_DELTA;
+    }
+    if (delta >= WHEEL_SLOTS) {
+        level = (63 - __builtin_clzll(delta)) / WHEEL_LEVEL_BITS;
+    }
+
+    unsigned slot = (place >> (level * WHEEL_LEVEL_BITS)) & SLOT_MASK;
+    wheel_timer_t **head = &wheel->slots[level][slot];
+
+    timer->level = level;
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = *head;
+    if (*head) {
+        (*head)->prev = timer;
+    }
+    *head = timer;
+    wheel->occupied[level] |= 1ULL << slot;
+}
+
+static void unlink_timer(timer_wheel_t *wheel, wheel_timer_t *timer)
+{
+    wheel_timer_t **head = &wheel->slots[timer->level][timer->slot];
+
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        *head = timer->next;
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    if (*head == NULL) {
+        wheel->occupied[timer->level] &= ~(1ULL << timer->slot);
+    }
+    timer->next = timer->prev = NULL;
+}
+
+// Move every timer of one upper-level slot down to the level that now covers it
+static void cascade(timer_wheel_t *wheel, unsigned level, unsigned slot)
+{
+    wheel_timer_t *timer = wheel->slots[level][slot];
+
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~(1ULL << slot);
+    while (timer) {
+        wheel_timer_t *next = timer->next;
+        link_timer(wheel, timer);
+        timer = next;
+    }
+}
+
+void timer_wheel_init(timer_wheel_t *wheel, uint64_t now_tick, wheel_dispatch_t dispatch, void *ctx)
+{
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now_tick;
+    wheel->dispatch = dispatch;
+    wheel->ctx = ctx;
+}
+
+void timer_wheel_add(timer_wheel_t *wheel, wheel_timer_t *timer, uint64_t expires_tick)
+{
+    if (timer->pending) {
+        unlink_timer(wheel, timer);
+        wheel->pending--;
+    }
+    timer->expires = (expires_tick < wheel->now) ? wheel->now : expires_tick;
+    timer->pending = true;
+    link_timer(wheel, timer);
+    wheel->pending++;
+}
+
+void timer_wheel_cancel(timer_wheel_t *wheel, wheel_timer_t *timer)
+{
+    if (!timer->pending) {
+        return;
+    }
+    unlink_timer(wheel, timer);
+    timer->pending = false;
+    wheel->pending--;
+}
+
+uint64_t timer_wheel_next_tick(const timer_wheel_t *wheel)
+{
+    uint64_t best = WHEEL_NEVER;
+
+    if (wheel->occupied[0]) {
+        unsigned cur = wheel->now & SLOT_MASK;
+        best = wheel->now + __builtin_ctzll(rotr64(wheel->occupied[0], cur));
+    }
+    // An upper slot needs attention at the first aligned tick that maps to it
+    for (unsigned level = 1; level < WHEEL_LEVELS; level++) {
+        if (!wheel->occupied[level]) {
+            continue;
+        }
+        unsigned shift = level * WHEEL_LEVEL_BITS;
+        uint64_t unit = (wheel->now + (1ULL << shift) - 1) >> shift;
+        unsigned cur = unit & SLOT_MASK;
+        uint64_t tick = (unit + __builtin_ctzll(rotr64(wheel->occupied[level], cur))) << shift;
+        if (tick < best) {
+            best = tick;
+        }
+    }
+    return best;
+}
+
+static uint32_t process_tick(timer_wheel_t *wheel, uint64_t tick)
+{
+    uint32_t fired = 0;
+
+    wheel->now = tick;
+    if ((tick & SLOT_MASK) == 0) {
+        for (unsigned level = 1; level < WHEEL_LEVELS; level++) {
+            unsigned slot = (tick >> (level * WHEEL_LEVEL_BITS)) & SLOT_MASK;
+            cascade(wheel, level, slot);
+            if (slot != 0) {
+                break;
+            }
+        }
+    }
+
+    // Dispatch may add or cancel timers, so always restart from the slot head
+    wheel_timer_t **head = &wheel->slots[0][tick & SLOT_MASK];
+    while (*head) {
+        wheel_timer_t *timer = *head;
+        unlink_timer(wheel, timer);
+        timer->pending = false;
+        wheel->pending--;
+        fired++;
+        wheel->dispatch(timer, wheel->ctx);
+    }
+    wheel->now = tick + 1;
+    return fired;
+}
+
+uint32_t timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_tick)
+{
+    uint32_t fired = 0;
+
+    while (wheel->pending) {
+        uint64_t tick = timer_wheel_next_tick(wheel);
+        if (tick > now_tick) {
+            break;
+        }
+        fired += process_tick(wheel, tick);
+    }
+    if (wheel->now <= now_tick) {
+        wheel->now = now_tick + 1;
+    }
+    return fired;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== WHEEL CONFIGURATION =====
+#define WHEEL_LEVEL_BITS         6
+#define WHEEL_SLOTS              (1 << WHEEL_LEVEL_BITS)
+#define WHEEL_LEVELS             5                 // 2^30 ticks before timers are clamped
+#define WHEEL_MAX_DELTA          ((1ULL << (WHEEL_LEVEL_BITS * WHEEL_LEVELS)) - 1)
+#define WHEEL_NEVER              UINT64_MAX
+
+// Intrusive timer node. The owner keeps the storage; the wheel only links it.
+typedef struct wheel_timer {
+    struct wheel_timer *next;
+    struct wheel_timer *prev;
+    uint64_t expires;          // Absolute expiry tick
+    uint32_t event;            // Payload handed to the dispatch callback
+    uint8_t  level;
+    uint8_t  slot;
+    bool     pending;
+} wheel_timer_t;
+
+typedef void (*wheel_dispatch_t)(wheel_timer_t *timer, void *ctx);
+
+// Hierarchical timing wheel. Level L slots are 64^L ticks wide, so insert and cancel
+// are O(1) and finding the next expiry is O(levels) via per-level occupancy masks.
+typedef struct {
+    uint64_t         now;                          // Next tick to be processed
+    uint64_t         occupied[WHEEL_LEVELS];
+    wheel_timer_t   *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    wheel_dispatch_t dispatch;
+    void            *ctx;
+    uint32_t         pending;
+} timer_wheel_t;
+
+void timer_wheel_init(timer_wheel_t *wheel, uint64_t now_tick, wheel_dispatch_t dispatch, void *ctx);
+
+// Schedule (or reschedule) a timer at an absolute tick. Ticks in the past fire on the next advance.
+void timer_wheel_add(timer_wheel_t *wheel, wheel_timer_t *timer, uint64_t expires_tick);
+
+// Remove a pending timer. Safe to call on a timer that already fired.
+void timer_wheel_cancel(timer_wheel_t *wheel, wheel_timer_t *timer);
+
+// Earliest tick at which the wheel has work to do, or WHEEL_NEVER if it is empty.
+// This is where the single hardware one-shot has to be armed.
+uint64_t timer_wheel_next_tick(const timer_wheel_t *wheel);
+
+// Process every tick up to and including now_tick, dispatching expired timers.
+// Returns the number of timers dispatched.
+uint32_t timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_tick);
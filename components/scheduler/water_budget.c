@@ -0,0 +1,108 @@
+#include "water_budget.h"
+
+#define VALUE_SCALE              1024              // Value of fully satisfying a priority 1 zone
+#define NEG_INF                  INT32_MIN
+
+uint32_t water_budget_demand_ml(uint8_t moisture_pct, uint8_t target_pct, uint8_t dry_pct, uint32_t full_ml)
+{
+    if (moisture_pct >= target_pct || target_pct <= dry_pct) {
+        return 0;
+    }
+    if (moisture_pct <= dry_pct) {
+        return full_ml;
+    }
+    return (uint32_t)((uint64_t)full_ml * (target_pct - moisture_pct) / (target_pct - dry_pct));
+}
+
+static uint32_t div_ceil(uint32_t a, uint32_t b)
+{
+    return (a + b - 1) / b;
+}
+
+// Value of giving a zone q quanta, or NEG_INF if the dose is below its useful minimum
+static int32_t dose_value(const budget_zone_t *zone, uint32_t quantum_ml, uint32_t q)
+{
+    uint32_t ml = q * quantum_ml;
+
+    if (q == 0) {
+        return 0;
+    }
+    if (ml < zone->min_ml) {
+        return NEG_INF;
+    }
+    if (ml > zone->demand_ml) {
+        ml = zone->demand_ml;
+    }
+    // +1 so leftover water still goes to priority 0 zones rather than being wasted
+    return (int32_t)(((uint64_t)zone->priority * VALUE_SCALE + 1) * ml / zone->demand_ml);
+}
+
+uint32_t water_budget_solve(const budget_zone_t *zones, int zone_count, uint32_t available_ml,
+                            uint32_t *alloc_ml, budget_workspace_t *ws)
+{
+    uint32_t total_demand = 0;
+    uint32_t total = 0;
+
+    if (zone_count > BUDGET_MAX_ZONES) {
+        zone_count = BUDGET_MAX_ZONES;
+    }
+    for (int z = 0; z < zone_count; z++) {
+        total_demand += zones[z].demand_ml;
+        alloc_ml[z] = 0;
+    }
+
+    // Fast path: enough water for everyone
+    if (total_demand <= available_ml) {
+        for (int z = 0; z < zone_count; z++) {
+            alloc_ml[z] = zones[z].demand_ml;
+        }
+        return total_demand;
+    }
+    if (available_ml == 0) {
+        return 0;
+    }
+
+    // Round the quantum up so a full plan can never exceed the tank
+    uint32_t quantum_ml = div_ceil(available_ml, BUDGET_QUANTA);
+    uint32_t quanta = available_ml / quantum_ml;
+
+    for (uint32_t c = 0; c <= quanta; c++) {
+        ws->best[c] = 0;
+    }
+    for (int z = 0; z < zone_count; z++) {
+        uint32_t max_q = div_ceil(zones[z].demand_ml, quantum_ml);
+        if (max_q > quanta) {
+            max_q = quanta;
+        }
+        for (uint32_t c = 0; c <= quanta; c++) {
+            int32_t best = ws->best[c];
+            uint8_t pick = 0;
+            for (uint32_t q = 1; q <= max_q && q <= c; q++) {
+                int32_t v = dose_value(&zones[z], quantum_ml, q);
+                if (v == NEG_INF) {
+                    continue;
+                }
+                if (ws->best[c - q] + v > best) {
+                    best = ws->best[c - q] + v;
+                    pick = q;
+                }
+            }
+            ws->next[c] = best;
+            ws->choice[z][c] = pick;
+        }
+        for (uint32_t c = 0; c <= quanta; c++) {
+            ws->best[c] = ws->next[c];
+        }
+    }
+
+    // Walk the choices back from the full budget
+    uint32_t c = quanta;
+    for (int z = zone_count - 1; z >= 0; z--) {
+        uint32_t q = ws->choice[z][c];
+        uint32_t ml = q * quantum_ml;
+        alloc_ml[z] = (ml > zones[z].demand_ml) ? zones[z].demand_ml : ml;
+        total += alloc_ml[z];
+        c -= q;
+    }
+    return total;
+}
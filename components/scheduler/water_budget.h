@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== BUDGET CONFIGURATION =====
+#define BUDGET_MAX_ZONES         64
+#define BUDGET_QUANTA            128               // Tank volume is split into this many units for the DP
+
+typedef struct {
+    uint32_t demand_ml;        // Volume the zone wants this cycle
+    uint32_t min_ml;           // Smallest dose worth delivering; less is treated as nothing
+    uint8_t  priority;         // Relative weight, 0 = only water with leftovers
+} budget_zone_t;
+
+// Working memory for the solver. Owned by the caller so solving never allocates.
+typedef struct {
+    int32_t best[BUDGET_QUANTA + 1];
+    int32_t next[BUDGET_QUANTA + 1];
+    uint8_t choice[BUDGET_MAX_ZONES][BUDGET_QUANTA + 1];
+} budget_workspace_t;
+
+// Demand derived from soil moisture: the fraction of full_ml needed to bring
+// moisture_pct back up to target_pct from dry_pct.
+uint32_t water_budget_demand_ml(uint8_t moisture_pct, uint8_t target_pct, uint8_t dry_pct, uint32_t full_ml);
+
+// Split available_ml across zones, writing each zone's volume to alloc_ml.
+// Every zone gets its full demand when it fits. Otherwise a multiple-choice knapsack
+// over BUDGET_QUANTA volume units maximises sum(priority * fraction of demand met)
+// in O(zones * quanta^2) time and fixed memory. Returns the total volume allocated.
+uint32_t water_budget_solve(const budget_zone_t *zones, int zone_count, uint32_t available_ml,
+                            uint32_t *alloc_ml, budget_workspace_t *ws);
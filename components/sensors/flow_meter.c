@@ -0,0 +1,96 @@
+#include "flow_meter.h"
+
+#include "driver/pulse_cnt.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "control.h"
+
+#define TAG "FLOW_METER"
+#define PCNT_HIGH_LIMIT          30000             // Overflows are folded into the accumulated count
+
+static pcnt_unit_handle_t unit;
+static QueueHandle_t queue;
+static volatile bool idle_armed;
+static uint32_t cleared_pulses;                    // Pulses counted before the last clear
+
+static bool IRAM_ATTR on_reach(pcnt_unit_handle_t u, const pcnt_watch_event_data_t *edata, void *ctx)
+{
+    BaseType_t woken = pdFALSE;
+    control_event_t ev = { .type = CONTROL_EVENT_IDLE_FLOW };
+
+    if (!idle_armed || edata->watch_point_value != FLOW_IDLE_PULSES) {
+        return false;
+    }
+    idle_armed = false;
+    xQueueSendFromISR(queue, &ev, &woken);
+    return woken == pdTRUE;
+}
+
+esp_err_t flow_meter_init(QueueHandle_t control_queue)
+{
+    const pcnt_unit_config_t unit_cfg = {
+        .low_limit = -1,
+        .high_limit = PCNT_HIGH_LIMIT,
+        .flags.accum_count = 1,
+    };
+    const pcnt_chan_config_t chan_cfg = {
+        .edge_gpio_num = FLOW_METER_PIN,
+        .level_gpio_num = -1,
+    };
+    const pcnt_glitch_filter_config_t filter_cfg = {
+        .max_glitch_ns = FLOW_GLITCH_NS,
+    };
+    const pcnt_event_callbacks_t callbacks = {
+        .on_reach = on_reach,
+    };
+    pcnt_channel_handle_t chan;
+
+    queue = control_queue;
+    ESP_RETURN_ON_ERROR(pcnt_new_unit(&unit_cfg, &unit), TAG, "unit");
+    ESP_RETURN_ON_ERROR(pcnt_unit_set_glitch_filter(unit, &filter_cfg), TAG, "filter");
+    ESP_RETURN_ON_ERROR(pcnt_new_channel(unit, &chan_cfg, &chan), TAG, "channel");
+    ESP_RETURN_ON_ERROR(pcnt_channel_set_edge_action(chan, PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+                                                     PCNT_CHANNEL_EDGE_ACTION_HOLD), TAG, "edge action");
+    // The high limit watch point is what makes the driver accumulate overflows
+    ESP_RETURN_ON_ERROR(pcnt_unit_add_watch_point(unit, PCNT_HIGH_LIMIT), TAG, "limit watch");
+    ESP_RETURN_ON_ERROR(pcnt_unit_register_event_callbacks(unit, &callbacks, NULL), TAG, "callbacks");
+    ESP_RETURN_ON_ERROR(pcnt_unit_enable(unit), TAG, "enable");
+    ESP_RETURN_ON_ERROR(pcnt_unit_clear_count(unit), TAG, "clear");
+    return pcnt_unit_start(unit);
+}
+
+uint32_t flow_meter_pulses(void)
+{
+    int count = 0;
+
+    pcnt_unit_get_count(unit, &count);
+    return cleared_pulses + (uint32_t)count;
+}
+
+void flow_meter_set_idle(bool idle)
+{
+    int count = 0;
+
+    idle_armed = false;
+    pcnt_unit_remove_watch_point(unit, FLOW_IDLE_PULSES);
+    if (!idle) {
+        return;
+    }
+    // Restart from zero so the watch point sits exactly FLOW_IDLE_PULSES ahead
+    pcnt_unit_get_count(unit, &count);
+    cleared_pulses += (uint32_t)count;
+    pcnt_unit_clear_count(unit);
+    pcnt_unit_add_watch_point(unit, FLOW_IDLE_PULSES);
+    idle_armed = true;
+}
+
+void flow_meter_suspend(void)
+{
+    pcnt_unit_stop(unit);
+}
+
+void flow_meter_resume(uint32_t pulses)
+{
+    cleared_pulses += pulses;
+    pcnt_unit_start(unit);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "board_config.h"
+
+// ===== FLOW METER CONFIGURATION =====
+#define FLOW_PULSES_PER_L        450               // YF-S201 style sensor
+#define FLOW_GLITCH_NS           1000              // Filter contact bounce and noise
+#define FLOW_IDLE_PULSES         45                // ~100 ml with every valve closed counts as a leak
+
+// Counts flow pulses in the PCNT peripheral, so no CPU time is spent per pulse.
+// While idle a PCNT watch point posts CONTROL_EVENT_IDLE_FLOW to the control queue,
+// so flow with every zone closed is caught without any periodic wakeup.
+esp_err_t flow_meter_init(QueueHandle_t control_queue);
+
+// Total pulses counted since init
+uint32_t flow_meter_pulses(void);
+
+// Arm (true) or disarm (false) the idle flow alarm. Arming restarts its count.
+void flow_meter_set_idle(bool idle);
+
+// Stop PCNT before another counter takes the pin over, e.g. the ULP through a sleep
+void flow_meter_suspend(void);
+
+// Restart PCNT, adding the pulses the other counter saw in the meantime
+void flow_meter_resume(uint32_t pulses);
+
+static inline uint32_t flow_meter_pulses_to_ml(uint32_t pulses)
+{
+    return (uint32_t)((uint64_t)pulses * 1000 / FLOW_PULSES_PER_L);
+}
@@ -0,0 +1,98 @@
+#include "flow_ulp.h"
+
+#include "sdkconfig.h"
+
+#if CONFIG_ULP_COPROC_TYPE_FSM
+
+#include "driver/rtc_io.h"
+#include "esp_check.h"
+#include "esp_sleep.h"
+#include "ulp.h"
+#include "ulp_flow.h"
+#include "board_config.h"
+
+#define TAG "FLOW_ULP"
+#define STALL_TICKS              (FLOW_ULP_STALL_MS * 1000 / FLOW_ULP_PERIOD_US)
+#define WINDOW_TICKS             (FLOW_ULP_WINDOW_MS * 1000 / FLOW_ULP_PERIOD_US)
+
+_Static_assert(STALL_TICKS <= 0xFFFF, "FLOW_ULP_STALL_MS does not fit a ULP word");
+_Static_assert(WINDOW_TICKS > 0 && WINDOW_TICKS <= 0xFFFF, "FLOW_ULP_WINDOW_MS does not fit a ULP word");
+
+extern const uint8_t ulp_flow_bin_start[] asm("_binary_ulp_flow_bin_start");
+extern const uint8_t ulp_flow_bin_end[]   asm("_binary_ulp_flow_bin_end");
+
+static uint32_t target;
+static uint32_t burst;
+
+esp_err_t flow_ulp_init(void)
+{
+    int io = rtc_io_number_get(FLOW_METER_PIN);
+
+    ESP_RETURN_ON_FALSE(io >= 0, ESP_ERR_NOT_SUPPORTED, TAG, "flow pin is not an RTC GPIO");
+    ESP_RETURN_ON_ERROR(ulp_load_binary(0, ulp_flow_bin_start,
+                                        (ulp_flow_bin_end - ulp_flow_bin_start) / sizeof(uint32_t)), TAG, "load");
+    ulp_io_number = io;
+    ulp_debounce_max = FLOW_ULP_DEBOUNCE;
+    ulp_stall_ticks = STALL_TICKS;
+    ulp_window_ticks = WINDOW_TICKS;
+    ESP_RETURN_ON_ERROR(ulp_set_wakeup_period(0, FLOW_ULP_PERIOD_US), TAG, "period");
+    return esp_sleep_enable_ulp_wakeup();
+}
+
+esp_err_t flow_ulp_start(uint32_t target_pulses, uint32_t burst_pulses)
+{
+    target = (target_pulses > FLOW_ULP_MAX_PULSES) ? FLOW_ULP_MAX_PULSES : target_pulses;
+    burst = (burst_pulses > FLOW_ULP_MAX_PULSES) ? FLOW_ULP_MAX_PULSES : burst_pulses;
+
+    // Moves the pad from the GPIO matrix to the RTC domain, where the ULP can read it
+    ESP_RETURN_ON_ERROR(rtc_gpio_init(FLOW_METER_PIN), TAG, "rtc pin");
+    rtc_gpio_set_direction(FLOW_METER_PIN, RTC_GPIO_MODE_INPUT_ONLY);
+    // Wait for the opposite of the current level, so a pulse already high is not counted twice
+    ulp_next_level = !rtc_gpio_get_level(FLOW_METER_PIN);
+    ulp_debounce = FLOW_ULP_DEBOUNCE;
+    ulp_pulses = 0;
+    ulp_idle_ticks = 0;
+    ulp_target_pulses = target;
+    ulp_window_left = WINDOW_TICKS;
+    ulp_window_pulses = 0;
+    ulp_burst_pulses = burst;
+    return ulp_run(&ulp_entry - RTC_SLOW_MEM);
+}
+
+flow_ulp_status_t flow_ulp_stop(uint32_t *pulses)
+{
+    ulp_timer_stop();
+    *pulses = ulp_pulses & 0xFFFF;
+    rtc_gpio_deinit(FLOW_METER_PIN);
+
+    if (burst != 0 && (ulp_window_pulses & 0xFFFF) >= burst) {
+        return FLOW_ULP_BURST;
+    }
+    if (target != 0 && *pulses >= target) {
+        return FLOW_ULP_TARGET;
+    }
+    if ((ulp_idle_ticks & 0xFFFF) >= STALL_TICKS) {
+        return FLOW_ULP_STALLED;
+    }
+    return FLOW_ULP_RUNNING;
+}
+
+#else
+
+esp_err_t flow_ulp_init(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t flow_ulp_start(uint32_t target_pulses, uint32_t burst_pulses)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+flow_ulp_status_t flow_ulp_stop(uint32_t *pulses)
+{
+    *pulses = 0;
+    return FLOW_ULP_RUNNING;
+}
+
+#endif
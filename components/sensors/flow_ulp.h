@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// ===== ULP FLOW COUNTER CONFIGURATION =====
+#define FLOW_ULP_PERIOD_US       1000              // Pin read rate, well above the meter's pulse rate
+#define FLOW_ULP_DEBOUNCE        2                 // Extra reads a new level must hold to count
+#define FLOW_ULP_STALL_MS        3000              // No pulse this long counts as flow stopped
+#define FLOW_ULP_WINDOW_MS       1000              // Burst watch window
+#define FLOW_ULP_MAX_PULSES      0xFFFF            // ULP words are 16 bits
+
+typedef enum {
+    FLOW_ULP_RUNNING = 0,      // Woken by something else, still counting
+    FLOW_ULP_TARGET,           // Target volume reached
+    FLOW_ULP_STALLED,          // No pulse for FLOW_ULP_STALL_MS
+    FLOW_ULP_BURST,            // Burst pulses within one FLOW_ULP_WINDOW_MS window
+} flow_ulp_status_t;
+
+// Counts flow meter pulses on the ULP coprocessor while the main CPU sleeps, so a pulse
+// can run asleep without losing flow. Loads the program and enables ULP wakeups.
+// ESP_ERR_NOT_SUPPORTED on chips without the ULP FSM or if FLOW_METER_PIN is not an RTC GPIO.
+esp_err_t flow_ulp_init(void);
+
+// Take the flow pin over from PCNT and count from zero. Wakes the CPU once target_pulses
+// are counted (0 for no target, clamped to FLOW_ULP_MAX_PULSES), once burst_pulses are
+// counted within one FLOW_ULP_WINDOW_MS window (0 for no burst watch), or if flow stalls.
+// Suspend the flow meter first.
+esp_err_t flow_ulp_start(uint32_t target_pulses, uint32_t burst_pulses);
+
+// Stop counting and hand the pin back. Returns why the ULP woke the CPU, if it did.
+flow_ulp_status_t flow_ulp_stop(uint32_t *pulses);
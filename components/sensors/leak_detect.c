@@ -0,0 +1,118 @@
+#include "leak_detect.h"
+
+void leak_detect_begin(leak_detector_t *det, leak_baseline_t *baseline, uint32_t zone_mask)
+{
+    // A set of zones never teaches any of them, see learn()
+    if (zone_mask & (zone_mask - 1)) {
+        for (int z = 0; z < LEAK_MAX_ZONES; z++) {
+            if ((zone_mask & (1U << z)) && baseline->samples[z] < LEAK_LEARN_SAMPLES
+                && baseline->shared_runs[z] < UINT8_MAX) {
+                baseline->shared_runs[z]++;
+            }
+        }
+    }
+    det->baseline = baseline;
+    det->zones = zone_mask;
+    det->settle = LEAK_SETTLE_SAMPLES;
+    det->cusum_hi = 0;
+    det->cusum_lo = 0;
+}
+
+uint32_t leak_detect_expected(const leak_detector_t *det)
+{
+    uint32_t expected_q8 = 0;
+
+    for (int z = 0; z < LEAK_MAX_ZONES; z++) {
+        if (!(det->zones & (1U << z))) {
+            continue;
+        }
+        if (det->baseline->samples[z] < LEAK_LEARN_SAMPLES) {
+            return 0;
+        }
+        expected_q8 += det->baseline->flow_q8[z];
+    }
+    return expected_q8 >> 8;
+}
+
+uint32_t leak_detect_unlearned(const leak_baseline_t *baseline)
+{
+    uint32_t mask = 0;
+
+    for (int z = 0; z < LEAK_MAX_ZONES; z++) {
+        if (baseline->samples[z] < LEAK_LEARN_SAMPLES && baseline->shared_runs[z] >= LEAK_UNLEARNED_RUNS) {
+            mask |= 1U << z;
+        }
+    }
+    return mask;
+}
+
+// A zone can only be learned while it is the only one open
+static int single_zone(uint32_t mask)
+{
+    if (mask == 0 || (mask & (mask - 1))) {
+        return -1;
+    }
+    return __builtin_ctz(mask);
+}
+
+static void learn(leak_detector_t *det, uint32_t flow_ml_per_min)
+{
+    int z = single_zone(det->zones);
+
+    if (z < 0 || z >= LEAK_MAX_ZONES) {
+        return;
+    }
+    int32_t sample_q8 = (int32_t)(flow_ml_per_min << 8);
+    int32_t base_q8 = (int32_t)det->baseline->flow_q8[z];
+
+    if (det->baseline->samples[z] == 0) {
+        base_q8 = sample_q8;
+    } else if (det->baseline->samples[z] < LEAK_LEARN_SAMPLES) {
+        // Plain running mean until the baseline is trusted
+        base_q8 += (sample_q8 - base_q8) / (det->baseline->samples[z] + 1);
+    } else {
+        base_q8 += (sample_q8 - base_q8) >> LEAK_EWMA_SHIFT;
+    }
+    det->baseline->flow_q8[z] = (uint32_t)base_q8;
+    if (det->baseline->samples[z] < UINT16_MAX) {
+        det->baseline->samples[z]++;
+    }
+}
+
+leak_status_t leak_detect_sample(leak_detector_t *det, uint32_t flow_ml_per_min)
+{
+    if (det->settle) {
+        det->settle--;
+        return LEAK_LEARNING;
+    }
+
+    int32_t expected = (int32_t)leak_detect_expected(det);
+    if (expected == 0) {
+        learn(det, flow_ml_per_min);
+        return LEAK_LEARNING;
+    }
+
+    int32_t slack = expected * LEAK_SLACK_PCT / 100;
+    int32_t limit = expected * LEAK_LIMIT_PCT / 100;
+    int32_t x = (int32_t)flow_ml_per_min;
+
+    det->cusum_hi += x - expected - slack;
+    if (det->cusum_hi < 0) {
+        det->cusum_hi = 0;
+    }
+    det->cusum_lo += expected - x - slack;
+    if (det->cusum_lo < 0) {
+        det->cusum_lo = 0;
+    }
+
+    if (det->cusum_hi > limit) {
+        return LEAK_BURST;
+    }
+    if (det->cusum_lo > limit) {
+        return LEAK_LOW_FLOW;
+    }
+    if (x > expected - slack && x < expected + slack) {
+        learn(det, flow_ml_per_min);
+    }
+    return LEAK_OK;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== LEAK DETECTION CONFIGURATION =====
+#define LEAK_MAX_ZONES           8
+#define LEAK_LEARN_SAMPLES       30                // Samples before a zone's baseline is trusted
+#define LEAK_EWMA_SHIFT          5                 // Baseline tracks slow drift with weight 1/32
+#define LEAK_SETTLE_SAMPLES      3                 // Ignored after a valve change while the line fills
+#define LEAK_SLACK_PCT           10                // Deviation tolerated without accumulating
+#define LEAK_LIMIT_PCT           150               // Accumulated deviation that raises the alarm
+#define LEAK_UNLEARNED_RUNS      10                // Shared runs before a zone with no baseline is reported
+
+typedef enum {
+    LEAK_OK = 0,
+    LEAK_LEARNING,             // Baseline not trusted yet, sample used for learning only
+    LEAK_BURST,                // Sustained flow above the baseline, e.g. a broken line
+    LEAK_LOW_FLOW,             // Sustained flow below the baseline, e.g. a blocked line
+} leak_status_t;
+
+// Learned per-zone flow. Kept by the caller in RTC memory so it survives sleep.
+typedef struct {
+    uint32_t flow_q8[LEAK_MAX_ZONES];              // ml/min in 24.8 fixed point
+    uint16_t samples[LEAK_MAX_ZONES];
+    uint8_t  shared_runs[LEAK_MAX_ZONES];          // Runs while learning, but never alone, so nothing learned
+} leak_baseline_t;
+
+typedef struct {
+    leak_baseline_t *baseline;
+    uint32_t zones;                                // Zones open during this run
+    uint16_t settle;
+    int32_t  cusum_hi;
+    int32_t  cusum_lo;
+} leak_detector_t;
+
+// Start watching a new set of open zones. Call whenever the valves change.
+void leak_detect_begin(leak_detector_t *det, leak_baseline_t *baseline, uint32_t zone_mask);
+
+// Zones still learning after LEAK_UNLEARNED_RUNS runs with other zones open. A zone is
+// only learned while it is open alone, so a zone that always shares its cycle with
+// another never gets a baseline, and flow on any run that includes it goes unchecked.
+uint32_t leak_detect_unlearned(const leak_baseline_t *baseline);
+
+// Feed one flow sample. Compares it against the summed baselines of the open zones
+// with a two-sided CUSUM test, and refines the baseline while flow is in control.
+leak_status_t leak_detect_sample(leak_detector_t *det, uint32_t flow_ml_per_min);
+
+// Expected flow of the open zones in ml/min, or 0 while any of them is still learning.
+uint32_t leak_detect_expected(const leak_detector_t *det);
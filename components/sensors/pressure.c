@@ -0,0 +1,35 @@
+#include "pressure.h"
+
+pressure_status_t pressure_check_start(const pressure_config_t *cfg, uint16_t kpa)
+{
+    return (kpa < cfg->min_start_kpa) ? PRESSURE_LOW_SUPPLY : PRESSURE_OK;
+}
+
+pressure_status_t pressure_check_running(const pressure_config_t *cfg, uint16_t kpa,
+                                         uint32_t flow_ml_per_min, uint32_t expected_ml_per_min)
+{
+    uint32_t low_flow = expected_ml_per_min ? expected_ml_per_min * cfg->low_flow_pct / 100
+                                            : cfg->min_flow_ml_per_min;
+
+    if (kpa < cfg->min_running_kpa) {
+        return PRESSURE_LOW_SUPPLY;
+    }
+    if (kpa >= cfg->blocked_kpa && flow_ml_per_min < low_flow) {
+        return PRESSURE_BLOCKED;
+    }
+    return PRESSURE_OK;
+}
+
+uint16_t pressure_median(uint16_t *samples, int count)
+{
+    for (int i = 1; i < count; i++) {
+        uint16_t v = samples[i];
+        int j = i;
+        while (j > 0 && samples[j - 1] > v) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = v;
+    }
+    return samples[count / 2];
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+    PRESSURE_OK = 0,
+    PRESSURE_LOW_SUPPLY,       // Not enough line pressure, pumping would be wasted energy
+    PRESSURE_BLOCKED,          // Pressure builds but water does not move
+} pressure_status_t;
+
+typedef struct {
+    uint16_t min_start_kpa;        // Supply pressure needed before the pump is started
+    uint16_t min_running_kpa;      // Below this while pumping the supply has failed
+    uint16_t blocked_kpa;          // At or above this with low flow the line is blocked
+    uint8_t  low_flow_pct;         // Flow below this share of the expected rate counts as low
+    uint32_t min_flow_ml_per_min;  // Low flow threshold while the zone's baseline is unknown
+} pressure_config_t;
+
+// Check supply pressure sampled just before the pump is switched on
+pressure_status_t pressure_check_start(const pressure_config_t *cfg, uint16_t kpa);
+
+// Classify a pressure burst taken while pumping. expected_ml_per_min is 0 if unknown.
+pressure_status_t pressure_check_running(const pressure_config_t *cfg, uint16_t kpa,
+                                         uint32_t flow_ml_per_min, uint32_t expected_ml_per_min);
+
+// Median of a burst of raw samples, sorting them in place. Rejects pump ripple and spikes.
+uint16_t pressure_median(uint16_t *samples, int count);
@@ -0,0 +1,176 @@
+#include "sensors.h"
+
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "control.h"
+#include "board_hal.h"
+#include "pressure.h"
+
+#define TAG "SENSORS"
+
+static adc_channel_t moisture_channel[SENSORS_MAX_ZONES];
+static int moisture_count;
+static bool power_held;                            // Tank watch keeps the supply on between reads
+static QueueHandle_t tank_queue;
+
+// Averages raw counts, or millivolts with hal_adc_read_mv
+static esp_err_t read_average(hal_err_t (*read)(int, int *), adc_channel_t channel, int *out)
+{
+    int sum = 0;
+
+    for (int i = 0; i < SENSOR_OVERSAMPLE; i++) {
+        int v;
+        ESP_RETURN_ON_ERROR(read(channel, &v), TAG, "read failed");
+        sum += v;
+    }
+    *out = sum / SENSOR_OVERSAMPLE;
+    return ESP_OK;
+}
+
+// Linear map of raw between from and to onto 0..scale, clamped
+static uint32_t scale_raw(int raw, int from, int to, uint32_t scale)
+{
+    int64_t v = (int64_t)(raw - from) * scale / (to - from);
+
+    if (v < 0) {
+        return 0;
+    }
+    return (v > scale) ? scale : (uint32_t)v;
+}
+
+static void power_off(void)
+{
+    if (!power_held) {
+        hal_output_set(SENSOR_POWER_PIN, false);
+    }
+}
+
+// Beta equation for the NTC half of a divider, in tenths of a degree C
+static int16_t ntc_to_dc(int raw)
+{
+    const int full_scale = 4095;
+
+    if (raw <= 0 || raw >= full_scale) {
+        return TEMP_INVALID_DC;
+    }
+    float r = (float)TEMP_FIXED_R_OHM * raw / (full_scale - raw);
+    float inv_t = 1.0f / 298.15f + logf(r / TEMP_NTC_R25_OHM) / TEMP_NTC_BETA;
+    return (int16_t)lroundf((1.0f / inv_t - 273.15f) * 10);
+}
+
+esp_err_t sensors_init(const adc_channel_t *moisture_channels, int zone_count)
+{
+    ESP_RETURN_ON_ERROR(hal_output_init(1ULL << SENSOR_POWER_PIN), TAG, "power pin");
+
+    ESP_RETURN_ON_ERROR(hal_adc_init(), TAG, "adc unit");
+    ESP_RETURN_ON_ERROR(hal_adc_config(TANK_LEVEL_CHANNEL), TAG, "tank channel");
+    ESP_RETURN_ON_ERROR(hal_adc_config(TEMP_NTC_CHANNEL), TAG, "temperature channel");
+    ESP_RETURN_ON_ERROR(hal_adc_config(PRESSURE_CHANNEL), TAG, "pressure channel");
+    ESP_RETURN_ON_ERROR(hal_adc_config(BATTERY_CHANNEL), TAG, "battery channel");
+
+    moisture_count = (zone_count > SENSORS_MAX_ZONES) ? SENSORS_MAX_ZONES : zone_count;
+    for (int z = 0; z < moisture_count; z++) {
+        moisture_channel[z] = moisture_channels[z];
+        ESP_RETURN_ON_ERROR(hal_adc_config(moisture_channel[z]), TAG, "moisture channel");
+    }
+    return ESP_OK;
+}
+
+esp_err_t sensors_sample(sensor_epoch_t *epoch)
+{
+    esp_err_t err;
+    int raw;
+
+    hal_output_set(SENSOR_POWER_PIN, true);
+    vTaskDelay(pdMS_TO_TICKS(SENSOR_SETTLE_MS));
+
+    epoch->at_us = hal_time_us();
+    err = read_average(hal_adc_read, TANK_LEVEL_CHANNEL, &raw);
+    if (err == ESP_OK) {
+        epoch->tank_ml = scale_raw(raw, TANK_EMPTY_RAW, TANK_FULL_RAW, TANK_CAPACITY_ML);
+    }
+    if (err == ESP_OK) {
+        err = read_average(hal_adc_read, TEMP_NTC_CHANNEL, &raw);
+        epoch->temp_dc = (err == ESP_OK) ? ntc_to_dc(raw) : TEMP_INVALID_DC;
+    }
+    if (err == ESP_OK) {
+        int mv;
+        err = read_average(hal_adc_read_mv, BATTERY_CHANNEL, &mv);
+        epoch->battery_pct = scale_raw(mv, BATTERY_EMPTY_MV, BATTERY_FULL_MV, 100);
+    }
+    for (int z = 0; z < moisture_count && err == ESP_OK; z++) {
+        err = read_average(hal_adc_read, moisture_channel[z], &raw);
+        if (err == ESP_OK) {
+            epoch->moisture_pct[z] = scale_raw(raw, MOISTURE_DRY_RAW, MOISTURE_WET_RAW, 100);
+        }
+    }
+
+    power_off();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Sampling failed: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t sensors_pressure_burst(uint16_t *kpa)
+{
+    uint16_t samples[PRESSURE_BURST];
+    esp_err_t err = ESP_OK;
+
+    hal_output_set(SENSOR_POWER_PIN, true);
+    vTaskDelay(pdMS_TO_TICKS(PRESSURE_SETTLE_MS) + 1);
+    for (int i = 0; i < PRESSURE_BURST && err == ESP_OK; i++) {
+        int raw;
+        err = hal_adc_read(PRESSURE_CHANNEL, &raw);
+        samples[i] = (uint16_t)raw;
+    }
+    power_off();
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Pressure burst failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    *kpa = (uint16_t)scale_raw(pressure_median(samples, PRESSURE_BURST),
+                               PRESSURE_ZERO_RAW, PRESSURE_FULL_RAW, PRESSURE_FULL_KPA);
+    return ESP_OK;
+}
+
+static bool IRAM_ATTR on_tank_low(bool high, void *arg)
+{
+    BaseType_t woken = pdFALSE;
+    control_event_t ev = { .type = CONTROL_EVENT_TANK_LOW };
+
+    xQueueSendFromISR(tank_queue, &ev, &woken);
+    return woken == pdTRUE;
+}
+
+esp_err_t sensors_watch_tank(uint32_t low_ml, QueueHandle_t queue)
+{
+    int low_raw = TANK_EMPTY_RAW + (int)((int64_t)low_ml * (TANK_FULL_RAW - TANK_EMPTY_RAW) / TANK_CAPACITY_ML);
+
+    tank_queue = queue;
+    power_held = true;
+    hal_output_set(SENSOR_POWER_PIN, true);
+    vTaskDelay(pdMS_TO_TICKS(SENSOR_SETTLE_MS));
+    return hal_adc_monitor_start(TANK_LEVEL_CHANNEL, low_raw, -1, on_tank_low, NULL);
+}
+
+void sensors_unwatch_tank(void)
+{
+    hal_adc_monitor_stop();
+    power_held = false;
+    power_off();
+}
+
+esp_err_t sensors_tank_ml(uint32_t *ml)
+{
+    int raw;
+
+    ESP_RETURN_ON_ERROR(read_average(hal_adc_read, TANK_LEVEL_CHANNEL, &raw), TAG, "tank");
+    *ml = scale_raw(raw, TANK_EMPTY_RAW, TANK_FULL_RAW, TANK_CAPACITY_ML);
+    return ESP_OK;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "esp_adc/adc_oneshot.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "board_config.h"
+
+// ===== SENSOR CONFIGURATION =====
+#define SENSOR_SETTLE_MS         20                // Time for sensor outputs to settle after power-up
+#define SENSOR_OVERSAMPLE        8                 // Conversions averaged per reading
+#define SENSORS_MAX_ZONES        8
+
+#define TANK_EMPTY_RAW           300               // Level sensor reading with an empty tank
+#define TANK_FULL_RAW            3500              // Level sensor reading with a full tank
+#define TANK_CAPACITY_ML         200000
+
+#define TEMP_NTC_R25_OHM         10000             // NTC resistance at 25 C
+#define TEMP_NTC_BETA            3950
+#define TEMP_FIXED_R_OHM         10000
+#define TEMP_INVALID_DC          INT16_MIN         // Reported when the NTC reads open or shorted
+
+#define PRESSURE_ZERO_RAW        420               // Reading at 0 kPa
+#define PRESSURE_FULL_RAW        3780              // Reading at PRESSURE_FULL_KPA
+#define PRESSURE_FULL_KPA        1200
+#define PRESSURE_BURST           15                // Conversions per burst, median taken
+#define PRESSURE_SETTLE_MS       5
+
+#define BATTERY_EMPTY_MV         1650              // 3.3 V cell
+#define BATTERY_FULL_MV          2100              // 4.2 V cell
+
+#define MOISTURE_DRY_RAW         3000              // Capacitive probe in dry air
+#define MOISTURE_WET_RAW         1200              // Capacitive probe in water
+
+// Everything read during one sensor power-up
+typedef struct {
+    int64_t  at_us;
+    uint32_t tank_ml;
+    int16_t  temp_dc;          // Air temperature in tenths of a degree C
+    uint8_t  battery_pct;
+    uint8_t  moisture_pct[SENSORS_MAX_ZONES];
+} sensor_epoch_t;
+
+esp_err_t sensors_init(const adc_channel_t *moisture_channels, int zone_count);
+
+// Power the sensors, read every input once and power them down again
+esp_err_t sensors_sample(sensor_epoch_t *epoch);
+
+// Short burst of pressure conversions, only taken around pump events
+esp_err_t sensors_pressure_burst(uint16_t *kpa);
+
+// Keep the sensors powered and post CONTROL_EVENT_TANK_LOW once the tank drops below
+// low_ml, from the ADC threshold monitor without any CPU wakeups. ESP_ERR_NOT_SUPPORTED
+// on chips without the monitor, where the sensors stay powered for sensors_tank_ml polls.
+esp_err_t sensors_watch_tank(uint32_t low_ml, QueueHandle_t queue);
+
+// Stop watching and power the sensors down again
+void sensors_unwatch_tank(void);
+
+// Tank level from one oversampled reading, for polling while watched
+esp_err_t sensors_tank_ml(uint32_t *ml);
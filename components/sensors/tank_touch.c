@@ -0,0 +1,169 @@
+#include "tank_touch.h"
+
+#include "sdkconfig.h"
+#include "soc/soc_caps.h"
+
+#if SOC_TOUCH_SENSOR_VERSION == 1
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/touch_pad.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "board_hal.h"
+#include "board_config.h"
+
+#define TAG "TANK_TOUCH"
+#define STORE_NS                 "tank"
+#define STORE_KEY                "touch_cal"       // Not "touch_dry": that one was taken at first boot, wet or not
+
+typedef struct {
+    uint16_t low;
+    uint16_t high;
+} touch_dry_t;
+
+static touch_dry_t dry;
+static bool calibrated;
+static bool wake_armed;
+static RTC_DATA_ATTR bool tank_low;
+
+// Water on an electrode adds capacitance, which lowers the reading
+static uint16_t wet_below(uint16_t dry_value)
+{
+    return (uint16_t)((uint32_t)dry_value * TANK_TOUCH_WET_PCT / 100);
+}
+
+static esp_err_t read_pads(touch_dry_t *seen)
+{
+    ESP_RETURN_ON_ERROR(touch_pad_read_filtered(TANK_LOW_TOUCH_PAD, &seen->low), TAG, "low pad");
+    return touch_pad_read_filtered(TANK_HIGH_TOUCH_PAD, &seen->high);
+}
+
+// Dry is the highest a pad reads, so once an operator has set the baseline the stored
+// values only ever move up. Without one nothing is trusted: a node first powered with
+// the electrodes under water would take wet as dry and never see the tank refilled.
+static esp_err_t calibrate(void)
+{
+    touch_dry_t seen, stored;
+    size_t len = sizeof(stored);
+
+    if (hal_storage_read(STORE_NS, STORE_KEY, &stored, &len) != HAL_OK || len != sizeof(stored)) {
+        ESP_LOGW(TAG, "Not calibrated, the electrodes are ignored until they are taken as dry");
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(read_pads(&seen), TAG, "read");
+    calibrated = true;
+    dry.low = (seen.low > stored.low) ? seen.low : stored.low;
+    dry.high = (seen.high > stored.high) ? seen.high : stored.high;
+    if (dry.low != stored.low || dry.high != stored.high) {
+        return hal_storage_write(STORE_NS, STORE_KEY, &dry, sizeof(dry));
+    }
+    return ESP_OK;
+}
+
+// Only a low tank has anything to wake for: the upper electrode going under water
+static void arm_wakeup(void)
+{
+    wake_armed = false;
+    if (!tank_low) {
+        touch_pad_set_thresh(TANK_HIGH_TOUCH_PAD, 0);
+        esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TOUCHPAD);
+        return;
+    }
+    touch_pad_set_trigger_mode(TOUCH_TRIGGER_BELOW);
+    touch_pad_set_thresh(TANK_HIGH_TOUCH_PAD, wet_below(dry.high));
+    esp_err_t err = esp_sleep_enable_touchpad_wakeup();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Refill wakeup unavailable: %s", esp_err_to_name(err));
+        return;
+    }
+    wake_armed = true;
+}
+
+esp_err_t tank_touch_init(void)
+{
+    ESP_RETURN_ON_ERROR(touch_pad_init(), TAG, "init");
+    ESP_RETURN_ON_ERROR(touch_pad_set_fsm_mode(TOUCH_FSM_MODE_TIMER), TAG, "fsm");
+    ESP_RETURN_ON_ERROR(touch_pad_set_voltage(TOUCH_HVOLT_2V7, TOUCH_LVOLT_0V5, TOUCH_HVOLT_ATTEN_1V), TAG, "voltage");
+    ESP_RETURN_ON_ERROR(touch_pad_set_measurement_interval(TANK_TOUCH_SLEEP_CYCLES), TAG, "interval");
+    // Threshold 0 never triggers below, so neither pad wakes the chip until armed
+    ESP_RETURN_ON_ERROR(touch_pad_config(TANK_LOW_TOUCH_PAD, 0), TAG, "low pad");
+    ESP_RETURN_ON_ERROR(touch_pad_config(TANK_HIGH_TOUCH_PAD, 0), TAG, "high pad");
+    ESP_RETURN_ON_ERROR(touch_pad_filter_start(TANK_TOUCH_FILTER_MS), TAG, "filter");
+    vTaskDelay(pdMS_TO_TICKS(TANK_TOUCH_SETTLE_MS));
+
+    ESP_RETURN_ON_ERROR(calibrate(), TAG, "calibrate");
+    tank_touch_low();
+    arm_wakeup();
+    return ESP_OK;
+}
+
+esp_err_t tank_touch_calibrate_dry(void)
+{
+    touch_dry_t seen;
+
+    ESP_RETURN_ON_ERROR(read_pads(&seen), TAG, "read");
+    ESP_RETURN_ON_ERROR(hal_storage_write(STORE_NS, STORE_KEY, &seen, sizeof(seen)), TAG, "store");
+    ESP_LOGI(TAG, "Calibrated, taking %d/%d as dry", seen.low, seen.high);
+    dry = seen;
+    calibrated = true;
+    tank_touch_low();
+    arm_wakeup();
+    return ESP_OK;
+}
+
+bool tank_touch_low(void)
+{
+    uint16_t low, high;
+    bool was_low = tank_low;
+
+    if (!calibrated) {
+        tank_low = false;
+        return false;
+    }
+    if (touch_pad_read_filtered(TANK_LOW_TOUCH_PAD, &low) != ESP_OK
+        || touch_pad_read_filtered(TANK_HIGH_TOUCH_PAD, &high) != ESP_OK) {
+        return tank_low;
+    }
+    if (!tank_low && low >= wet_below(dry.low)) {
+        tank_low = true;
+    } else if (tank_low && high < wet_below(dry.high)) {
+        tank_low = false;
+    }
+    if (tank_low != was_low) {
+        ESP_LOGI(TAG, "Tank %s the electrode band (%d/%d)", tank_low ? "below" : "refilled above", low, high);
+        arm_wakeup();
+    }
+    return tank_low;
+}
+
+bool tank_touch_wake_armed(void)
+{
+    return wake_armed;
+}
+
+#else
+
+esp_err_t tank_touch_init(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t tank_touch_calibrate_dry(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+bool tank_touch_low(void)
+{
+    return false;
+}
+
+bool tank_touch_wake_armed(void)
+{
+    return false;
+}
+
+#endif
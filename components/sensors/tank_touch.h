@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+// ===== TANK TOUCH CONFIGURATION =====
+#define TANK_TOUCH_WET_PCT       80                // A pad reading below this share of its dry value is under water
+#define TANK_TOUCH_FILTER_MS     10                // IIR filter period for the awake readings
+#define TANK_TOUCH_SETTLE_MS     300               // Filter run-in before the first reading
+#define TANK_TOUCH_SLEEP_CYCLES  0x4000            // ~110 ms between measurements on the 150 kHz slow clock
+
+// Water level from the two tank electrodes, measured as touch pads by the touch FSM
+// which keeps running through deep sleep. The tank counts as low once the reserve
+// electrode is dry and stays low until a refill covers the upper one. While low, that
+// refill wakes the chip from deep sleep.
+// The electrodes are ignored until tank_touch_calibrate_dry has set their baseline.
+// After that a pad's dry value is the highest reading ever seen, raised at each boot.
+// ESP_ERR_NOT_SUPPORTED on chips without the ESP32 touch sensor.
+esp_err_t tank_touch_init(void);
+
+// Take the current readings as dry and store them. Run with both electrodes out of
+// the water, which also leaves the tank counted as low until a refill.
+esp_err_t tank_touch_calibrate_dry(void);
+
+// Read the electrodes and move through the band. True while the tank is below it,
+// always false before calibration. A failed read keeps the last state.
+bool tank_touch_low(void);
+
+// True while a low tank has the refill armed as a deep sleep wakeup. Deep sleep on
+// an empty tank without it would only end at the next timer.
+bool tank_touch_wake_armed(void);
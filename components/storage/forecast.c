@@ -0,0 +1,113 @@
+#include "forecast.h"
+
+#define HOUR_S                   3600
+
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+
+    while (len--) {
+        crc ^= *data++;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+size_t forecast_encode(const forecast_t *fc, uint8_t *buf, size_t size)
+{
+    size_t len = FORECAST_HEADER_BYTES + 2 * (size_t)fc->hours;
+
+    if (fc->hours > FORECAST_MAX_HOURS || size < len) {
+        return 0;
+    }
+    uint8_t *entry = buf + FORECAST_HEADER_BYTES;
+    for (int h = 0; h < fc->hours; h++) {
+        entry[2 * h] = fc->hour[h].rain_pct;
+        entry[2 * h + 1] = (uint8_t)fc->hour[h].temp_c;
+    }
+    put_u32(buf, FORECAST_MAGIC);
+    buf[4] = FORECAST_VERSION;
+    buf[5] = 0;
+    put_u16(buf + 6, fc->hours);
+    put_u32(buf + 8, fc->start_s);
+    put_u32(buf + 12, crc32(entry, len - FORECAST_HEADER_BYTES));
+    return len;
+}
+
+bool forecast_decode(const uint8_t *buf, size_t len, forecast_t *fc)
+{
+    if (len < FORECAST_HEADER_BYTES || get_u32(buf) != FORECAST_MAGIC || buf[4] != FORECAST_VERSION) {
+        return false;
+    }
+    uint16_t hours = get_u16(buf + 6);
+    const uint8_t *entry = buf + FORECAST_HEADER_BYTES;
+    if (hours > FORECAST_MAX_HOURS || len != FORECAST_HEADER_BYTES + 2 * (size_t)hours
+        || crc32(entry, 2 * (size_t)hours) != get_u32(buf + 12)) {
+        return false;
+    }
+
+    fc->start_s = get_u32(buf + 8);
+    fc->hours = hours;
+    for (int h = 0; h < hours; h++) {
+        fc->hour[h].rain_pct = entry[2 * h];
+        fc->hour[h].temp_c = (int8_t)entry[2 * h + 1];
+    }
+    return true;
+}
+
+uint8_t forecast_keep_pct(const forecast_t *fc, const forecast_policy_t *policy, uint32_t at_s)
+{
+    if (at_s < fc->start_s || (at_s - fc->start_s) / HOUR_S >= fc->hours) {
+        return 100;
+    }
+    uint32_t first = (at_s - fc->start_s) / HOUR_S;
+    uint8_t rain = 0;
+    int8_t warmest = INT8_MIN;
+
+    for (uint32_t h = first; h < fc->hours && h < first + 24; h++) {
+        if (h < first + policy->lookahead_h && fc->hour[h].rain_pct > rain) {
+            rain = fc->hour[h].rain_pct;
+        }
+        if (fc->hour[h].temp_c > warmest) {
+            warmest = fc->hour[h].temp_c;
+        }
+    }
+
+    uint32_t keep = 100;
+    if (rain >= policy->skip_rain_pct) {
+        return 0;
+    }
+    if (rain > policy->shrink_rain_pct) {
+        // Linear from a full cycle at shrink_rain_pct down to min_keep_pct just below skip
+        keep -= (100 - policy->min_keep_pct) * (uint32_t)(rain - policy->shrink_rain_pct)
+                / (policy->skip_rain_pct - policy->shrink_rain_pct);
+    }
+    if (warmest < policy->cool_c) {
+        keep = keep * policy->cool_keep_pct / 100;
+    }
+    return keep;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ===== FORECAST FORMAT =====
+#define FORECAST_MAGIC           0x54534346U       // "FCST"
+#define FORECAST_VERSION         1
+#define FORECAST_MAX_HOURS       168               // One week of hourly entries
+#define FORECAST_HEADER_BYTES    16
+#define FORECAST_MAX_BYTES       (FORECAST_HEADER_BYTES + 2 * FORECAST_MAX_HOURS)
+#define FORECAST_CONSOLE_CMD     "forecast "       // Console upload line prefix, followed by the blob in hex
+
+// Encoded layout, little-endian:
+//   0  u32 magic    4  u8 version    5  u8 reserved    6  u16 hours
+//   8  u32 start_s (Unix time of the first hour)       12 u32 CRC-32 of the entries
+//   16 hours x { u8 rain probability %, s8 temperature C }
+typedef struct {
+    uint8_t rain_pct;
+    int8_t  temp_c;
+} forecast_hour_t;
+
+typedef struct {
+    uint32_t        start_s;
+    uint16_t        hours;
+    forecast_hour_t hour[FORECAST_MAX_HOURS];
+} forecast_t;
+
+typedef struct {
+    uint8_t shrink_rain_pct;   // Cycles start getting shorter at this rain probability
+    uint8_t skip_rain_pct;     // ...and are skipped at or above this one
+    uint8_t min_keep_pct;      // Shortest shrunk cycle, in % of its planned duration
+    uint8_t lookahead_h;       // Hours after a cycle start searched for rain
+    int8_t  cool_c;            // If no hour of the following day reaches this...
+    uint8_t cool_keep_pct;     // ...the cycle is scaled to this % as well
+} forecast_policy_t;
+
+// Serialize a forecast. Returns the encoded length, or 0 if buf is too small.
+size_t forecast_encode(const forecast_t *fc, uint8_t *buf, size_t size);
+
+// Parse and validate an encoded forecast. Returns false on a bad magic, version,
+// length or checksum.
+bool forecast_decode(const uint8_t *buf, size_t len, forecast_t *fc);
+
+// Percentage of a cycle starting at at_s worth watering given the forecast. Returns
+// 100 when the forecast does not cover at_s.
+uint8_t forecast_keep_pct(const forecast_t *fc, const forecast_policy_t *policy, uint32_t at_s);
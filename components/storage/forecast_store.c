@@ -0,0 +1,128 @@
+#include "forecast_store.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <sys/time.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "board_hal.h"
+
+#define TAG "FORECAST"
+#define CONSOLE_UART             CONFIG_ESP_CONSOLE_UART_NUM
+#define CONSOLE_RX_BUFFER        1024
+#define CONSOLE_LINE_MAX         (sizeof(FORECAST_CONSOLE_CMD) + 2 * FORECAST_MAX_BYTES)
+#define CONSOLE_STACK_SIZE       3072
+#define CONSOLE_PRIORITY         2
+
+static char line[CONSOLE_LINE_MAX];
+static uint8_t blob[FORECAST_MAX_BYTES];          // Console upload, owned by the console task
+static uint8_t stored[FORECAST_MAX_BYTES];        // NVS read-back, owned by the caller of load
+
+esp_err_t forecast_store_load(forecast_t *fc)
+{
+    size_t len = sizeof(stored);
+
+    esp_err_t err = hal_storage_read(FORECAST_NVS_NAMESPACE, FORECAST_NVS_KEY, stored, &len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return forecast_decode(stored, len, fc) ? ESP_OK : ESP_ERR_INVALID_CRC;
+}
+
+esp_err_t forecast_store_save(const uint8_t *data, size_t len)
+{
+    static forecast_t fc;
+
+    if (!forecast_decode(data, len, &fc)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ESP_RETURN_ON_ERROR(hal_storage_write(FORECAST_NVS_NAMESPACE, FORECAST_NVS_KEY, data, len), TAG, "write");
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if (now.tv_sec < FORECAST_CLOCK_VALID_S) {
+        struct timeval set = { .tv_sec = fc.start_s };
+        settimeofday(&set, NULL);
+        ESP_LOGW(TAG, "Wall clock was unset, taken from the forecast start");
+    }
+    ESP_LOGI(TAG, "Stored %d hour forecast starting at %" PRIu32, fc.hours, fc.start_s);
+    return ESP_OK;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static void handle_line(const char *text, size_t len)
+{
+    size_t prefix = strlen(FORECAST_CONSOLE_CMD);
+
+    if (len < prefix || memcmp(text, FORECAST_CONSOLE_CMD, prefix) != 0) {
+        return;
+    }
+    text += prefix;
+    len -= prefix;
+    if (len % 2 != 0 || len / 2 > sizeof(blob)) {
+        ESP_LOGE(TAG, "Upload has a bad length");
+        return;
+    }
+    for (size_t i = 0; i < len / 2; i++) {
+        int hi = hex_value(text[2 * i]);
+        int lo = hex_value(text[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            ESP_LOGE(TAG, "Upload is not hex");
+            return;
+        }
+        blob[i] = (hi << 4) | lo;
+    }
+    if (forecast_store_save(blob, len / 2) != ESP_OK) {
+        ESP_LOGE(TAG, "Upload rejected");
+    }
+}
+
+static void console_task(void *arg)
+{
+    size_t len = 0;
+    bool overflow = false;
+    uint8_t c;
+
+    for (;;) {
+        if (uart_read_bytes(CONSOLE_UART, &c, 1, portMAX_DELAY) != 1) {
+            continue;
+        }
+        if (c == '\r' || c == '\n') {
+            if (!overflow) {
+                handle_line(line, len);
+            }
+            len = 0;
+            overflow = false;
+        } else if (len < sizeof(line)) {
+            line[len++] = c;
+        } else {
+            overflow = true;
+        }
+    }
+}
+
+esp_err_t forecast_store_start_console(void)
+{
+    ESP_RETURN_ON_ERROR(uart_driver_install(CONSOLE_UART, CONSOLE_RX_BUFFER, 0, 0, NULL, 0), TAG, "uart");
+    if (xTaskCreate(console_task, "forecast_console", CONSOLE_STACK_SIZE, NULL, CONSOLE_PRIORITY, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "esp_err.h"
+#include "forecast.h"
+
+// ===== FORECAST STORE CONFIGURATION =====
+#define FORECAST_NVS_NAMESPACE   "forecast"
+#define FORECAST_NVS_KEY         "hourly"
+#define FORECAST_CLOCK_VALID_S   1700000000U       // Earlier wall clock readings mean it was never set
+
+// Load the last uploaded forecast from NVS. ESP_ERR_NOT_FOUND if there is none.
+esp_err_t forecast_store_load(forecast_t *fc);
+
+// Validate an encoded forecast and persist it. Also sets the wall clock from the
+// forecast start if it has never been set, so a maintenance upload is enough to use it.
+esp_err_t forecast_store_save(const uint8_t *blob, size_t len);
+
+// Listen on the console UART for "forecast <hex>" lines as written by the host
+// forecast_csv tool. The task blocks in the UART driver and costs nothing while idle.
+esp_err_t forecast_store_start_console(void);
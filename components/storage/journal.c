@@ -0,0 +1,101 @@
+#include "journal.h"
+
+#include <string.h>
+
+// Keeps the compiler from moving the state store ahead of the fields it commits
+static inline void barrier(void)
+{
+    __asm__ __volatile__("" ::: "memory");
+}
+
+static uint32_t elapsed_s(const journal_entry_t *e, int64_t now_us)
+{
+    return e->pulse_base_s + (uint32_t)((now_us - e->pulse_start_us) / 1000000);
+}
+
+bool journal_valid(const journal_t *j)
+{
+    if (j->magic != JOURNAL_MAGIC) {
+        return false;
+    }
+    for (int z = 0; z < JOURNAL_MAX_ZONES; z++) {
+        if (j->zone[z].state > JOURNAL_PAUSED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void journal_reset(journal_t *j)
+{
+    memset(j, 0, sizeof(*j));
+    j->magic = JOURNAL_MAGIC;
+}
+
+void journal_intent(journal_t *j, int zone, uint32_t planned_s)
+{
+    journal_entry_t *e = &j->zone[zone];
+
+    e->cycle++;
+    e->planned_s = planned_s;
+    e->delivered_s = 0;
+    e->pulse_base_s = 0;
+    barrier();
+    e->state = JOURNAL_INTENT;
+}
+
+void journal_pulse_start(journal_t *j, int zone, int64_t now_us)
+{
+    journal_entry_t *e = &j->zone[zone];
+
+    // Runs outside a journaled cycle, e.g. frost circulation, are not recovered
+    if (e->state == JOURNAL_IDLE) {
+        return;
+    }
+    e->pulse_base_s = e->delivered_s;
+    e->pulse_start_us = now_us;
+    barrier();
+    e->state = JOURNAL_RUNNING;
+}
+
+void journal_pulse_stop(journal_t *j, int zone, int64_t now_us)
+{
+    journal_entry_t *e = &j->zone[zone];
+
+    if (e->state != JOURNAL_RUNNING) {
+        return;
+    }
+    e->delivered_s = elapsed_s(e, now_us);
+    barrier();
+    e->state = JOURNAL_PAUSED;
+}
+
+void journal_checkpoint(journal_t *j, uint32_t mask, int64_t now_us)
+{
+    for (int z = 0; mask && z < JOURNAL_MAX_ZONES; z++, mask >>= 1) {
+        journal_entry_t *e = &j->zone[z];
+        if ((mask & 1) && e->state == JOURNAL_RUNNING) {
+            e->delivered_s = elapsed_s(e, now_us);
+        }
+    }
+}
+
+void journal_done(journal_t *j, int zone)
+{
+    j->zone[zone].state = JOURNAL_IDLE;
+}
+
+uint32_t journal_remaining_s(const journal_t *j, int zone)
+{
+    const journal_entry_t *e = &j->zone[zone];
+
+    if (e->state == JOURNAL_IDLE) {
+        return 0;
+    }
+    return (e->delivered_s < e->planned_s) ? e->planned_s - e->delivered_s : 0;
+}
+
+uint32_t journal_delivered_s(const journal_t *j, int zone)
+{
+    return j->zone[zone].delivered_s;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== JOURNAL CONFIGURATION =====
+#define JOURNAL_MAX_ZONES        8
+#define JOURNAL_MAGIC            0x4A524E4CU       // "JRNL"
+
+typedef enum {
+    JOURNAL_IDLE = 0,          // Last cycle completed, nothing to recover
+    JOURNAL_INTENT,            // Cycle allocated, no water delivered yet
+    JOURNAL_RUNNING,           // Pulse in progress
+    JOURNAL_PAUSED,            // Between pulses of a cycle, e.g. soaking
+} journal_state_t;
+
+// One zone's cycle. Every field is a single aligned store and state is written last,
+// so a reset in the middle of an update leaves either the old or the new record.
+typedef struct {
+    uint8_t  state;            // journal_state_t
+    uint8_t  reserved;
+    uint16_t cycle;            // Counts cycles, a completed one is never replayed
+    uint32_t planned_s;        // Run time allocated to the cycle
+    uint32_t delivered_s;      // Run time delivered, checkpointed while running
+    uint32_t pulse_base_s;     // delivered_s when the current pulse started
+    int64_t  pulse_start_us;   // On the hal_time_us() clock, which survives resets
+} journal_entry_t;
+
+typedef struct {
+    uint32_t        magic;
+    journal_entry_t zone[JOURNAL_MAX_ZONES];
+} journal_t;
+
+// True if j holds a journal rather than power-on garbage
+bool journal_valid(const journal_t *j);
+
+void journal_reset(journal_t *j);
+
+// Write-ahead record of a cycle about to start with planned_s of run time
+void journal_intent(journal_t *j, int zone, uint32_t planned_s);
+
+// Pulses of a zone with no cycle intent recorded are ignored
+void journal_pulse_start(journal_t *j, int zone, int64_t now_us);
+void journal_pulse_stop(journal_t *j, int zone, int64_t now_us);
+
+// Record the progress of every running zone in mask. One store per zone, meant to be
+// called on every flow sample.
+void journal_checkpoint(journal_t *j, uint32_t mask, int64_t now_us);
+
+void journal_done(journal_t *j, int zone);
+
+// Run time still owed to a cycle interrupted by a reset, 0 if it completed. A pulse
+// in progress counts up to its last checkpoint.
+uint32_t journal_remaining_s(const journal_t *j, int zone);
+
+// Run time already delivered by the interrupted cycle
+uint32_t journal_delivered_s(const journal_t *j, int zone);
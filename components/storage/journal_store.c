@@ -0,0 +1,19 @@
+#include "journal_store.h"
+
+#include "board_hal.h"
+
+esp_err_t journal_store_save(const journal_t *j)
+{
+    return hal_storage_write(JOURNAL_NVS_NAMESPACE, JOURNAL_NVS_KEY, j, sizeof(*j));
+}
+
+esp_err_t journal_store_load(journal_t *j)
+{
+    size_t len = sizeof(*j);
+
+    esp_err_t err = hal_storage_read(JOURNAL_NVS_NAMESPACE, JOURNAL_NVS_KEY, j, &len);
+    if (err == ESP_OK && (len != sizeof(*j) || !journal_valid(j))) {
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    return err;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "esp_err.h"
+#include "journal.h"
+
+// ===== JOURNAL STORE CONFIGURATION =====
+#define JOURNAL_NVS_NAMESPACE    "journal"
+#define JOURNAL_NVS_KEY          "cycles"
+
+// Flash copy of the RTC journal, for resets that lose RTC memory such as a power cut.
+// Only written at cycle and pulse boundaries, never on the checkpoint path.
+esp_err_t journal_store_save(const journal_t *j);
+
+// ESP_ERR_NOT_FOUND if nothing was saved, ESP_ERR_INVALID_SIZE if the layout changed
+esp_err_t journal_store_load(journal_t *j);
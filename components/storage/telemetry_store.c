@@ -0,0 +1,105 @@
+#include "telemetry_store.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "board_hal.h"
+
+#define RING_KEY                 "ring"
+
+typedef struct {
+    uint16_t head;             // Slot of the oldest frame
+    uint16_t count;
+} ring_t;
+
+static ring_t ring;
+static bool loaded;
+
+static void slot_key(int slot, char *key)
+{
+    snprintf(key, 8, "f%02d", slot);
+}
+
+static esp_err_t load(void)
+{
+    size_t len = sizeof(ring);
+
+    if (loaded) {
+        return ESP_OK;
+    }
+    esp_err_t err = hal_storage_read(TELEMETRY_NVS_NAMESPACE, RING_KEY, &ring, &len);
+    if (err == ESP_ERR_NOT_FOUND || (err == ESP_OK && (len != sizeof(ring) || ring.head >= TELEMETRY_STORE_SLOTS
+                                                       || ring.count > TELEMETRY_STORE_SLOTS))) {
+        ring = (ring_t){ 0 };
+        err = ESP_OK;
+    }
+    loaded = (err == ESP_OK);
+    return err;
+}
+
+static esp_err_t save(void)
+{
+    return hal_storage_write(TELEMETRY_NVS_NAMESPACE, RING_KEY, &ring, sizeof(ring));
+}
+
+esp_err_t telemetry_store_push(const uint8_t *frame, size_t len)
+{
+    char key[8];
+
+    esp_err_t err = load();
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (ring.count == TELEMETRY_STORE_SLOTS) {
+        ring.head = (ring.head + 1) % TELEMETRY_STORE_SLOTS;
+        ring.count--;
+    }
+    slot_key((ring.head + ring.count) % TELEMETRY_STORE_SLOTS, key);
+    err = hal_storage_write(TELEMETRY_NVS_NAMESPACE, key, frame, len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    ring.count++;
+    return save();
+}
+
+int telemetry_store_count(void)
+{
+    return (load() == ESP_OK) ? ring.count : 0;
+}
+
+esp_err_t telemetry_store_read(int i, uint8_t *frame, size_t *len)
+{
+    char key[8];
+
+    esp_err_t err = load();
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (i < 0 || i >= ring.count) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    slot_key((ring.head + i) % TELEMETRY_STORE_SLOTS, key);
+    return hal_storage_read(TELEMETRY_NVS_NAMESPACE, key, frame, len);
+}
+
+// Slots are overwritten in place, so dropping only moves the ring
+esp_err_t telemetry_store_drop(int n)
+{
+    esp_err_t err = load();
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (n > ring.count) {
+        n = ring.count;
+    }
+    ring.head = (ring.head + n) % TELEMETRY_STORE_SLOTS;
+    ring.count -= n;
+    return save();
+}
+
+esp_err_t telemetry_store_clear(void)
+{
+    ring = (ring_t){ 0 };
+    loaded = true;
+    return save();
+}
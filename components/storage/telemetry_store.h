@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// ===== TELEMETRY STORE CONFIGURATION =====
+#define TELEMETRY_NVS_NAMESPACE  "tlm_log"
+#define TELEMETRY_STORE_SLOTS    48                // Frames kept, the oldest goes first when full
+
+// Telemetry frames the gateway never acknowledged, kept in flash in the order they were
+// sent until they go out in a batch. One write per frame and one for the ring, only
+// while the gateway is unreachable. Frame times are on the node clock, which a power
+// cut restarts, so clear the store after one.
+esp_err_t telemetry_store_push(const uint8_t *frame, size_t len);
+
+int telemetry_store_count(void);
+
+// The i-th oldest frame. len is the buffer size on entry and the frame length on return.
+esp_err_t telemetry_store_read(int i, uint8_t *frame, size_t *len);
+
+// Drop the n oldest frames
+esp_err_t telemetry_store_drop(int n);
+
+esp_err_t telemetry_store_clear(void);
@@ -0,0 +1,174 @@
+#include "aes_ccm.h"
+
+#include <string.h>
+
+#define BLOCK                    16
+#define ROUNDS                   10
+
+static const uint8_t sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+static uint8_t xtime(uint8_t x)
+{
+    return (uint8_t)((x << 1) ^ ((x >> 7) * 0x1b));
+}
+
+void aes_ccm_init(aes_ccm_t *c, const uint8_t *key)
+{
+    uint8_t *rk = c->round_key;
+    uint8_t rcon = 1;
+
+    memcpy(rk, key, AES_CCM_KEY_BYTES);
+    for (int i = AES_CCM_KEY_BYTES; i < (int)sizeof(c->round_key); i += 4) {
+        uint8_t t[4] = { rk[i - 4], rk[i - 3], rk[i - 2], rk[i - 1] };
+        if (i % AES_CCM_KEY_BYTES == 0) {
+            uint8_t first = t[0];
+            t[0] = sbox[t[1]] ^ rcon;
+            t[1] = sbox[t[2]];
+            t[2] = sbox[t[3]];
+            t[3] = sbox[first];
+            rcon = xtime(rcon);
+        }
+        for (int j = 0; j < 4; j++) {
+            rk[i + j] = rk[i + j - AES_CCM_KEY_BYTES] ^ t[j];
+        }
+    }
+}
+
+static void encrypt_block(const aes_ccm_t *c, const uint8_t *in, uint8_t *out)
+{
+    uint8_t s[BLOCK], t[BLOCK];
+
+    for (int i = 0; i < BLOCK; i++) {
+        s[i] = in[i] ^ c->round_key[i];
+    }
+    for (int round = 1; round <= ROUNDS; round++) {
+        // SubBytes and ShiftRows, the state is column-major
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++) {
+                t[4 * col + row] = sbox[s[4 * ((col + row) % 4) + row]];
+            }
+        }
+        if (round < ROUNDS) {
+            for (int col = 0; col < 4; col++) {
+                uint8_t *a = t + 4 * col;
+                uint8_t all = a[0] ^ a[1] ^ a[2] ^ a[3];
+                uint8_t first = a[0];
+                a[0] ^= all ^ xtime(a[0] ^ a[1]);
+                a[1] ^= all ^ xtime(a[1] ^ a[2]);
+                a[2] ^= all ^ xtime(a[2] ^ a[3]);
+                a[3] ^= all ^ xtime(a[3] ^ first);
+            }
+        }
+        for (int i = 0; i < BLOCK; i++) {
+            s[i] = t[i] ^ c->round_key[BLOCK * round + i];
+        }
+    }
+    memcpy(out, s, BLOCK);
+}
+
+// CBC-MAC over B0, the associated data and the message, each part zero padded
+static void mac(const aes_ccm_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                const uint8_t *msg, size_t len, uint8_t *x)
+{
+    uint8_t b[BLOCK];
+    size_t used;
+
+    b[0] = (aad_len ? 0x40 : 0) | (((AES_CCM_TAG_BYTES - 2) / 2) << 3) | (15 - AES_CCM_NONCE_BYTES - 1);
+    memcpy(b + 1, nonce, AES_CCM_NONCE_BYTES);
+    b[14] = (uint8_t)(len >> 8);
+    b[15] = (uint8_t)len;
+    encrypt_block(c, b, x);
+
+    if (aad_len) {
+        // Two length bytes, so aad_len stays under 0xFF00
+        memset(b, 0, BLOCK);
+        b[0] = (uint8_t)(aad_len >> 8);
+        b[1] = (uint8_t)aad_len;
+        used = 2;
+        for (size_t i = 0; i < aad_len; i++) {
+            b[used++] = aad[i];
+            if (used == BLOCK || i == aad_len - 1) {
+                for (int j = 0; j < BLOCK; j++) {
+                    x[j] ^= b[j];
+                }
+                encrypt_block(c, x, x);
+                memset(b, 0, BLOCK);
+                used = 0;
+            }
+        }
+    }
+    for (size_t at = 0; at < len; at += BLOCK) {
+        size_t n = (len - at < BLOCK) ? len - at : BLOCK;
+        for (size_t j = 0; j < n; j++) {
+            x[j] ^= msg[at + j];
+        }
+        encrypt_block(c, x, x);
+    }
+}
+
+// Counter mode from block 1 on, block 0 masks the tag
+static void ctr(const aes_ccm_t *c, const uint8_t *nonce, const uint8_t *in, size_t len, uint8_t *out, uint8_t *s0)
+{
+    uint8_t a[BLOCK], s[BLOCK];
+
+    a[0] = 15 - AES_CCM_NONCE_BYTES - 1;
+    memcpy(a + 1, nonce, AES_CCM_NONCE_BYTES);
+    a[14] = a[15] = 0;
+    encrypt_block(c, a, s0);
+    for (size_t at = 0, i = 1; at < len; at += BLOCK, i++) {
+        size_t n = (len - at < BLOCK) ? len - at : BLOCK;
+        a[14] = (uint8_t)(i >> 8);
+        a[15] = (uint8_t)i;
+        encrypt_block(c, a, s);
+        for (size_t j = 0; j < n; j++) {
+            out[at + j] = in[at + j] ^ s[j];
+        }
+    }
+}
+
+void aes_ccm_seal(const aes_ccm_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                  const uint8_t *in, size_t len, uint8_t *out, uint8_t *tag)
+{
+    uint8_t x[BLOCK], s0[BLOCK];
+
+    mac(c, nonce, aad, aad_len, in, len, x);
+    ctr(c, nonce, in, len, out, s0);
+    for (int i = 0; i < AES_CCM_TAG_BYTES; i++) {
+        tag[i] = x[i] ^ s0[i];
+    }
+}
+
+bool aes_ccm_open(const aes_ccm_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                  const uint8_t *in, size_t len, uint8_t *out, const uint8_t *tag)
+{
+    uint8_t x[BLOCK], s0[BLOCK];
+    uint8_t diff = 0;
+
+    ctr(c, nonce, in, len, out, s0);
+    mac(c, nonce, aad, aad_len, out, len, x);
+    // Constant time, a mismatch position must not show in the timing
+    for (int i = 0; i < AES_CCM_TAG_BYTES; i++) {
+        diff |= tag[i] ^ x[i] ^ s0[i];
+    }
+    if (diff) {
+        memset(out, 0, len);
+    }
+    return diff == 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ===== AES-CCM CONFIGURATION =====
+#define AES_CCM_KEY_BYTES        16                // AES-128
+#define AES_CCM_NONCE_BYTES      13                // Leaves 2 length bytes, messages up to 64 KB
+#define AES_CCM_TAG_BYTES        8
+
+// AES-128-CCM (RFC 3610) in portable C. The gateway uses it, and on the node it is the
+// software baseline that the hardware AES behind mbedtls is benchmarked against.
+typedef struct {
+    uint8_t round_key[176];
+} aes_ccm_t;
+
+void aes_ccm_init(aes_ccm_t *c, const uint8_t *key);
+
+// Encrypt len bytes of in to out and authenticate them together with aad
+void aes_ccm_seal(const aes_ccm_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                  const uint8_t *in, size_t len, uint8_t *out, uint8_t *tag);
+
+// Decrypt and check the tag. On false out holds nothing usable.
+bool aes_ccm_open(const aes_ccm_t *c, const uint8_t *nonce, const uint8_t *aad, size_t aad_len,
+                  const uint8_t *in, size_t len, uint8_t *out, const uint8_t *tag);
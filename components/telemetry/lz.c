@@ -0,0 +1,155 @@
+#include "lz.h"
+
+#include <string.h>
+
+#define LITERAL_BITS             9
+#define REFERENCE_BITS           (1 + LZ_WINDOW_BITS + LZ_LENGTH_BITS)
+
+static void put_bits(lz_encoder_t *e, uint32_t value, int count)
+{
+    e->bits = (e->bits << count) | value;
+    e->bit_count += count;
+    while (e->bit_count >= 8) {
+        e->bit_count -= 8;
+        if (e->out_len < e->out_size) {
+            e->out[e->out_len++] = (uint8_t)(e->bits >> e->bit_count);
+        }
+    }
+    e->bits &= (1U << e->bit_count) - 1;
+}
+
+// Longest earlier match for the bytes at pos. May run on into the bytes being matched,
+// the decoder copies one byte at a time.
+static int find_match(const lz_encoder_t *e, int *offset)
+{
+    int pos = e->pos;
+    int limit = e->end - pos;
+    int best = 0;
+
+    if (limit > LZ_MAX_MATCH) {
+        limit = LZ_MAX_MATCH;
+    }
+    for (int start = pos - 1; start >= 0 && pos - start <= LZ_WINDOW; start--) {
+        int n = 0;
+        while (n < limit && e->buf[start + n] == e->buf[pos + n]) {
+            n++;
+        }
+        if (n > best) {
+            best = n;
+            *offset = pos - start;
+            if (n == limit) {
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+static void encode_one(lz_encoder_t *e)
+{
+    int offset = 0;
+    int n = find_match(e, &offset);
+
+    if (n >= LZ_MIN_MATCH) {
+        put_bits(e, ((uint32_t)(offset - 1) << LZ_LENGTH_BITS) | (uint32_t)(n - LZ_MIN_MATCH), REFERENCE_BITS);
+        e->pos += n;
+    } else {
+        put_bits(e, 0x100 | e->buf[e->pos], LITERAL_BITS);
+        e->pos++;
+    }
+}
+
+void lz_encoder_start(lz_encoder_t *e, uint8_t *out, size_t size)
+{
+    e->pos = 0;
+    e->end = 0;
+    e->out = out;
+    e->out_size = size;
+    e->out_len = 0;
+    e->bits = 0;
+    e->bit_count = 0;
+}
+
+bool lz_encoder_fits(const lz_encoder_t *e, size_t len)
+{
+    size_t free_bits = (e->out_size - e->out_len) * 8 - e->bit_count;
+
+    return ((size_t)(e->end - e->pos) + len) * LITERAL_BITS + 7 <= free_bits;
+}
+
+void lz_encoder_write(lz_encoder_t *e, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        // Full: keep one window of history and move the rest down
+        if (e->end == sizeof(e->buf)) {
+            int shift = e->pos - LZ_WINDOW;
+            memmove(e->buf, e->buf + shift, e->end - shift);
+            e->pos -= shift;
+            e->end -= shift;
+        }
+        size_t n = sizeof(e->buf) - e->end;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(e->buf + e->end, data, n);
+        e->end += n;
+        data += n;
+        len -= n;
+        // Only encode with a full lookahead, the next chunk may extend a match
+        while (e->end - e->pos >= LZ_MAX_MATCH) {
+            encode_one(e);
+        }
+    }
+}
+
+size_t lz_encoder_finish(lz_encoder_t *e)
+{
+    while (e->pos < e->end) {
+        encode_one(e);
+    }
+    if (e->bit_count > 0) {
+        put_bits(e, 0, 8 - e->bit_count);
+    }
+    return e->out_len;
+}
+
+static uint32_t get_bits(const uint8_t *in, size_t *bit, int count)
+{
+    uint32_t value = 0;
+
+    for (int i = 0; i < count; i++, (*bit)++) {
+        value = (value << 1) | ((in[*bit / 8] >> (7 - *bit % 8)) & 1);
+    }
+    return value;
+}
+
+bool lz_decode(const uint8_t *in, size_t len, uint8_t *out, size_t size, size_t *out_len)
+{
+    size_t bit = 0;
+    size_t total = len * 8;
+    size_t n = 0;
+
+    // Fewer bits than a literal left is the padding
+    while (total - bit >= LITERAL_BITS) {
+        if (get_bits(in, &bit, 1)) {
+            if (n >= size) {
+                return false;
+            }
+            out[n++] = (uint8_t)get_bits(in, &bit, 8);
+            continue;
+        }
+        if (total - bit < REFERENCE_BITS - 1) {
+            return false;
+        }
+        size_t offset = get_bits(in, &bit, LZ_WINDOW_BITS) + 1;
+        size_t count = get_bits(in, &bit, LZ_LENGTH_BITS) + LZ_MIN_MATCH;
+        if (offset > n || n + count > size) {
+            return false;
+        }
+        for (size_t i = 0; i < count; i++, n++) {
+            out[n] = out[n - offset];
+        }
+    }
+    *out_len = n;
+    return true;
+}
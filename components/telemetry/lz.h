@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ===== LZ CONFIGURATION =====
+#define LZ_WINDOW_BITS           8
+#define LZ_LENGTH_BITS           4
+#define LZ_WINDOW                (1 << LZ_WINDOW_BITS)  // How far back a reference reaches
+#define LZ_MIN_MATCH             2                 // Shorter repeats cost more as a reference than as literals
+#define LZ_MAX_MATCH             (LZ_MIN_MATCH + (1 << LZ_LENGTH_BITS) - 1)
+
+// LZSS in the style of heatshrink: a flag bit, then either a literal byte or a window
+// offset and length. Literals cost 9 bits and references 13. The encoder streams input
+// in chunks, e.g. frames as they are read from flash, into a caller's buffer in fixed
+// memory (this struct, nothing allocated). Matching is a plain search of the window,
+// cheap at this window size.
+typedef struct {
+    uint8_t  buf[2 * LZ_WINDOW];   // History, then bytes not yet encoded
+    uint16_t pos;                  // First byte not yet encoded
+    uint16_t end;
+    uint8_t *out;
+    size_t   out_size;
+    size_t   out_len;
+    uint32_t bits;                 // Output bits not yet a whole byte
+    uint8_t  bit_count;
+} lz_encoder_t;
+
+void lz_encoder_start(lz_encoder_t *e, uint8_t *out, size_t size);
+
+// True if len more input bytes fit in the output whatever they are
+bool lz_encoder_fits(const lz_encoder_t *e, size_t len);
+
+// Output that does not fit is cut off, so check lz_encoder_fits first
+void lz_encoder_write(lz_encoder_t *e, const uint8_t *data, size_t len);
+
+// Encode the rest and pad to a whole byte. Returns the output length.
+size_t lz_encoder_finish(lz_encoder_t *e);
+
+// Returns false if the stream is malformed or does not fit in size
+bool lz_decode(const uint8_t *in, size_t len, uint8_t *out, size_t size, size_t *out_len);
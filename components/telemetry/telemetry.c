@@ -0,0 +1,209 @@
+#include "telemetry.h"
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+static void put_u64(uint8_t *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static uint64_t get_u64(const uint8_t *p)
+{
+    return get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+telemetry_verdict_t telemetry_check(const telemetry_metric_t *m, const telemetry_policy_t *policy,
+                                    int32_t value, int64_t at_us)
+{
+    if (!m->valid) {
+        return TELEMETRY_SEND;
+    }
+    uint32_t delta = (value > m->sent) ? (uint32_t)(value - m->sent) : (uint32_t)(m->sent - value);
+    int64_t silent_us = at_us - m->sent_at_us;
+    int64_t heartbeat_us = (int64_t)policy->max_silence_s * 1000000;
+
+    if (delta > policy->deadband || (heartbeat_us && silent_us >= heartbeat_us)) {
+        return TELEMETRY_SEND;
+    }
+    if (2 * delta > policy->deadband || (heartbeat_us && 2 * silent_us >= heartbeat_us)) {
+        return TELEMETRY_RIDE;
+    }
+    return TELEMETRY_QUIET;
+}
+
+void telemetry_mark_sent(telemetry_metric_t *m, int32_t value, int64_t at_us)
+{
+    m->sent = value;
+    m->sent_at_us = at_us;
+    m->valid = true;
+}
+
+size_t telemetry_encode(const telemetry_record_t *records, int count, uint32_t sent_s, uint8_t *buf, size_t size)
+{
+    size_t len = TELEMETRY_HEADER_BYTES + TELEMETRY_RECORD_BYTES * (size_t)count;
+
+    if (count < 0 || count > TELEMETRY_MAX_RECORDS || size < len) {
+        return 0;
+    }
+    put_u32(buf, TELEMETRY_MAGIC);
+    buf[4] = TELEMETRY_VERSION;
+    buf[5] = count;
+    put_u16(buf + 6, 0);
+    put_u32(buf + 8, sent_s);
+    for (int i = 0; i < count; i++) {
+        uint8_t *r = buf + TELEMETRY_HEADER_BYTES + TELEMETRY_RECORD_BYTES * i;
+        put_u32(r, records[i].at_s);
+        put_u16(r + 4, (uint16_t)records[i].value);
+        r[6] = records[i].metric;
+        r[7] = 0;
+    }
+    return len;
+}
+
+int telemetry_decode(const uint8_t *buf, size_t len, telemetry_record_t *records, uint32_t *sent_s)
+{
+    if (len < TELEMETRY_HEADER_BYTES || get_u32(buf) != TELEMETRY_MAGIC || buf[4] != TELEMETRY_VERSION) {
+        return -1;
+    }
+    int count = buf[5];
+    if (count > TELEMETRY_MAX_RECORDS || len != TELEMETRY_HEADER_BYTES + TELEMETRY_RECORD_BYTES * (size_t)count) {
+        return -1;
+    }
+
+    *sent_s = get_u32(buf + 8);
+    for (int i = 0; i < count; i++) {
+        const uint8_t *r = buf + TELEMETRY_HEADER_BYTES + TELEMETRY_RECORD_BYTES * i;
+        records[i].at_s = get_u32(r);
+        records[i].value = (int16_t)get_u16(r + 4);
+        records[i].metric = r[6];
+    }
+    return count;
+}
+
+size_t telemetry_frame_len(const uint8_t *buf, size_t len)
+{
+    if (len < TELEMETRY_HEADER_BYTES || get_u32(buf) != TELEMETRY_MAGIC) {
+        return 0;
+    }
+    size_t frame_len = TELEMETRY_HEADER_BYTES + TELEMETRY_RECORD_BYTES * (size_t)buf[5];
+    return (frame_len <= len) ? frame_len : 0;
+}
+
+void telemetry_batch_start(telemetry_batch_t *b, uint8_t *buf, size_t size)
+{
+    b->buf = buf;
+    b->raw_len = 0;
+    lz_encoder_start(&b->lz, buf + TELEMETRY_BATCH_HEADER_BYTES,
+                     (size > TELEMETRY_BATCH_HEADER_BYTES) ? size - TELEMETRY_BATCH_HEADER_BYTES : 0);
+}
+
+bool telemetry_batch_add(telemetry_batch_t *b, const uint8_t *frame, size_t len)
+{
+    if (b->raw_len + len > TELEMETRY_BATCH_MAX_RAW || !lz_encoder_fits(&b->lz, len)) {
+        return false;
+    }
+    lz_encoder_write(&b->lz, frame, len);
+    b->raw_len += len;
+    return true;
+}
+
+size_t telemetry_batch_finish(telemetry_batch_t *b, uint32_t sent_s)
+{
+    size_t len = lz_encoder_finish(&b->lz);
+
+    put_u32(b->buf, TELEMETRY_BATCH_MAGIC);
+    put_u32(b->buf + 4, sent_s);
+    put_u16(b->buf + 8, (uint16_t)b->raw_len);
+    put_u16(b->buf + 10, 0);
+    return TELEMETRY_BATCH_HEADER_BYTES + len;
+}
+
+int telemetry_batch_decode(const uint8_t *buf, size_t len, uint8_t *out, size_t size, uint32_t *sent_s)
+{
+    size_t raw_len;
+
+    if (len < TELEMETRY_BATCH_HEADER_BYTES || get_u32(buf) != TELEMETRY_BATCH_MAGIC
+        || !lz_decode(buf + TELEMETRY_BATCH_HEADER_BYTES, len - TELEMETRY_BATCH_HEADER_BYTES, out, size, &raw_len)
+        || raw_len != get_u16(buf + 8)) {
+        return -1;
+    }
+    *sent_s = get_u32(buf + 4);
+    return (int)raw_len;
+}
+
+void telemetry_seal_header(uint8_t *buf, uint32_t node, uint64_t counter)
+{
+    put_u32(buf, TELEMETRY_SEAL_MAGIC);
+    put_u32(buf + 4, node);
+    put_u64(buf + 8, counter);
+}
+
+bool telemetry_seal_parse(const uint8_t *buf, size_t len, uint32_t *node, uint64_t *counter)
+{
+    if (len < TELEMETRY_SEAL_OVERHEAD || get_u32(buf) != TELEMETRY_SEAL_MAGIC) {
+        return false;
+    }
+    *node = get_u32(buf + 4);
+    *counter = get_u64(buf + 8);
+    return true;
+}
+
+void telemetry_seal_nonce(uint32_t node, uint64_t counter, telemetry_direction_t dir, uint8_t *nonce)
+{
+    put_u32(nonce, node);
+    put_u64(nonce + 4, counter);
+    nonce[12] = (uint8_t)dir;
+}
+
+size_t telemetry_seal(const aes_ccm_t *key, uint32_t node, uint64_t counter, telemetry_direction_t dir,
+                      const uint8_t *in, size_t len, uint8_t *out, size_t size)
+{
+    uint8_t nonce[AES_CCM_NONCE_BYTES];
+
+    if (size < len + TELEMETRY_SEAL_OVERHEAD) {
+        return 0;
+    }
+    telemetry_seal_header(out, node, counter);
+    telemetry_seal_nonce(node, counter, dir, nonce);
+    aes_ccm_seal(key, nonce, out, TELEMETRY_SEAL_HEADER_BYTES, in, len, out + TELEMETRY_SEAL_HEADER_BYTES,
+                 out + TELEMETRY_SEAL_HEADER_BYTES + len);
+    return len + TELEMETRY_SEAL_OVERHEAD;
+}
+
+int telemetry_open(const aes_ccm_t *key, telemetry_direction_t dir, const uint8_t *in, size_t len,
+                   uint8_t *out, size_t size, uint32_t *node, uint64_t *counter)
+{
+    uint8_t nonce[AES_CCM_NONCE_BYTES];
+
+    if (!telemetry_seal_parse(in, len, node, counter) || len - TELEMETRY_SEAL_OVERHEAD > size) {
+        return -1;
+    }
+    len -= TELEMETRY_SEAL_OVERHEAD;
+    telemetry_seal_nonce(*node, *counter, dir, nonce);
+    if (!aes_ccm_open(key, nonce, in, TELEMETRY_SEAL_HEADER_BYTES, in + TELEMETRY_SEAL_HEADER_BYTES, len, out,
+                      in + TELEMETRY_SEAL_HEADER_BYTES + len)) {
+        return -1;
+    }
+    return (int)len;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "aes_ccm.h"
+#include "lz.h"
+
+// ===== TELEMETRY FORMAT =====
+#define TELEMETRY_MAGIC          0x314D4C54U       // "TLM1"
+#define TELEMETRY_VERSION        1
+#define TELEMETRY_HEADER_BYTES   12
+#define TELEMETRY_RECORD_BYTES   8
+#define TELEMETRY_MAX_RECORDS    32                // Per frame
+#define TELEMETRY_MAX_BYTES      (TELEMETRY_HEADER_BYTES + TELEMETRY_RECORD_BYTES * TELEMETRY_MAX_RECORDS)
+#define TELEMETRY_CONSOLE_PREFIX "telemetry "      // Console line prefix, followed by the frame in hex
+#define TELEMETRY_BATCH_MAGIC    0x315A4C54U       // "TLZ1"
+#define TELEMETRY_BATCH_HEADER_BYTES 12
+#define TELEMETRY_BATCH_MAX_RAW  UINT16_MAX        // Frames per batch, before compression
+#define TELEMETRY_SEAL_MAGIC     0x314C5354U       // "TSL1"
+#define TELEMETRY_SEAL_HEADER_BYTES 16
+#define TELEMETRY_SEAL_OVERHEAD  (TELEMETRY_SEAL_HEADER_BYTES + AES_CCM_TAG_BYTES)
+#define TELEMETRY_ACK_BYTES      8                 // Sealed acknowledgement payload
+
+// Encoded layout, little-endian:
+//   0  u32 magic    4  u8 version    5  u8 records    6  u16 reserved
+//   8  u32 sent_s (node clock when the frame was encoded)
+//   12 records x { u32 at_s, s16 value, u8 metric, u8 reserved }
+// Times are seconds on the node's monotonic clock. The receiver places a record at its
+// own receive time minus (sent_s - at_s), so the node needs no wall clock.
+//
+// Frames that could not be delivered go out later in batches:
+//   0  u32 magic    4  u32 sent_s (node clock when the batch was sent, overrides the frames')
+//   8  u16 length of the frames    10 u16 reserved
+//   12 the frames back to back, LZ compressed (lz.h)
+//
+// With a key configured, frames and batches travel sealed with AES-128-CCM:
+//   0  u32 magic    4  u32 node (low four bytes of its MAC)    8  u64 counter
+//   16 the frame or batch, encrypted    then an 8-byte tag
+// The 16 header bytes are authenticated too. The nonce is node, counter and a direction
+// byte, so node and gateway share one key without ever sharing a nonce. Counters only
+// go up, and a receiver drops anything not newer than the last it accepted. The gateway
+// answers a sealed datagram with a sealed u64, the counter of the datagram it got.
+
+// Metric numbers on the wire
+typedef enum {
+    TELEMETRY_TANK_DL = 0,     // Tank level, decilitres
+    TELEMETRY_TEMP_DC,         // Air temperature, tenths of a degree C
+    TELEMETRY_BATTERY_PCT,
+    TELEMETRY_FLOW_ALARM,      // Bit 0 zones locked out after a flow alarm, bit 1 flow with every zone closed
+    TELEMETRY_MOISTURE_PCT,    // Zone 0, zone n is TELEMETRY_MOISTURE_PCT + n
+} telemetry_metric_id_t;
+
+typedef struct {
+    uint32_t at_s;
+    int16_t  value;
+    uint8_t  metric;           // telemetry_metric_id_t
+} telemetry_record_t;
+
+// ===== SEND-ON-DELTA =====
+// A metric is reported when it moves more than its deadband away from the value last
+// reported, and at least every max_silence_s as a heartbeat. The receiver holds the
+// last value it got, so its copy is never more than the deadband off, and silence
+// longer than the heartbeat means the node is gone rather than that nothing changed.
+typedef struct {
+    uint16_t deadband;         // In the metric's own units
+    uint32_t max_silence_s;    // 0 for no heartbeat
+} telemetry_policy_t;
+
+// Sender side state of one metric, kept in RTC memory
+typedef struct {
+    int32_t sent;              // Value the receiver holds
+    int64_t sent_at_us;
+    bool    valid;             // Reported at least once
+} telemetry_metric_t;
+
+typedef enum {
+    TELEMETRY_QUIET = 0,       // Nothing worth sending
+    TELEMETRY_RIDE,            // Half way to its deadband or heartbeat, send if a frame goes out anyway
+    TELEMETRY_SEND,            // Past its deadband or heartbeat, a frame has to go out
+} telemetry_verdict_t;
+
+telemetry_verdict_t telemetry_check(const telemetry_metric_t *m, const telemetry_policy_t *policy,
+                                    int32_t value, int64_t at_us);
+
+// Record that value went out, so the receiver holds it from now on
+void telemetry_mark_sent(telemetry_metric_t *m, int32_t value, int64_t at_us);
+
+// Serialize count records sent at sent_s. Returns the encoded length, or 0 if count is
+// over TELEMETRY_MAX_RECORDS or buf is too small.
+size_t telemetry_encode(const telemetry_record_t *records, int count, uint32_t sent_s, uint8_t *buf, size_t size);
+
+// Length of the frame at the start of buf going by its header, 0 if there is none
+size_t telemetry_frame_len(const uint8_t *buf, size_t len);
+
+// ===== BATCHES =====
+typedef struct {
+    lz_encoder_t lz;
+    uint8_t     *buf;
+    size_t       raw_len;
+} telemetry_batch_t;
+
+// Compress frames into buf as they are added
+void telemetry_batch_start(telemetry_batch_t *b, uint8_t *buf, size_t size);
+
+// False, with nothing added, if the frame might not fit any more
+bool telemetry_batch_add(telemetry_batch_t *b, const uint8_t *frame, size_t len);
+
+// Returns the batch length
+size_t telemetry_batch_finish(telemetry_batch_t *b, uint32_t sent_s);
+
+// Unpack a batch into its frames, back to back in out. Returns their length, or -1 on
+// a bad magic, a corrupt stream or a length mismatch.
+int telemetry_batch_decode(const uint8_t *buf, size_t len, uint8_t *out, size_t size, uint32_t *sent_s);
+
+// ===== SEALING =====
+typedef enum {
+    TELEMETRY_FROM_NODE = 0,
+    TELEMETRY_FROM_GATEWAY,
+} telemetry_direction_t;
+
+// Header of a sealed datagram, which is also its associated data
+void telemetry_seal_header(uint8_t *buf, uint32_t node, uint64_t counter);
+
+// False if buf is too short for a sealed datagram or has the wrong magic
+bool telemetry_seal_parse(const uint8_t *buf, size_t len, uint32_t *node, uint64_t *counter);
+
+void telemetry_seal_nonce(uint32_t node, uint64_t counter, telemetry_direction_t dir, uint8_t *nonce);
+
+// Seal len bytes into out in software. Returns the sealed length, or 0 if size is too small.
+size_t telemetry_seal(const aes_ccm_t *key, uint32_t node, uint64_t counter, telemetry_direction_t dir,
+                      const uint8_t *in, size_t len, uint8_t *out, size_t size);
+
+// Check and decrypt a sealed datagram in software. Returns the payload length, or -1 on a
+// bad header, a bad tag or a payload over size. Replays are for the caller to catch.
+int telemetry_open(const aes_ccm_t *key, telemetry_direction_t dir, const uint8_t *in, size_t len,
+                   uint8_t *out, size_t size, uint32_t *node, uint64_t *counter);
+
+// Parse a frame into records, which must hold TELEMETRY_MAX_RECORDS. Returns the
+// record count, or -1 on a bad magic, version or length.
+int telemetry_decode(const uint8_t *buf, size_t len, telemetry_record_t *records, uint32_t *sent_s);
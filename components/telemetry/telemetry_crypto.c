@@ -0,0 +1,197 @@
+#include "telemetry_crypto.h"
+
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "mbedtls/aes.h"
+#include "board_hal.h"
+#include "telemetry.h"
+
+#define TAG "TELEMETRY_CRYPTO"
+#define BLOCK                    16
+
+// Counters of both directions, kept across deep sleep
+typedef struct {
+    uint32_t magic;
+    uint64_t next;             // Next counter to seal with
+    uint64_t ceiling;          // Reserved in flash up to here
+    uint64_t peer;             // Newest gateway counter accepted, the gateway starts above 0
+} counter_state_t;
+
+static RTC_DATA_ATTR counter_state_t state;
+static mbedtls_aes_context aes;
+static uint32_t node;
+static bool ready;
+static uint8_t chunk[CRYPTO_CHUNK_BYTES];
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool parse_key(const char *hex, uint8_t *key)
+{
+    if (strlen(hex) != 2 * AES_CCM_KEY_BYTES) {
+        return false;
+    }
+    for (int i = 0; i < AES_CCM_KEY_BYTES; i++) {
+        int hi = hex_digit(hex[2 * i]), lo = hex_digit(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        key[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+// Move the flash ceiling up before any counter past the old one goes out
+static esp_err_t reserve(void)
+{
+    uint64_t ceiling = state.next + CRYPTO_RESERVE;
+
+    ESP_RETURN_ON_ERROR(hal_storage_write(CRYPTO_NVS_NAMESPACE, CRYPTO_NVS_KEY, &ceiling, sizeof(ceiling)), TAG,
+                        "counter ceiling");
+    state.ceiling = ceiling;
+    return ESP_OK;
+}
+
+// CBC-MAC of RFC 3610 as one CBC encryption with a zero IV: B0 and the header in one
+// pass, then the message through the chunk buffer. The MAC is the last ciphertext
+// block, which mbedtls leaves in the IV.
+static void cbc_mac(const uint8_t *nonce, const uint8_t *header, const uint8_t *msg, size_t len, uint8_t *mac)
+{
+    uint8_t head[3 * BLOCK] = { 0 };
+
+    head[0] = 0x40 | (((AES_CCM_TAG_BYTES - 2) / 2) << 3) | (15 - AES_CCM_NONCE_BYTES - 1);
+    memcpy(head + 1, nonce, AES_CCM_NONCE_BYTES);
+    head[14] = (uint8_t)(len >> 8);
+    head[15] = (uint8_t)len;
+    head[BLOCK + 1] = TELEMETRY_SEAL_HEADER_BYTES;
+    memcpy(head + BLOCK + 2, header, TELEMETRY_SEAL_HEADER_BYTES);
+    memset(mac, 0, BLOCK);
+    mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_ENCRYPT, sizeof(head), mac, head, head);
+
+    for (size_t at = 0; at < len; at += CRYPTO_CHUNK_BYTES) {
+        size_t n = (len - at < CRYPTO_CHUNK_BYTES) ? len - at : CRYPTO_CHUNK_BYTES;
+        size_t padded = (n + BLOCK - 1) / BLOCK * BLOCK;
+        memcpy(chunk, msg + at, n);
+        memset(chunk + n, 0, padded - n);
+        mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_ENCRYPT, padded, mac, chunk, chunk);
+    }
+}
+
+// Counter block 0 masks the tag, the message runs from block 1
+static void ctr(const uint8_t *nonce, const uint8_t *in, size_t len, uint8_t *out, uint8_t *s0)
+{
+    uint8_t a[BLOCK], stream[BLOCK];
+    size_t offset = 0;
+
+    a[0] = 15 - AES_CCM_NONCE_BYTES - 1;
+    memcpy(a + 1, nonce, AES_CCM_NONCE_BYTES);
+    a[14] = a[15] = 0;
+    mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_ENCRYPT, a, s0);
+    a[15] = 1;
+    mbedtls_aes_crypt_ctr(&aes, len, &offset, a, stream, in, out);
+}
+
+esp_err_t telemetry_crypto_init(void)
+{
+    uint8_t key[AES_CCM_KEY_BYTES];
+    uint8_t mac[6];
+
+    ESP_RETURN_ON_FALSE(strlen(CONFIG_TELEMETRY_KEY) > 0, ESP_ERR_NOT_SUPPORTED, TAG, "no key configured");
+    ESP_RETURN_ON_FALSE(parse_key(CONFIG_TELEMETRY_KEY, key), ESP_ERR_INVALID_ARG, TAG, "key is not 32 hex digits");
+    ESP_RETURN_ON_ERROR(esp_efuse_mac_get_default(mac), TAG, "MAC");
+    node = (uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5];
+
+    mbedtls_aes_init(&aes);
+    int ret = mbedtls_aes_setkey_enc(&aes, key, 8 * AES_CCM_KEY_BYTES);
+    memset(key, 0, sizeof(key));
+    ESP_RETURN_ON_FALSE(ret == 0, ESP_FAIL, TAG, "key schedule");
+
+    // RTC memory is gone after a power cut, counting resumes at the reserved ceiling
+    if (state.magic != CRYPTO_STATE_MAGIC) {
+        uint64_t ceiling = 0;
+        size_t len = sizeof(ceiling);
+        if (hal_storage_read(CRYPTO_NVS_NAMESPACE, CRYPTO_NVS_KEY, &ceiling, &len) != HAL_OK || len != sizeof(ceiling)) {
+            ceiling = 0;
+        }
+        state = (counter_state_t){ .magic = CRYPTO_STATE_MAGIC, .next = ceiling, .ceiling = ceiling };
+    }
+    ready = true;
+    return ESP_OK;
+}
+
+esp_err_t telemetry_crypto_seal(const uint8_t *in, size_t len, uint8_t *out, size_t size, size_t *out_len,
+                                uint64_t *counter)
+{
+    uint8_t nonce[AES_CCM_NONCE_BYTES];
+    uint8_t mac[BLOCK], s0[BLOCK];
+
+    ESP_RETURN_ON_FALSE(ready, ESP_ERR_INVALID_STATE, TAG, "not initialised");
+    ESP_RETURN_ON_FALSE(size >= len + TELEMETRY_SEAL_OVERHEAD && len <= UINT16_MAX, ESP_ERR_INVALID_SIZE, TAG,
+                        "buffer too small");
+    if (state.next >= state.ceiling) {
+        ESP_RETURN_ON_ERROR(reserve(), TAG, "reserve");
+    }
+    *counter = state.next++;
+
+    telemetry_seal_header(out, node, *counter);
+    telemetry_seal_nonce(node, *counter, TELEMETRY_FROM_NODE, nonce);
+    cbc_mac(nonce, out, in, len, mac);
+    ctr(nonce, in, len, out + TELEMETRY_SEAL_HEADER_BYTES, s0);
+    for (int i = 0; i < AES_CCM_TAG_BYTES; i++) {
+        out[TELEMETRY_SEAL_HEADER_BYTES + len + i] = mac[i] ^ s0[i];
+    }
+    *out_len = len + TELEMETRY_SEAL_OVERHEAD;
+    return ESP_OK;
+}
+
+esp_err_t telemetry_crypto_open(const uint8_t *in, size_t len, uint8_t *out, size_t size, size_t *out_len)
+{
+    uint8_t nonce[AES_CCM_NONCE_BYTES];
+    uint8_t mac[BLOCK], s0[BLOCK];
+    uint8_t diff = 0;
+    uint32_t to;
+    uint64_t counter;
+
+    ESP_RETURN_ON_FALSE(ready, ESP_ERR_INVALID_STATE, TAG, "not initialised");
+    if (!telemetry_seal_parse(in, len, &to, &counter) || to != node || len - TELEMETRY_SEAL_OVERHEAD > size) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    len -= TELEMETRY_SEAL_OVERHEAD;
+    telemetry_seal_nonce(node, counter, TELEMETRY_FROM_GATEWAY, nonce);
+    ctr(nonce, in + TELEMETRY_SEAL_HEADER_BYTES, len, out, s0);
+    cbc_mac(nonce, in, out, len, mac);
+    for (int i = 0; i < AES_CCM_TAG_BYTES; i++) {
+        diff |= in[TELEMETRY_SEAL_HEADER_BYTES + len + i] ^ mac[i] ^ s0[i];
+    }
+    if (diff) {
+        memset(out, 0, len);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    // Only after the tag checked out, or forged counters could push the window forward
+    if (counter <= state.peer) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    state.peer = counter;
+    *out_len = len;
+    return ESP_OK;
+}
+
+uint32_t telemetry_crypto_node(void)
+{
+    return node;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// ===== CRYPTO CONFIGURATION =====
+#define CRYPTO_NVS_NAMESPACE     "seal"
+#define CRYPTO_NVS_KEY           "ceiling"
+#define CRYPTO_STATE_MAGIC       0x4C414553U       // "SEAL"
+#define CRYPTO_RESERVE           1024              // Counters reserved in flash per write
+#define CRYPTO_CHUNK_BYTES       256               // Message bytes per CBC-MAC pass through the accelerator
+
+// Seals telemetry (format in telemetry.h) with the key set in menuconfig under "Telemetry
+// link". AES runs on the chip's accelerator through mbedtls with CONFIG_MBEDTLS_HARDWARE_AES,
+// and CCM is put together from whole CBC and CTR runs rather than block by block, so
+// chips with AES DMA stream them. The counter lives in RTC memory. Flash holds a ceiling
+// CRYPTO_RESERVE above it, and after a power cut counting resumes from that ceiling, so a
+// nonce is never used twice for one key.
+
+// ESP_ERR_NOT_SUPPORTED if no key is configured, ESP_ERR_INVALID_ARG if it is not 32 hex
+// digits. Needs hal_storage_init first.
+esp_err_t telemetry_crypto_init(void);
+
+// Seal len bytes of in into out under the next counter, which is returned in counter
+esp_err_t telemetry_crypto_seal(const uint8_t *in, size_t len, uint8_t *out, size_t size, size_t *out_len,
+                                uint64_t *counter);
+
+// Check and decrypt a datagram the gateway sealed for this node. ESP_ERR_INVALID_RESPONSE
+// if it is not one, ESP_ERR_INVALID_STATE if its counter is not newer than the last accepted.
+esp_err_t telemetry_crypto_open(const uint8_t *in, size_t len, uint8_t *out, size_t size, size_t *out_len);
+
+// Node number in sealed headers
+uint32_t telemetry_crypto_node(void);
@@ -0,0 +1,336 @@
+#include "telemetry_link.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_netif_net_stack.h"
+#include "esp_rom_crc.h"
+#include "esp_wifi.h"
+#include "lwip/dhcp.h"
+#include "lwip/sockets.h"
+#include "mbedtls/pkcs5.h"
+#include "board_hal.h"
+#include "telemetry.h"
+#include "telemetry_crypto.h"
+
+#define TAG "TELEMETRY_LINK"
+#define CONNECTED_BIT            BIT0
+#define GOT_IP_BIT               BIT1
+#define FAILED_BIT               BIT2
+#define PMK_BYTES                32
+#define PBKDF2_ROUNDS            4096              // WPA2-PSK
+
+// Everything a connect needs to skip the scan, the PMK derivation and DHCP
+typedef struct {
+    uint32_t magic;
+    uint32_t config_crc;       // Network and password the rest belongs to
+    uint8_t  bssid[6];
+    uint8_t  channel;
+    uint8_t  reserved;
+    uint8_t  pmk[PMK_BYTES];
+    uint32_t ip;               // Lease, network byte order, 0 for none
+    uint32_t netmask;
+    uint32_t gw;
+    uint32_t lease_s;          // Server's renewal time T1, the address is reused until then
+    int64_t  leased_at_us;
+} link_cache_t;
+
+static RTC_DATA_ATTR link_cache_t cache;
+static esp_netif_t *netif;
+static EventGroupHandle_t link_events;
+static telemetry_link_stats_t last;
+static bool link_open;
+static bool sealed;                                // Key configured, datagrams go out sealed
+static int64_t on_us;                              // Radio switched on
+
+static uint32_t config_crc(void)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)CONFIG_TELEMETRY_WIFI_SSID, strlen(CONFIG_TELEMETRY_WIFI_SSID));
+    return esp_rom_crc32_le(crc, (const uint8_t *)CONFIG_TELEMETRY_WIFI_PASSWORD, strlen(CONFIG_TELEMETRY_WIFI_PASSWORD));
+}
+
+static bool cache_valid(void)
+{
+    return cache.magic == LINK_CACHE_MAGIC && cache.config_crc == config_crc();
+}
+
+static bool lease_valid(void)
+{
+    return cache.ip != 0 && hal_time_us() - cache.leased_at_us < cache.lease_s * 1000000LL;
+}
+
+static void on_event(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
+        esp_wifi_connect();
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_CONNECTED) {
+        xEventGroupSetBits(link_events, CONNECTED_BIT);
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        xEventGroupSetBits(link_events, FAILED_BIT);
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        xEventGroupSetBits(link_events, GOT_IP_BIT);
+    }
+}
+
+static esp_err_t link_up(bool direct, bool dhcp)
+{
+    wifi_config_t config = { 0 };
+
+    strlcpy((char *)config.sta.ssid, CONFIG_TELEMETRY_WIFI_SSID, sizeof(config.sta.ssid));
+    if (direct) {
+        // 64 hex digits are taken as the PMK itself, no PBKDF2 on the way in
+        if (strlen(CONFIG_TELEMETRY_WIFI_PASSWORD) > 0) {
+            for (int i = 0; i < PMK_BYTES; i++) {
+                snprintf((char *)config.sta.password + 2 * i, 3, "%02x", cache.pmk[i]);
+            }
+        }
+        memcpy(config.sta.bssid, cache.bssid, sizeof(cache.bssid));
+        config.sta.bssid_set = true;
+        config.sta.channel = cache.channel;
+        config.sta.scan_method = WIFI_FAST_SCAN;
+    } else {
+        strlcpy((char *)config.sta.password, CONFIG_TELEMETRY_WIFI_PASSWORD, sizeof(config.sta.password));
+        config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    }
+
+    if (dhcp) {
+        esp_err_t err = esp_netif_dhcpc_start(netif);
+        ESP_RETURN_ON_FALSE(err == ESP_OK || err == ESP_ERR_ESP_NETIF_DHCP_ALREADY_STARTED, err, TAG, "dhcp");
+    } else {
+        esp_netif_ip_info_t ip = { .ip.addr = cache.ip, .netmask.addr = cache.netmask, .gw.addr = cache.gw };
+        esp_netif_dhcpc_stop(netif);
+        ESP_RETURN_ON_ERROR(esp_netif_set_ip_info(netif, &ip), TAG, "static address");
+    }
+
+    xEventGroupClearBits(link_events, CONNECTED_BIT | GOT_IP_BIT | FAILED_BIT);
+    ESP_RETURN_ON_ERROR(esp_wifi_set_config(WIFI_IF_STA, &config), TAG, "config");
+    ESP_RETURN_ON_ERROR(esp_wifi_start(), TAG, "start");
+    EventBits_t up = dhcp ? GOT_IP_BIT : CONNECTED_BIT;
+    EventBits_t bits = xEventGroupWaitBits(link_events, up | FAILED_BIT, pdFALSE, pdFALSE,
+                                           pdMS_TO_TICKS(direct ? LINK_DIRECT_TIMEOUT_MS : LINK_SCAN_TIMEOUT_MS));
+    if (!(bits & up)) {
+        esp_wifi_stop();
+        return (bits & FAILED_BIT) ? ESP_FAIL : ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+// Sealed, the gateway answers with the counter of the datagram, sealed in turn
+static bool sealed_ack(const uint8_t *reply, int len, uint64_t counter)
+{
+    uint8_t ack[TELEMETRY_ACK_BYTES];
+    size_t ack_len;
+    uint64_t acked;
+
+    if (len <= 0 || telemetry_crypto_open(reply, len, ack, sizeof(ack), &ack_len) != ESP_OK
+        || ack_len != sizeof(acked)) {
+        return false;
+    }
+    memcpy(&acked, ack, sizeof(acked));
+    return acked == counter;
+}
+
+// In the clear, the gateway answers each datagram with its CRC-32, little-endian like the node
+static esp_err_t send_datagram(const uint8_t *datagram, size_t len)
+{
+    static uint8_t wire[LINK_MAX_DATAGRAM];
+    struct sockaddr_in to = { .sin_family = AF_INET, .sin_port = htons(CONFIG_TELEMETRY_GATEWAY_PORT) };
+    struct timeval timeout = { .tv_sec = 0, .tv_usec = LINK_ACK_TIMEOUT_MS * 1000 };
+    const uint8_t *frame = datagram;
+    uint8_t reply[TELEMETRY_SEAL_OVERHEAD + TELEMETRY_ACK_BYTES];
+    uint64_t counter = 0;
+    esp_err_t err = ESP_ERR_TIMEOUT;
+
+    // Sealed once, so retries carry the same counter and the gateway can spot them
+    if (sealed) {
+        ESP_RETURN_ON_ERROR(telemetry_crypto_seal(datagram, len, wire, sizeof(wire), &len, &counter), TAG, "seal");
+        frame = wire;
+    }
+    uint32_t crc = esp_rom_crc32_le(0, frame, len);
+
+    ESP_RETURN_ON_FALSE(inet_pton(AF_INET, CONFIG_TELEMETRY_GATEWAY_IP, &to.sin_addr) == 1, ESP_ERR_INVALID_ARG, TAG,
+                        "gateway address");
+    int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ESP_RETURN_ON_FALSE(s >= 0, ESP_FAIL, TAG, "socket");
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    // The first datagram can be lost while ARP resolves the gateway
+    for (int attempt = 0; attempt < LINK_SEND_ATTEMPTS && err != ESP_OK; attempt++) {
+        if (sendto(s, frame, len, 0, (struct sockaddr *)&to, sizeof(to)) != (int)len) {
+            continue;
+        }
+        int got = recv(s, reply, sizeof(reply), 0);
+        if (sealed ? sealed_ack(reply, got, counter) : got == sizeof(crc) && memcmp(reply, &crc, sizeof(crc)) == 0) {
+            err = ESP_OK;
+        }
+    }
+    close(s);
+    return err;
+}
+
+// Remember where a connect that scanned or asked DHCP ended up. Radio still on.
+static void learn(bool scanned)
+{
+    wifi_ap_record_t ap;
+    esp_netif_ip_info_t ip;
+    struct dhcp *dhcp = netif_dhcp_data((struct netif *)esp_netif_get_netif_impl(netif));
+
+    if (scanned && esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        memcpy(cache.bssid, ap.bssid, sizeof(cache.bssid));
+        cache.channel = ap.primary;
+    }
+    if (esp_netif_get_ip_info(netif, &ip) == ESP_OK) {
+        cache.ip = ip.ip.addr;
+        cache.netmask = ip.netmask.addr;
+        cache.gw = ip.gw.addr;
+        // lwIP falls back to half the lease when the server sends no T1
+        cache.lease_s = dhcp ? dhcp->offered_t1_renew : 0;
+        cache.leased_at_us = hal_time_us();
+    }
+}
+
+// After a scan, once the radio is off again: the PMK costs the CPU time here instead of
+// radio time on every connect
+static void store_cache(void)
+{
+    const char *ssid = CONFIG_TELEMETRY_WIFI_SSID;
+    const char *password = CONFIG_TELEMETRY_WIFI_PASSWORD;
+    link_cache_t stored;
+
+    if (mbedtls_pkcs5_pbkdf2_hmac_ext(MBEDTLS_MD_SHA1, (const unsigned char *)password, strlen(password),
+                                      (const unsigned char *)ssid, strlen(ssid), PBKDF2_ROUNDS, PMK_BYTES,
+                                      cache.pmk) != 0) {
+        return;
+    }
+    cache.config_crc = config_crc();
+    cache.magic = LINK_CACHE_MAGIC;
+
+    // The lease is only worth keeping while the clock runs
+    stored = cache;
+    stored.ip = 0;
+    if (hal_storage_write(LINK_NVS_NAMESPACE, LINK_NVS_KEY, &stored, sizeof(stored)) != HAL_OK) {
+        ESP_LOGW(TAG, "Access point cache not saved");
+    }
+}
+
+esp_err_t telemetry_link_init(void)
+{
+    ESP_RETURN_ON_FALSE(strlen(CONFIG_TELEMETRY_WIFI_SSID) > 0, ESP_ERR_NOT_SUPPORTED, TAG, "no network configured");
+    // A key that does not parse must not quietly turn into uploads in the clear
+    esp_err_t err = telemetry_crypto_init();
+    ESP_RETURN_ON_FALSE(err == ESP_OK || err == ESP_ERR_NOT_SUPPORTED, err, TAG, "key");
+    sealed = (err == ESP_OK);
+    link_events = xEventGroupCreate();
+    ESP_RETURN_ON_FALSE(link_events, ESP_ERR_NO_MEM, TAG, "events");
+    ESP_RETURN_ON_ERROR(esp_netif_init(), TAG, "netif");
+    err = esp_event_loop_create_default();
+    ESP_RETURN_ON_FALSE(err == ESP_OK || err == ESP_ERR_INVALID_STATE, err, TAG, "event loop");
+    netif = esp_netif_create_default_wifi_sta();
+    ESP_RETURN_ON_FALSE(netif, ESP_ERR_NO_MEM, TAG, "station");
+
+    wifi_init_config_t config = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_RETURN_ON_ERROR(esp_wifi_init(&config), TAG, "wifi");
+    // The cache below replaces the driver's own NVS copy of the configuration
+    ESP_RETURN_ON_ERROR(esp_wifi_set_storage(WIFI_STORAGE_RAM), TAG, "storage");
+    ESP_RETURN_ON_ERROR(esp_wifi_set_mode(WIFI_MODE_STA), TAG, "mode");
+    ESP_RETURN_ON_ERROR(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, on_event, NULL), TAG, "events");
+    ESP_RETURN_ON_ERROR(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_event, NULL), TAG, "events");
+
+    // RTC memory is gone after a power cut, NVS still knows the access point
+    if (!cache_valid()) {
+        size_t len = sizeof(cache);
+        if (hal_storage_read(LINK_NVS_NAMESPACE, LINK_NVS_KEY, &cache, &len) != HAL_OK || len != sizeof(cache)) {
+            cache.magic = 0;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t telemetry_link_open(void)
+{
+    ESP_RETURN_ON_FALSE(link_events, ESP_ERR_INVALID_STATE, TAG, "not initialised");
+    ESP_RETURN_ON_FALSE(!link_open, ESP_ERR_INVALID_STATE, TAG, "already open");
+    bool direct = cache_valid();
+    bool dhcp = !direct || !lease_valid();
+    esp_err_t err = ESP_FAIL;
+
+    on_us = hal_time_us();
+    if (direct) {
+        err = link_up(true, dhcp);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Cached access point unreachable (%s), scanning", esp_err_to_name(err));
+            direct = false;
+            dhcp = true;
+        }
+    }
+    if (!direct) {
+        err = link_up(false, true);
+    }
+    last = (telemetry_link_stats_t){
+        .connect_ms = (uint32_t)((hal_time_us() - on_us) / 1000),
+        .radio_ms = (uint32_t)((hal_time_us() - on_us) / 1000),
+        .direct = direct,
+        .dhcp = dhcp,
+    };
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "No link after %" PRIu32 " ms: %s", last.radio_ms, esp_err_to_name(err));
+        return err;
+    }
+    if (dhcp) {
+        learn(!direct);
+    }
+    link_open = true;
+    return ESP_OK;
+}
+
+esp_err_t telemetry_link_put(const uint8_t *datagram, size_t len)
+{
+    ESP_RETURN_ON_FALSE(link_open, ESP_ERR_INVALID_STATE, TAG, "not open");
+    ESP_RETURN_ON_FALSE(len <= LINK_MAX_PAYLOAD, ESP_ERR_INVALID_SIZE, TAG, "datagram too long");
+    return send_datagram(datagram, len);
+}
+
+void telemetry_link_close(void)
+{
+    if (!link_open) {
+        return;
+    }
+    esp_wifi_disconnect();
+    esp_wifi_stop();
+    link_open = false;
+    last.radio_ms = (uint32_t)((hal_time_us() - on_us) / 1000);
+    ESP_LOGI(TAG, "%s connect in %" PRIu32 " ms%s, radio on %" PRIu32 " ms", last.direct ? "Direct" : "Full",
+             last.connect_ms, last.dhcp ? " with DHCP" : "", last.radio_ms);
+    if (!last.direct) {
+        store_cache();
+    }
+}
+
+esp_err_t telemetry_link_send(const uint8_t *frame, size_t len)
+{
+    esp_err_t err = telemetry_link_open();
+
+    if (err == ESP_OK) {
+        err = telemetry_link_put(frame, len);
+        telemetry_link_close();
+    }
+    return err;
+}
+
+void telemetry_link_forget(void)
+{
+    cache.magic = 0;
+}
+
+void telemetry_link_stats(telemetry_link_stats_t *stats)
+{
+    *stats = last;
+}
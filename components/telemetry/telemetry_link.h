@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "telemetry.h"
+
+// ===== LINK CONFIGURATION =====
+#define LINK_NVS_NAMESPACE       "link"
+#define LINK_NVS_KEY             "ap"
+#define LINK_CACHE_MAGIC         0x4B4E494CU       // "LINK"
+#define LINK_DIRECT_TIMEOUT_MS   1500              // Cached access point silent this long, scan instead
+#define LINK_SCAN_TIMEOUT_MS     10000             // Full scan, association and DHCP
+#define LINK_ACK_TIMEOUT_MS      300
+#define LINK_SEND_ATTEMPTS       3
+#define LINK_MAX_DATAGRAM        1400              // Stays within one Ethernet MTU through the access point
+#define LINK_MAX_PAYLOAD         (LINK_MAX_DATAGRAM - TELEMETRY_SEAL_OVERHEAD)  // Room left for sealing
+
+// Uploads frames as UDP datagrams to the gateway over Wi-Fi, set up in menuconfig under
+// "Telemetry link". The radio is only on between telemetry_link_open and _close. A cold connect
+// scans every channel, derives the PMK from the password in 4096 rounds of PBKDF2 and
+// waits for DHCP. The access point, its channel, the PMK and the address are then
+// cached in RTC memory, with NVS keeping all but the address through a power cut, so
+// the next connect goes straight to that access point. The address is reused without
+// DHCP until the renewal time (T1) the server gave with the lease. With a key configured every
+// datagram goes out sealed (telemetry_crypto.h) and only a sealed acknowledgement counts.
+typedef struct {
+    uint32_t connect_ms;       // Radio on to link up
+    uint32_t radio_ms;         // Radio on to off
+    bool     direct;           // Went straight to the cached access point
+    bool     dhcp;             // Asked DHCP for an address
+} telemetry_link_stats_t;
+
+// Start the Wi-Fi driver, radio off. Needs hal_storage_init first. ESP_ERR_NOT_SUPPORTED
+// if no network is configured.
+esp_err_t telemetry_link_init(void);
+
+// Bring the link up. A direct connect that fails falls back to a full one.
+esp_err_t telemetry_link_open(void);
+
+// Send one datagram of up to LINK_MAX_PAYLOAD bytes until the gateway acknowledges it
+esp_err_t telemetry_link_put(const uint8_t *datagram, size_t len);
+
+// Take the radio down again
+void telemetry_link_close(void);
+
+// Open, put frame and close
+esp_err_t telemetry_link_send(const uint8_t *frame, size_t len);
+
+// Drop the cached access point, so the next send scans. The NVS copy is only read at init.
+void telemetry_link_forget(void);
+
+// Timings of the last connection
+void telemetry_link_stats(telemetry_link_stats_t *stats);
@@ -0,0 +1,155 @@
+// Convert an hourly forecast CSV to the on-device forecast format.
+//   forecast_csv <in.csv> <out.bin>
+// Writes the binary blob and prints the matching console upload line, so it can be
+// sent straight to the node:  forecast_csv in.csv out.bin > /dev/ttyUSB0
+//
+// The CSV needs a header row with a time column (ISO 8601 "YYYY-MM-DDTHH:MM" in UTC or
+// Unix seconds), a precipitation probability column and a temperature column (C), as
+// in Open-Meteo's CSV export. Metadata lines before the header are skipped.
+
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "forecast.h"
+
+#define LINE_MAX_CHARS           1024
+#define MAX_COLUMNS              32
+#define HOUR_S                   3600
+
+static forecast_t forecast;
+static uint8_t blob[FORECAST_MAX_BYTES];
+
+static int split(char *line, char **fields)
+{
+    char *field;
+    int n = 0;
+
+    line[strcspn(line, "\r\n")] = '\0';
+    while (n < MAX_COLUMNS && (field = strsep(&line, ",")) != NULL) {
+        while (isspace((unsigned char)*field)) {
+            field++;
+        }
+        fields[n++] = field;
+    }
+    return n;
+}
+
+static int find_column(char **fields, int n, const char *name)
+{
+    for (int i = 0; i < n; i++) {
+        if (strstr(fields[i], name) != NULL) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool parse_time(const char *text, time_t *out)
+{
+    struct tm tm = { 0 };
+    char *end;
+
+    long long unix_s = strtoll(text, &end, 10);
+    if (*end == '\0' && end != text) {
+        *out = unix_s;
+        return true;
+    }
+    if (sscanf(text, "%d-%d-%d%*c%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min) != 5) {
+        return false;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    *out = timegm(&tm);
+    return true;
+}
+
+static int clamp(double v, int lo, int hi)
+{
+    int i = (int)(v < 0 ? v - 0.5 : v + 0.5);
+    return i < lo ? lo : (i > hi ? hi : i);
+}
+
+int main(int argc, char **argv)
+{
+    char line[LINE_MAX_CHARS];
+    char *fields[MAX_COLUMNS];
+    int time_col = -1, rain_col = -1, temp_col = -1;
+    bool have_start = false;
+    int row = 0;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <in.csv> <out.bin>\n", argv[0]);
+        return 1;
+    }
+    FILE *in = fopen(argv[1], "r");
+    if (in == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), in)) {
+        row++;
+        int n = split(line, fields);
+        if (time_col < 0) {
+            time_col = (n > 0 && strncmp(fields[0], "time", 4) == 0) ? 0 : -1;
+            rain_col = find_column(fields, n, "precipitation_probability");
+            temp_col = find_column(fields, n, "temperature");
+            if (time_col < 0 || rain_col < 0 || temp_col < 0) {
+                time_col = -1;
+            }
+            continue;
+        }
+        if (n <= rain_col || n <= temp_col || fields[time_col][0] == '\0') {
+            continue;
+        }
+
+        time_t t;
+        if (!parse_time(fields[time_col], &t)) {
+            fprintf(stderr, "line %d: bad time '%s'\n", row, fields[time_col]);
+            return 1;
+        }
+        if (!have_start) {
+            forecast.start_s = (uint32_t)(t - t % HOUR_S);
+            have_start = true;
+        }
+        if (t < (time_t)forecast.start_s || (t - forecast.start_s) % HOUR_S != 0) {
+            fprintf(stderr, "line %d: rows must be hourly and in order\n", row);
+            return 1;
+        }
+        long h = (t - forecast.start_s) / HOUR_S;
+        if (h >= FORECAST_MAX_HOURS) {
+            fprintf(stderr, "truncated to %d hours\n", FORECAST_MAX_HOURS);
+            break;
+        }
+        // Gaps repeat the previous hour rather than reading as a dry forecast
+        for (long g = forecast.hours; g < h; g++) {
+            forecast.hour[g] = forecast.hour[g - 1];
+        }
+        forecast.hour[h].rain_pct = clamp(atof(fields[rain_col]), 0, 100);
+        forecast.hour[h].temp_c = clamp(atof(fields[temp_col]), INT8_MIN, INT8_MAX);
+        forecast.hours = h + 1;
+    }
+    fclose(in);
+
+    if (forecast.hours == 0) {
+        fprintf(stderr, "%s: no hourly rows with time, precipitation_probability and temperature\n", argv[1]);
+        return 1;
+    }
+    size_t len = forecast_encode(&forecast, blob, sizeof(blob));
+    FILE *out = fopen(argv[2], "wb");
+    if (out == NULL || fwrite(blob, 1, len, out) != len || fclose(out) != 0) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    fprintf(stderr, "%d hours from %s", forecast.hours, ctime(&(time_t){ forecast.start_s }));
+    printf("%s", FORECAST_CONSOLE_CMD);
+    for (size_t i = 0; i < len; i++) {
+        printf("%02x", blob[i]);
+    }
+    printf("\n");
+    return 0;
+}
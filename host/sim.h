@@ -0,0 +1,9 @@
+#pragma once
+
+// Studies run by irrigation_sim. Each prints its own report and returns 0 on success.
+int sim_soak(int argc, char **argv);
+int sim_frost(int argc, char **argv);
+int sim_clock(int argc, char **argv);
+int sim_tank(int argc, char **argv);
+int sim_sampling(int argc, char **argv);
+int sim_telemetry(int argc, char **argv);
@@ -0,0 +1,183 @@
+// Clock study. Runs the planner and pump journal on the host HAL's virtual clock across
+// the points where a 32-bit count of microseconds, milliseconds or seconds would wrap,
+// deep sleeping between events like the firmware and taking a soft reset mid-cycle.
+// Every cycle must start on its period and deliver its full run time, to the second.
+//   irrigation_sim clock
+
+#include <inttypes.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "sim.h"
+#include "hal_host.h"
+#include "journal.h"
+#include "planner.h"
+
+#define HOUR_US                  (3600LL * 1000000)
+#define SPAN_US                  (48 * HOUR_US)    // Simulated either side of each boundary
+#define SAMPLE_US                1000000LL         // Flow sample period while a pulse runs
+#define ZONES                    2
+
+typedef struct {
+    const char *name;
+    int64_t     at_us;
+} boundary_t;
+
+static const boundary_t boundaries[] = {
+    { "2^31 us", 1LL << 31 },
+    { "2^32 us", 1LL << 32 },
+    { "2^31 ms", (1LL << 31) * 1000 },
+    { "2^32 ms", (1LL << 32) * 1000 },
+    { "2^31 s", (1LL << 31) * 1000000 },
+    { "2^32 s", (1LL << 32) * 1000000 },
+};
+
+static const zone_rule_t rules[ZONES] = {
+    { .enabled = true, .interval_s = 8 * 3600 + 600, .duration_s = 600, .offset_s = 0 },
+    { .enabled = true, .interval_s = 24 * 3600, .duration_s = 1800, .offset_s = 5 * 3600 + 17 },
+};
+
+// Everything below survives deep sleep and soft resets, like RTC memory
+static jmp_buf boot;
+static plan_t plan;
+static journal_t journal;
+static int64_t first_start_us[ZONES];
+static int64_t pulse_end_us;
+static int running_zone;
+static bool reset_taken;
+static int64_t boundary_us;
+static int starts, errors, samples, wakeups;
+
+static hal_timer_t sample_timer;
+
+static void on_deep_sleep(int64_t wake_at_us)
+{
+    (void)wake_at_us;
+    hal_host_reset(HAL_RESET_DEEP_SLEEP);
+    longjmp(boot, 1);
+}
+
+static void on_sample(void *arg)
+{
+    (void)arg;
+    int64_t now_us = hal_time_us();
+
+    samples++;
+    journal_checkpoint(&journal, 1U << running_zone, now_us);
+    if (now_us + SAMPLE_US <= pulse_end_us) {
+        hal_timer_start_at(sample_timer, now_us + SAMPLE_US);
+    }
+}
+
+// Light sleep through a pulse with the flow sample timer running. The first pulse past
+// the boundary is cut short by a soft reset halfway through.
+static void run_pulse(int zone, uint32_t run_s)
+{
+    int64_t now_us = hal_time_us();
+    int64_t end_us = now_us + (int64_t)run_s * 1000000;
+    int first = samples;
+
+    running_zone = zone;
+    pulse_end_us = end_us;
+    journal_pulse_start(&journal, zone, now_us);
+    hal_timer_start_at(sample_timer, now_us + SAMPLE_US);
+    if (!reset_taken && now_us >= boundary_us) {
+        reset_taken = true;
+        hal_sleep_light_until(now_us + (int64_t)(run_s / 2) * 1000000);
+        hal_host_reset(HAL_RESET_SOFTWARE);
+        longjmp(boot, 1);
+    }
+    hal_sleep_light_until(end_us);
+    journal_pulse_stop(&journal, zone, hal_time_us());
+    if (samples - first != (int)run_s) {
+        printf("  zone %d: %d flow samples in a %" PRIu32 " s pulse\n", zone, samples - first, run_s);
+        errors++;
+    }
+}
+
+static void handle(const plan_event_t *ev, int64_t now_us)
+{
+    int64_t period_us = (int64_t)rules[ev->zone].interval_s * 1000000;
+
+    if (ev->type == PLAN_EVENT_STOP) {
+        if (journal_delivered_s(&journal, ev->zone) != rules[ev->zone].duration_s) {
+            printf("  zone %d: delivered %" PRIu32 " of %" PRIu32 " s\n", ev->zone,
+                   journal_delivered_s(&journal, ev->zone), rules[ev->zone].duration_s);
+            errors++;
+        }
+        journal_done(&journal, ev->zone);
+        return;
+    }
+    if (first_start_us[ev->zone] < 0) {
+        first_start_us[ev->zone] = ev->at_us;
+    } else if ((ev->at_us - first_start_us[ev->zone]) % period_us != 0) {
+        printf("  zone %d: start %lld us off its period\n", ev->zone,
+               (long long)((ev->at_us - first_start_us[ev->zone]) % period_us));
+        errors++;
+    }
+    if (now_us != ev->at_us) {
+        printf("  zone %d: woke %lld us after the start\n", ev->zone, (long long)(now_us - ev->at_us));
+        errors++;
+    }
+    starts++;
+    journal_intent(&journal, ev->zone, rules[ev->zone].duration_s);
+    run_pulse(ev->zone, rules[ev->zone].duration_s);
+}
+
+// The firmware's boot path, re-entered after every deep sleep and reset
+static void run(int64_t end_us)
+{
+    plan_event_t ev;
+
+    hal_timer_create(on_sample, NULL, "sample", &sample_timer);
+    if (hal_reset_reason() == HAL_RESET_SOFTWARE) {
+        // The plan's stop event is still due when the remaining run time is delivered
+        run_pulse(running_zone, journal_remaining_s(&journal, running_zone));
+    }
+    while (hal_time_us() < end_us) {
+        int64_t now_us = hal_time_us();
+        wakeups++;
+        if (planner_needs_build(&plan, now_us)) {
+            planner_build(&plan, rules, ZONES, now_us);
+        }
+        while (planner_pop_due(&plan, now_us, &ev)) {
+            handle(&ev, now_us);
+            now_us = hal_time_us();
+        }
+        hal_sleep_deep_until(planner_next_wake_us(&plan));
+    }
+}
+
+int sim_clock(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    // Written between setjmp and the longjmp of every simulated reset
+    volatile int failed = 0;
+
+    hal_host_on_deep_sleep(on_deep_sleep);
+    printf("%-8s %18s %8s %8s %8s %8s\n", "boundary", "at_us", "wakeups", "starts", "samples", "errors");
+    for (size_t b = 0; b < sizeof(boundaries) / sizeof(boundaries[0]); b++) {
+        boundary_us = boundaries[b].at_us;
+        int64_t begin_us = (boundary_us > SPAN_US) ? boundary_us - SPAN_US : 0;
+
+        hal_host_reset(HAL_RESET_POWER_ON);
+        hal_host_set_time_us(begin_us);
+        planner_invalidate(&plan);
+        journal_reset(&journal);
+        for (int z = 0; z < ZONES; z++) {
+            first_start_us[z] = -1;
+        }
+        reset_taken = false;
+        starts = errors = samples = wakeups = 0;
+
+        setjmp(boot);
+        run(boundary_us + SPAN_US);
+
+        printf("%-8s %18lld %8d %8d %8d %8d\n", boundaries[b].name, (long long)boundary_us,
+               wakeups, starts, samples, errors);
+        failed |= errors || !reset_taken;
+    }
+    printf("%s\n", failed ? "FAIL" : "all cycles on time and complete");
+    return failed;
+}
@@ -0,0 +1,180 @@
+// Frost protection study. Replays a temperature trace against a dawn watering plan
+// and compares the frost gate with watering blindly on schedule, first as main.c ships
+// with circulation off, then with anti-freeze circulation runs.
+//   irrigation_sim frost [trace.csv]    (trace lines: hours,temperature_c)
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "sim.h"
+#include "frost.h"
+#include "planner.h"
+
+#define DAYS                     30
+#define HOUR_US                  (3600LL * 1000000)
+#define MAX_TRACE                (DAYS * 24 + 1)
+#define FREEZE_DC                0
+
+// As in main.c, and the same with circulation on
+static const frost_config_t configs[] = {
+    {
+        .postpone_below_dc = 30,
+        .resume_above_dc = 50,
+        .circulate_below_dc = 5,
+        .retry_s = 60 * 60,
+        .max_postpone_s = 6 * 60 * 60,
+        .circulate_s = 0,
+        .check_s = 30 * 60,
+    },
+    {
+        .postpone_below_dc = 30,
+        .resume_above_dc = 50,
+        .circulate_below_dc = 5,
+        .retry_s = 60 * 60,
+        .max_postpone_s = 6 * 60 * 60,
+        .circulate_s = 30,
+        .check_s = 30 * 60,
+    },
+};
+
+// One cycle a day at 06:00, ten minutes long
+static const zone_rule_t rule = { .enabled = true, .interval_s = 24 * 3600, .duration_s = 600, .offset_s = 6 * 3600 };
+
+static double trace[MAX_TRACE];
+static int trace_len;
+static plan_t plan;
+static frost_state_t state;
+
+// Early spring: mild days with a cold snap in the second week
+static void synthetic_trace(void)
+{
+    for (int h = 0; h < MAX_TRACE; h++) {
+        double day = h / 24.0;
+        double mean = 8 + 0.15 * day - ((day > 8 && day < 14) ? 7 : 0);
+        trace[h] = mean + 6 * sin(2 * M_PI * (h % 24 - 9) / 24.0);
+    }
+    trace_len = MAX_TRACE;
+}
+
+static bool load_trace(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    double hours, temp;
+
+    if (!f) {
+        return false;
+    }
+    trace_len = 0;
+    while (trace_len < MAX_TRACE && fscanf(f, "%lf,%lf", &hours, &temp) == 2) {
+        trace[trace_len++] = temp;
+    }
+    fclose(f);
+    return trace_len > 1;
+}
+
+static int16_t temp_at(int64_t t_us)
+{
+    double h = (double)t_us / HOUR_US;
+    int i = (int)h;
+
+    if (i >= trace_len - 1) {
+        return (int16_t)lround(trace[trace_len - 1] * 10);
+    }
+    return (int16_t)lround((trace[i] + (trace[i + 1] - trace[i]) * (h - i)) * 10);
+}
+
+// Returns the cycles watered below freezing, which should be none
+static int run(const frost_config_t *cfg)
+{
+    int planned = 0, watered = 0, postponed = 0, skipped = 0, circulations = 0;
+    int blind_below_freeze = 0, blind_below_gate = 0, watered_below_freeze = 0;
+    int wakeups = 0, frost_wakeups = 0;
+    int64_t frost_check_us = INT64_MAX;
+    int64_t end_us = (int64_t)DAYS * 24 * HOUR_US;
+
+    state = (frost_state_t){ 0 };
+    planner_invalidate(&plan);
+    planner_build(&plan, &rule, 1, 0);
+    while (true) {
+        int64_t plan_us = planner_next_wake_us(&plan);
+        int64_t now_us = (frost_check_us < plan_us) ? frost_check_us : plan_us;
+        if (now_us >= end_us) {
+            break;
+        }
+        int16_t temp = temp_at(now_us);
+        bool pumping = false;
+        wakeups++;
+
+        if (now_us == frost_check_us) {
+            frost_wakeups++;
+        }
+        if (planner_needs_build(&plan, now_us)) {
+            planner_build(&plan, &rule, 1, now_us);
+        }
+
+        plan_event_t ev;
+        while (planner_pop_due(&plan, now_us, &ev)) {
+            if (ev.type != PLAN_EVENT_START) {
+                continue;
+            }
+            if (!(state.held & 1)) {
+                planned++;
+                blind_below_freeze += temp < FREEZE_DC;
+                blind_below_gate += temp < cfg->postpone_below_dc;
+            }
+            frost_action_t action = frost_check_start(cfg, &state, 0, temp, now_us);
+            if (action == FROST_WATER) {
+                watered++;
+                watered_below_freeze += temp < FREEZE_DC;
+                pumping = true;
+                continue;
+            }
+            int64_t retry_us = now_us + (int64_t)cfg->retry_s * 1000000;
+            plan_event_t retry[2] = {
+                { retry_us, 0, PLAN_EVENT_START },
+                { retry_us + (int64_t)rule.duration_s * 1000000, 0, PLAN_EVENT_STOP },
+            };
+            if (action == FROST_POSTPONE && planner_replace_cycles(&plan, 1, retry, 2)) {
+                postponed++;
+            } else {
+                skipped++;
+                planner_replace_cycles(&plan, 1, NULL, 0);
+            }
+        }
+
+        // Same rule as the firmware: circulate idle lines and re-check while freezing
+        if (frost_protecting(cfg, temp)) {
+            circulations += !pumping;
+            frost_check_us = now_us + (int64_t)cfg->check_s * 1000000;
+        } else {
+            frost_check_us = INT64_MAX;
+        }
+    }
+
+    printf("== %s\n", cfg->circulate_s ? "circulation on" : "circulation off, as main.c ships");
+    printf("%d days, %d planned cycles\n", DAYS, planned);
+    printf("blind schedule:  %d cycles started below %.1f C, %d below 0 C\n",
+           blind_below_gate, cfg->postpone_below_dc / 10.0, blind_below_freeze);
+    printf("frost gate:      %d watered (%d below 0 C), %d postponements, %d skipped\n",
+           watered, watered_below_freeze, postponed, skipped);
+    printf("circulation:     %d runs of %u s\n", circulations, cfg->circulate_s);
+    printf("wakeups:         %d total, %d only for frost checks\n\n", wakeups, frost_wakeups);
+    return watered_below_freeze;
+}
+
+int sim_frost(int argc, char **argv)
+{
+    int failed = 0;
+
+    if (argc >= 2 && !load_trace(argv[1])) {
+        fprintf(stderr, "cannot read trace %s\n", argv[1]);
+        return 1;
+    }
+    if (argc < 2) {
+        synthetic_trace();
+    }
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        failed |= run(&configs[c]) != 0;
+    }
+    return failed;
+}
@@ -0,0 +1,134 @@
+// Adaptive sampling study. A month of soil moisture on one zone, drying faster by day
+// than by night, with rain the controller is not told about. The controller waters as
+// soon as its estimate reaches the dry threshold. Fixed-rate sampling is compared with
+// the gaps moisture_track_next_s() picks: samples taken, how late each dry crossing is
+// caught, how far the soil dips below the threshold and how well the estimate follows.
+//   irrigation_sim sampling
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include "sim.h"
+#include "moisture_track.h"
+
+#define DAYS                     30
+#define STEP_S                   60
+#define DRY_PCT                  30
+#define FIELD_PCT                80                // Drains back to this after heavy rain
+#define DAY_RATE                 0.40              // Percentage points lost per hour in daylight
+#define NIGHT_RATE               0.05
+#define WATER_PCT                30                // Gained per watering
+#define WATER_S                  (20 * 60)
+#define PROBE_SIGMA              1.0
+
+typedef struct {
+    int    day;
+    int    hour;
+    double pct;
+} rain_t;
+
+static const rain_t rains[] = {
+    { 6, 15, 20 }, { 13, 3, 12 }, { 19, 21, 35 }, { 26, 10, 8 },
+};
+
+typedef struct {
+    const char *name;
+    uint32_t    fixed_s;       // 0 for adaptive
+} policy_t;
+
+static const policy_t policies[] = {
+    { "fixed 30 min", 30 * 60 },
+    { "fixed 3 h", 3 * 3600 },
+    { "adaptive", 0 },
+};
+
+static uint64_t rng;
+
+// Deterministic normal noise so every policy sees the same probe
+static double probe_noise(void)
+{
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    double u1 = ((rng >> 11) + 1.0) / 9007199254740993.0;
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    double u2 = (rng >> 11) / 9007199254740992.0;
+    return PROBE_SIGMA * sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+static void run_policy(const policy_t *policy)
+{
+    moisture_track_t track;
+    double truth = 55;
+    int64_t next_sample_s = 0, watering_until_s = -1, crossed_s = -1;
+    int samples = 0, waterings = 0, caught = 0;
+    double late_s = 0, worst_dip = 0, err2 = 0;
+    long steps = 0;
+
+    rng = 12345;
+    moisture_track_reset(&track);
+    for (int64_t t = 0; t < (int64_t)DAYS * 86400; t += STEP_S) {
+        int hour = (int)(t / 3600 % 24);
+        int day = (int)(t / 86400);
+
+        // Soil
+        truth -= ((hour >= 7 && hour < 19) ? DAY_RATE : NIGHT_RATE) * STEP_S / 3600;
+        for (size_t r = 0; r < sizeof(rains) / sizeof(rains[0]); r++) {
+            if (rains[r].day == day && rains[r].hour == hour && t % 3600 == 0) {
+                truth += rains[r].pct;
+            }
+        }
+        if (t < watering_until_s) {
+            truth += (double)WATER_PCT * STEP_S / WATER_S;
+        } else if (t == watering_until_s) {
+            moisture_track_disturb(&track);
+        }
+        if (truth > FIELD_PCT) {
+            truth = FIELD_PCT;
+        }
+        if (truth < DRY_PCT && crossed_s < 0 && t >= watering_until_s) {
+            crossed_s = t;
+        }
+        if (DRY_PCT - truth > worst_dip) {
+            worst_dip = DRY_PCT - truth;
+        }
+        if (track.valid) {
+            double e = moisture_track_predict(&track, t * 1000000LL) - truth;
+            err2 += e * e;
+            steps++;
+        }
+
+        // Controller
+        if (t < next_sample_s) {
+            continue;
+        }
+        double reading = truth + probe_noise();
+        samples++;
+        moisture_track_update(&track, (uint8_t)lround(fmin(fmax(reading, 0), 100)), t * 1000000LL);
+        if (t >= watering_until_s && track.pct <= DRY_PCT) {
+            waterings++;
+            watering_until_s = t + WATER_S;
+            if (crossed_s >= 0) {
+                late_s += t - crossed_s;
+                caught++;
+            }
+            crossed_s = -1;
+        }
+        next_sample_s = t + (policy->fixed_s ? policy->fixed_s : moisture_track_next_s(&track, DRY_PCT));
+    }
+
+    printf("%-14s %8d %6d/day %9d %9.0f %9.1f %9.2f\n", policy->name, samples, samples / DAYS, waterings,
+           caught ? late_s / caught / 60 : 0.0, worst_dip, sqrt(err2 / steps));
+}
+
+int sim_sampling(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    printf("%-14s %8s %10s %9s %9s %9s %9s\n", "policy", "samples", "", "waterings", "late_min",
+           "dip_pct", "rms_pct");
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+        run_policy(&policies[p]);
+    }
+    printf("late_min: dry crossing to watering decision, dip_pct: deepest below %d%%, "
+           "rms_pct: estimate against the soil\n", DRY_PCT);
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Pulse-and-soak study. A bucket model per zone: water lands on the surface, soaks in
+// at the soil's infiltration rate and runs off once the surface pond is full.
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "sim.h"
+#include "cycle_soak.h"
+
+#define PUMP_FLOW_ML_PER_S       (2000.0 / 60)     // Same pump as the firmware default
+#define ZONES                    3
+
+typedef struct {
+    const char *name;
+    double infiltration_ml_per_s;
+    double pond_ml;            // Surface storage before water runs off
+    uint32_t run_s;            // Pump time the zone needs
+} soil_t;
+
+typedef struct {
+    double delivered_ml;
+    double absorbed_ml;
+    double runoff_ml;
+} water_t;
+
+static const soil_t soils[ZONES] = {
+    { "clay",  300.0 / 60, 1500, 10 * 60 },
+    { "loam",  900.0 / 60, 2500, 10 * 60 },
+    { "sand", 2500.0 / 60, 1000,  6 * 60 },
+};
+
+// Longest pulse before the pond overflows and the soak that drains it again
+static void soil_limits(const soil_t *soil, uint32_t *pulse_s, uint32_t *soak_s)
+{
+    double excess = PUMP_FLOW_ML_PER_S - soil->infiltration_ml_per_s;
+
+    *pulse_s = (excess > 0) ? (uint32_t)(soil->pond_ml / excess) : 0;
+    *soak_s = (uint32_t)(soil->pond_ml / soil->infiltration_ml_per_s);
+}
+
+// Step every zone second by second until the pulses are done and the ponds have drained
+static void simulate(const soak_pulse_t *pulses, int count, water_t *water, uint32_t *pump_s, uint32_t *wall_s)
+{
+    double pond[ZONES] = { 0 };
+    uint32_t t = 0;
+    int p = 0;
+
+    *pump_s = 0;
+    while (true) {
+        while (p < count && t >= pulses[p].start_s + pulses[p].length_s) {
+            p++;
+        }
+        bool pumping = p < count && t >= pulses[p].start_s;
+        bool wet = false;
+        for (int z = 0; z < ZONES; z++) {
+            if (pumping && pulses[p].zone == z) {
+                pond[z] += PUMP_FLOW_ML_PER_S;
+                water[z].delivered_ml += PUMP_FLOW_ML_PER_S;
+            }
+            double soak = (pond[z] < soils[z].infiltration_ml_per_s) ? pond[z] : soils[z].infiltration_ml_per_s;
+            pond[z] -= soak;
+            water[z].absorbed_ml += soak;
+            if (pond[z] > soils[z].pond_ml) {
+                water[z].runoff_ml += pond[z] - soils[z].pond_ml;
+                pond[z] = soils[z].pond_ml;
+            }
+            wet |= pond[z] > 1e-6;
+        }
+        *pump_s += pumping;
+        t++;
+        if (p >= count && !wet) {
+            break;
+        }
+    }
+    *wall_s = t;
+}
+
+static int count_wakeups(const soak_pulse_t *pulses, int count)
+{
+    int wakeups = 0;
+    uint32_t last = UINT32_MAX;
+
+    // A pulse ending exactly where the next begins is handled in one wakeup
+    for (int p = 0; p < count; p++) {
+        wakeups += pulses[p].start_s != last;
+        last = pulses[p].start_s + pulses[p].length_s;
+        wakeups++;
+    }
+    return wakeups;
+}
+
+static void report(const char *mode, const soak_pulse_t *pulses, int count)
+{
+    water_t water[ZONES] = { 0 };
+    water_t total = { 0 };
+    uint32_t pump_s, wall_s;
+
+    simulate(pulses, count, water, &pump_s, &wall_s);
+    printf("%s: %d pulses, %d wakeups, pump on %.1f min, finished after %.1f min\n",
+           mode, count, count_wakeups(pulses, count), pump_s / 60.0, wall_s / 60.0);
+    printf("  %-6s %10s %10s %10s %9s\n", "zone", "delivered", "absorbed", "runoff", "absorbed");
+    for (int z = 0; z < ZONES; z++) {
+        printf("  %-6s %8.1f L %8.1f L %8.1f L %8.1f%%\n", soils[z].name, water[z].delivered_ml / 1000,
+               water[z].absorbed_ml / 1000, water[z].runoff_ml / 1000,
+               100 * water[z].absorbed_ml / water[z].delivered_ml);
+        total.delivered_ml += water[z].delivered_ml;
+        total.absorbed_ml += water[z].absorbed_ml;
+        total.runoff_ml += water[z].runoff_ml;
+    }
+    printf("  %-6s %8.1f L %8.1f L %8.1f L %8.1f%%\n", "total", total.delivered_ml / 1000,
+           total.absorbed_ml / 1000, total.runoff_ml / 1000, 100 * total.absorbed_ml / total.delivered_ml);
+    printf("  pump time per absorbed litre: %.2f min\n\n", pump_s / 60.0 / (total.absorbed_ml / 1000));
+}
+
+int sim_soak(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    soak_zone_t zones[ZONES];
+    soak_pulse_t pulses[SOAK_MAX_PULSES];
+    int n;
+
+    // Continuous: one block per zone, back to back
+    for (int z = 0; z < ZONES; z++) {
+        zones[z] = (soak_zone_t){ .run_s = soils[z].run_s };
+    }
+    n = cycle_soak_plan(zones, ZONES, pulses, SOAK_MAX_PULSES);
+    report("continuous", pulses, n);
+
+    for (int z = 0; z < ZONES; z++) {
+        soil_limits(&soils[z], &zones[z].pulse_s, &zones[z].soak_s);
+        printf("%s: pulse %u s, soak %u s\n", soils[z].name, zones[z].pulse_s, zones[z].soak_s);
+    }
+    n = cycle_soak_plan(zones, ZONES, pulses, SOAK_MAX_PULSES);
+    if (n < 0) {
+        fprintf(stderr, "pulse plan does not fit in %d pulses\n", SOAK_MAX_PULSES);
+        return 1;
+    }
+    report("pulse-and-soak", pulses, n);
+    return 0;
+}
@@ -0,0 +1,142 @@
+// Tank reserve study. Drains the tank through one long pump run and compares how the
+// firmware notices it reaching the reserve: polling the level every TANK_CHECK_S, or the
+// ADC threshold monitor, which only converts while the CPU is awake. Each is run with
+// the CPU sleeping through the pulse between flow checks and with it staying awake.
+//   irrigation_sim tank
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "sim.h"
+#include "hal_host.h"
+
+// Mirrors main.c and sensors.h
+#define TANK_RESERVE_ML          10000
+#define TANK_CHECK_S             15
+#define PUMP_SLEEP_CHECK_S       30
+#define FLOW_SAMPLE_MS           1000
+#define TANK_EMPTY_RAW           300
+#define TANK_FULL_RAW            3500
+#define TANK_CAPACITY_ML         200000
+
+#define TANK_CHANNEL             6
+#define TANK_START_ML            40000
+#define DRAW_ML_PER_MIN          2000
+#define RUN_S                    (20 * 60)          // Longer than it takes to reach the reserve
+#define CONVERT_US               2000              // Monitor conversion period while awake
+
+typedef struct {
+    const char *name;
+    bool        monitor;       // Chip has the ADC threshold monitor
+    bool        sleep;         // Light sleep between flow checks
+} tank_mode_t;
+
+static const tank_mode_t modes[] = {
+    { "poll, asleep", false, true },
+    { "monitor, asleep", true, true },
+    { "poll, awake", false, false },
+    { "monitor, awake", true, false },
+};
+
+static int64_t start_us;
+static int64_t detected_us;
+
+static uint32_t tank_ml_at(int64_t now_us)
+{
+    int64_t drawn = (now_us - start_us) * DRAW_ML_PER_MIN / (60 * 1000000LL);
+
+    return (drawn >= TANK_START_ML) ? 0 : (uint32_t)(TANK_START_ML - drawn);
+}
+
+static int ml_to_raw(uint32_t ml)
+{
+    return TANK_EMPTY_RAW + (int)((int64_t)ml * (TANK_FULL_RAW - TANK_EMPTY_RAW) / TANK_CAPACITY_ML);
+}
+
+static bool on_tank_low(bool high, void *arg)
+{
+    (void)high;
+    (void)arg;
+    if (detected_us < 0) {
+        detected_us = hal_time_us();
+    }
+    return false;
+}
+
+// Awake, the monitor sees every conversion. Asleep it stops, and the level it finds on
+// wakeup is the first one it compares.
+static void wait_until(int64_t at_us, bool sleep)
+{
+    if (sleep) {
+        hal_sleep_light_until(at_us);
+        hal_host_set_adc(TANK_CHANNEL, ml_to_raw(tank_ml_at(hal_time_us())));
+        return;
+    }
+    while (hal_time_us() < at_us && detected_us < 0) {
+        hal_host_advance_us(CONVERT_US);
+        hal_host_set_adc(TANK_CHANNEL, ml_to_raw(tank_ml_at(hal_time_us())));
+    }
+}
+
+static bool run_mode(const tank_mode_t *mode)
+{
+    int64_t flow_period_us = mode->sleep ? PUMP_SLEEP_CHECK_S * 1000000LL : FLOW_SAMPLE_MS * 1000LL;
+    int64_t reserve_us, flow_at_us, tank_at_us;
+    int wakeups = 0, reads = 0;
+
+    hal_host_reset(HAL_RESET_POWER_ON);
+    hal_host_set_adc_monitor(mode->monitor);
+    start_us = hal_time_us();
+    reserve_us = start_us + (int64_t)(TANK_START_ML - TANK_RESERVE_ML) * 60 * 1000000 / DRAW_ML_PER_MIN;
+    detected_us = -1;
+    hal_host_set_adc(TANK_CHANNEL, ml_to_raw(TANK_START_ML));
+
+    bool polled = hal_adc_monitor_start(TANK_CHANNEL, ml_to_raw(TANK_RESERVE_ML), -1, on_tank_low, NULL) != HAL_OK;
+    flow_at_us = start_us + flow_period_us;
+    tank_at_us = polled ? start_us + TANK_CHECK_S * 1000000LL : HAL_NEVER;
+    while (detected_us < 0 && hal_time_us() < start_us + RUN_S * 1000000LL) {
+        int64_t wake_us = (flow_at_us < tank_at_us) ? flow_at_us : tank_at_us;
+
+        wait_until(wake_us, mode->sleep);
+        if (detected_us >= 0) {
+            break;
+        }
+        wakeups += mode->sleep;
+        if (hal_time_us() >= tank_at_us) {
+            int raw;
+            reads++;
+            hal_adc_read(TANK_CHANNEL, &raw);
+            if (raw < ml_to_raw(TANK_RESERVE_ML)) {
+                detected_us = hal_time_us();
+            }
+            tank_at_us += TANK_CHECK_S * 1000000LL;
+        }
+        if (hal_time_us() >= flow_at_us) {
+            flow_at_us += flow_period_us;
+        }
+    }
+    hal_adc_monitor_stop();
+
+    if (detected_us < 0) {
+        printf("%-16s %8d %8d %10s\n", mode->name, wakeups, reads, "missed");
+        return false;
+    }
+    int64_t late_us = detected_us - reserve_us;
+    uint32_t overdrawn = (uint32_t)(late_us * DRAW_ML_PER_MIN / (60 * 1000000LL));
+    printf("%-16s %8d %8d %10.1f %10" PRIu32 "\n", mode->name, wakeups, reads, late_us / 1e6, overdrawn);
+    return true;
+}
+
+int sim_tank(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    int failed = 0;
+
+    printf("%-16s %8s %8s %10s %10s\n", "mode", "wakeups", "reads", "late_s", "overdrawn");
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        failed |= !run_mode(&modes[m]);
+    }
+    printf("wakeups: light sleep exits before the reserve, reads: CPU tank conversions\n");
+    return failed;
+}
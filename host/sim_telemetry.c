@@ -0,0 +1,248 @@
+// Telemetry study. A week of sensor epochs every 10 minutes on a two-zone node: soil
+// drying and watering, a tank draining and refilling, air temperature and a solar
+// charged battery, all with probe noise. Periodic reporting is compared with the
+// send-on-delta policy: frames, bytes and radio-on time per day, and how far the
+// receiver's reconstruction, holding the last value of each metric, strays from the
+// readings. Then the frames of a gateway outage are sent the way the node catches up,
+// LZ compressed in batches, and checked through the decoder.
+//   irrigation_sim telemetry
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "telemetry.h"
+
+#define DAYS                     7
+#define EPOCH_S                  (10 * 60)
+#define ZONES                    2
+#define METRICS                  (TELEMETRY_MOISTURE_PCT + ZONES)
+#define RADIO_CONNECT_MS         3000              // Cold Wi-Fi association and DHCP per frame
+#define RADIO_KBPS               1000              // Effective uplink rate once associated
+#define OUTAGE_AT_S              (3 * 86400)       // Gateway down from here...
+#define OUTAGE_FRAMES            48                // ...for as many frames as the node's flash store keeps
+#define DATAGRAM_BYTES           1400              // LINK_MAX_DATAGRAM
+
+// As in main.c
+static const telemetry_policy_t policy[METRICS] = {
+    [TELEMETRY_TANK_DL] = { .deadband = 50, .max_silence_s = 6 * 3600 },
+    [TELEMETRY_TEMP_DC] = { .deadband = 10, .max_silence_s = 6 * 3600 },
+    [TELEMETRY_BATTERY_PCT] = { .deadband = 3, .max_silence_s = 6 * 3600 },
+    [TELEMETRY_FLOW_ALARM] = { .deadband = 0, .max_silence_s = 6 * 3600 },
+    [TELEMETRY_MOISTURE_PCT] = { .deadband = 3, .max_silence_s = 6 * 3600 },
+    [TELEMETRY_MOISTURE_PCT + 1] = { .deadband = 3, .max_silence_s = 6 * 3600 },
+};
+
+static const char *const metric_name[METRICS] = { "tank_dl", "temp_dc", "battery", "alarm", "moist0", "moist1" };
+
+typedef struct {
+    const char *name;
+    uint32_t    period_s;      // 0 for send-on-delta
+} report_mode_t;
+
+typedef struct {
+    uint8_t bytes[OUTAGE_FRAMES * TELEMETRY_MAX_BYTES];
+    size_t  len;
+    int     frames;
+} backlog_t;
+
+static backlog_t backlog[3];
+
+static const report_mode_t modes[] = {
+    { "every 10 min", EPOCH_S },
+    { "hourly", 3600 },
+    { "send-on-delta", 0 },
+};
+
+static uint64_t rng;
+
+static double noise(double sigma)
+{
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    double u1 = ((rng >> 11) + 1.0) / 9007199254740993.0;
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    double u2 = (rng >> 11) / 9007199254740992.0;
+    return sigma * sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+// The node's readings for the epoch at t, same sequence for every mode
+static void read_epoch(int64_t t, int32_t *value)
+{
+    static double moisture[ZONES], tank_l, battery;
+    double hour = (t % 86400) / 3600.0;
+    bool day = hour >= 7 && hour < 19;
+
+    if (t == 0) {
+        moisture[0] = 45;
+        moisture[1] = 38;
+        tank_l = 800;
+        battery = 70;
+    }
+    for (int z = 0; z < ZONES; z++) {
+        moisture[z] -= (day ? 0.4 : 0.05) * EPOCH_S / 3600;
+        if (moisture[z] < 30) {
+            moisture[z] += 25;             // The zone's cycle, 60 l out of the tank
+            tank_l -= 60;
+        }
+        value[TELEMETRY_MOISTURE_PCT + z] = (int32_t)lround(moisture[z] + noise(1.0));
+    }
+    if (tank_l < 300) {
+        tank_l = 1000;                     // Refilled
+    }
+    battery += (day ? 0.6 : -0.3) * EPOCH_S / 3600;
+    battery = fmin(fmax(battery, 0), 100);
+    value[TELEMETRY_TANK_DL] = (int32_t)lround(tank_l * 10 + noise(20));
+    value[TELEMETRY_TEMP_DC] = (int32_t)lround(150 + 80 * sin((hour - 9) * M_PI / 12) + noise(2));
+    value[TELEMETRY_BATTERY_PCT] = (int32_t)lround(battery + noise(0.5));
+    value[TELEMETRY_FLOW_ALARM] = 0;
+}
+
+static void run_mode(const report_mode_t *mode, backlog_t *outage)
+{
+    telemetry_metric_t sender[METRICS] = { 0 };
+    int32_t held[METRICS] = { 0 }, value[METRICS];
+    bool seen[METRICS] = { 0 };
+    int64_t heard_at_s[METRICS] = { 0 };
+    double worst[METRICS] = { 0 };
+    int64_t longest_s = 0;
+    long frames = 0, bytes = 0;
+    double radio_ms = 0;
+
+    rng = 4242;
+    for (int64_t t = 0; t < (int64_t)DAYS * 86400; t += EPOCH_S) {
+        int64_t at_us = t * 1000000;
+        telemetry_record_t records[METRICS], got[TELEMETRY_MAX_RECORDS];
+        int n = 0;
+
+        read_epoch(t, value);
+        if (mode->period_s) {
+            if (t % mode->period_s == 0) {
+                for (int m = 0; m < METRICS; m++) {
+                    records[n++] = (telemetry_record_t){ (uint32_t)t, (int16_t)value[m], (uint8_t)m };
+                }
+            }
+        } else {
+            telemetry_verdict_t verdict[METRICS];
+            bool send = false;
+            for (int m = 0; m < METRICS; m++) {
+                verdict[m] = telemetry_check(&sender[m], &policy[m], value[m], at_us);
+                send |= verdict[m] == TELEMETRY_SEND;
+            }
+            for (int m = 0; send && m < METRICS; m++) {
+                if (verdict[m] != TELEMETRY_QUIET) {
+                    records[n++] = (telemetry_record_t){ (uint32_t)t, (int16_t)value[m], (uint8_t)m };
+                    telemetry_mark_sent(&sender[m], value[m], at_us);
+                }
+            }
+        }
+
+        // Over the air and into the receiver
+        if (n > 0) {
+            uint8_t frame[TELEMETRY_MAX_BYTES];
+            uint32_t sent_s;
+            size_t len = telemetry_encode(records, n, (uint32_t)t, frame, sizeof(frame));
+            int count = telemetry_decode(frame, len, got, &sent_s);
+            if (count != n) {
+                printf("%s: frame lost in encoding\n", mode->name);
+                exit(1);
+            }
+            if (t >= OUTAGE_AT_S && outage->frames < OUTAGE_FRAMES) {
+                memcpy(outage->bytes + outage->len, frame, len);
+                outage->len += len;
+                outage->frames++;
+            }
+            for (int i = 0; i < count; i++) {
+                held[got[i].metric] = got[i].value;
+                seen[got[i].metric] = true;
+                heard_at_s[got[i].metric] = t - (sent_s - got[i].at_s);
+            }
+            frames++;
+            bytes += len;
+            radio_ms += RADIO_CONNECT_MS + len * 8.0 / RADIO_KBPS;
+        }
+        for (int m = 0; m < METRICS; m++) {
+            double err = seen[m] ? fabs((double)held[m] - value[m]) / policy[m].deadband : INFINITY;
+            worst[m] = fmax(worst[m], err);
+            if (t - heard_at_s[m] > longest_s) {
+                longest_s = t - heard_at_s[m];
+            }
+        }
+    }
+
+    double worst_all = 0;
+    int worst_m = 0;
+    for (int m = 0; m < METRICS; m++) {
+        if (worst[m] > worst_all) {
+            worst_all = worst[m];
+            worst_m = m;
+        }
+    }
+    printf("%-14s %8.1f %10.0f %12.0f %8.2f %-8s %8.1f\n", mode->name, (double)frames / DAYS, (double)bytes / DAYS,
+           radio_ms / DAYS, worst_all, metric_name[worst_m], longest_s / 3600.0);
+}
+
+// Stored frames go out in as few datagrams as the compressed batches allow, and the
+// gateway has to get every byte back
+static bool catch_up(const report_mode_t *mode, const backlog_t *outage)
+{
+    static telemetry_batch_t batch;
+    static uint8_t datagram[DATAGRAM_BYTES];
+    static uint8_t unpacked[TELEMETRY_BATCH_MAX_RAW];
+    size_t at = 0, batched = 0, verified = 0;
+    int datagrams = 0;
+    clock_t cpu = 0;
+
+    while (at < outage->len) {
+        clock_t t0 = clock();
+        telemetry_batch_start(&batch, datagram, sizeof(datagram));
+        size_t first = at, len;
+        while (at < outage->len && (len = telemetry_frame_len(outage->bytes + at, outage->len - at)) > 0
+               && telemetry_batch_add(&batch, outage->bytes + at, len)) {
+            at += len;
+        }
+        size_t size = telemetry_batch_finish(&batch, OUTAGE_AT_S);
+        cpu += clock() - t0;
+
+        uint32_t sent_s;
+        int raw = telemetry_batch_decode(datagram, size, unpacked, sizeof(unpacked), &sent_s);
+        if (raw != (int)(at - first) || memcmp(unpacked, outage->bytes + first, raw) != 0) {
+            printf("%s: batch %d does not decode to its frames\n", mode->name, datagrams);
+            return false;
+        }
+        verified += raw;
+        batched += size;
+        datagrams++;
+    }
+    printf("%-14s %8d %8zu %10zu %9d %8.2f %10.2f %8.0f\n", mode->name, outage->frames, outage->len, batched, datagrams,
+           (double)outage->len / batched, ((double)outage->len - batched) * 8 / RADIO_KBPS,
+           (double)cpu / CLOCKS_PER_SEC * 1e9 / verified);
+    return true;
+}
+
+int sim_telemetry(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    printf("%-14s %8s %10s %12s %8s %-8s %8s\n", "mode", "frames/d", "bytes/d", "radio_ms/d", "err_db", "worst",
+           "silent_h");
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        run_mode(&modes[i], &backlog[i]);
+    }
+    printf("err_db: largest gap between the receiver's value and the reading, in deadbands (1.00 is the bound)\n"
+           "silent_h: longest a metric went unreported, radio: %d ms connect per frame + %d kbit/s\n\n",
+           RADIO_CONNECT_MS, RADIO_KBPS);
+
+    printf("%-14s %8s %8s %10s %9s %8s %10s %8s\n", "outage of", "frames", "raw_B", "batched_B", "datagrams", "ratio",
+           "saved_ms", "ns/B");
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (!catch_up(&modes[i], &backlog[i])) {
+            return 1;
+        }
+    }
+    printf("batches of up to %d bytes, ns/B: encoding on this host, saved_ms: airtime at %d kbit/s\n",
+           DATAGRAM_BYTES, RADIO_KBPS);
+    return 0;
+}
@@ -0,0 +1,302 @@
+// Receive telemetry frames from nodes and print their records as CSV.
+//   telemetry_gateway [-k key] [port]  UDP, acknowledging each frame with its CRC-32 (default 4210)
+//   telemetry_gateway -                "telemetry <hex>" lines from a node's console on stdin,
+//                                      e.g. telemetry_gateway - < /dev/ttyUSB0
+// Output columns: node (sender address, its node number when sealed, or "console"), Unix
+// time, metric, value. A record's time is the receive time minus its age on the node's
+// clock at sending. Frames a node stored while the gateway was down arrive later as LZ
+// batches, which are unpacked here.
+//
+// With -k and the nodes' 32 hex digit key, only sealed datagrams are accepted. Each must
+// carry a counter above the last one from its node, a retry of the last one is acked
+// again without printing it twice. The acknowledgement is the datagram's counter, sealed
+// under a counter of the gateway's own that starts from the microsecond clock, so it
+// keeps going up across restarts without being stored. The per-node counters are not
+// stored either: after a restart the first datagram from each node is taken as new.
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include "telemetry.h"
+
+#define DEFAULT_PORT             4210
+#define LINE_MAX_CHARS           (2 * TELEMETRY_MAX_BYTES + 64)
+#define MAX_NODES                64
+
+// Replay state of a node that sent sealed datagrams
+typedef struct {
+    uint32_t node;
+    uint64_t received;         // Newest counter accepted from the node
+    uint64_t acked;            // Newest counter the gateway sealed an ack with
+    bool     seen;
+} peer_t;
+
+static aes_ccm_t key;
+static bool sealed;
+static peer_t peers[MAX_NODES];
+static int peer_count;
+
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+
+    while (len--) {
+        crc ^= *data++;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static const char *metric_name(uint8_t metric, char *buf, size_t size)
+{
+    switch (metric) {
+    case TELEMETRY_TANK_DL:
+        return "tank_dl";
+    case TELEMETRY_TEMP_DC:
+        return "temp_dc";
+    case TELEMETRY_BATTERY_PCT:
+        return "battery_pct";
+    case TELEMETRY_FLOW_ALARM:
+        return "flow_alarm";
+    default:
+        snprintf(buf, size, "moisture%d_pct", metric - TELEMETRY_MOISTURE_PCT);
+        return buf;
+    }
+}
+
+// sent_s is the batch's for stored frames, 0 to take the frame's own
+static bool print_frame(const char *node, const uint8_t *frame, size_t len, uint32_t batch_sent_s)
+{
+    telemetry_record_t records[TELEMETRY_MAX_RECORDS];
+    uint32_t sent_s;
+    char name[32];
+    int count = telemetry_decode(frame, len, records, &sent_s);
+    time_t now = time(NULL);
+
+    if (count < 0) {
+        fprintf(stderr, "%s: bad frame, %zu bytes\n", node, len);
+        return false;
+    }
+    if (batch_sent_s) {
+        sent_s = batch_sent_s;
+    }
+    for (int i = 0; i < count; i++) {
+        printf("%s,%lld,%s,%d\n", node, (long long)(now - (time_t)(sent_s - records[i].at_s)),
+               metric_name(records[i].metric, name, sizeof(name)), records[i].value);
+    }
+    fflush(stdout);
+    return true;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static int read_console(void)
+{
+    char line[LINE_MAX_CHARS];
+    uint8_t frame[TELEMETRY_MAX_BYTES];
+    size_t prefix = strlen(TELEMETRY_CONSOLE_PREFIX);
+
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        // Log lines and anything else on the console pass by
+        char *hex = strstr(line, TELEMETRY_CONSOLE_PREFIX);
+        if (hex == NULL) {
+            continue;
+        }
+        hex += prefix;
+        hex[strcspn(hex, "\r\n")] = '\0';
+        size_t len = strlen(hex) / 2;
+        bool ok = (strlen(hex) % 2 == 0 && len <= sizeof(frame));
+        for (size_t i = 0; ok && i < len; i++) {
+            int hi = hex_value(hex[2 * i]), lo = hex_value(hex[2 * i + 1]);
+            ok = (hi >= 0 && lo >= 0);
+            frame[i] = (uint8_t)(hi << 4 | lo);
+        }
+        if (!ok) {
+            fprintf(stderr, "console: not a frame: %s\n", hex);
+            continue;
+        }
+        print_frame("console", frame, len, 0);
+    }
+    return 0;
+}
+
+static peer_t *find_peer(uint32_t node)
+{
+    for (int i = 0; i < peer_count; i++) {
+        if (peers[i].node == node) {
+            return &peers[i];
+        }
+    }
+    if (peer_count == MAX_NODES) {
+        return NULL;
+    }
+    peers[peer_count] = (peer_t){ .node = node };
+    return &peers[peer_count++];
+}
+
+static bool print_batch(const char *node, const uint8_t *batch, size_t len)
+{
+    static uint8_t frames[TELEMETRY_BATCH_MAX_RAW];
+    uint32_t sent_s;
+    int total = telemetry_batch_decode(batch, len, frames, sizeof(frames), &sent_s);
+    size_t frame_len;
+
+    if (total < 0) {
+        fprintf(stderr, "%s: bad batch, %zu bytes\n", node, len);
+        return false;
+    }
+    for (size_t at = 0; at < (size_t)total; at += frame_len) {
+        frame_len = telemetry_frame_len(frames + at, total - at);
+        if (frame_len == 0 || !print_frame(node, frames + at, frame_len, sent_s)) {
+            fprintf(stderr, "%s: batch cut short after %zu of %d bytes\n", node, at, total);
+            return false;
+        }
+    }
+    fprintf(stderr, "%s: %d bytes of stored frames from a %zu byte batch\n", node, total, len);
+    return true;
+}
+
+static bool print_datagram(const char *node, const uint8_t *datagram, size_t len)
+{
+    bool batch = (len >= 4 && (datagram[0] | datagram[1] << 8 | datagram[2] << 16 | (uint32_t)datagram[3] << 24)
+                              == TELEMETRY_BATCH_MAGIC);
+
+    return batch ? print_batch(node, datagram, len) : print_frame(node, datagram, len, 0);
+}
+
+// Check, print and acknowledge a sealed datagram. Returns the ack length, 0 for none.
+static size_t open_sealed(const char *from, const uint8_t *datagram, size_t len, uint8_t *ack, size_t size)
+{
+    static uint8_t plain[65536];
+    uint32_t node;
+    uint64_t counter;
+    char name[16];
+    int plain_len = telemetry_open(&key, TELEMETRY_FROM_NODE, datagram, len, plain, sizeof(plain), &node, &counter);
+    struct timespec now;
+
+    if (plain_len < 0) {
+        fprintf(stderr, "%s: not sealed with this key, %zu bytes\n", from, len);
+        return 0;
+    }
+    peer_t *peer = find_peer(node);
+    if (peer == NULL) {
+        fprintf(stderr, "%s: more than %d nodes\n", from, MAX_NODES);
+        return 0;
+    }
+    snprintf(name, sizeof(name), "%08x", (unsigned)node);
+    // Equal to the last one is a retry whose ack got lost, anything older a replay
+    if (peer->seen && counter < peer->received) {
+        fprintf(stderr, "%s: replayed counter %llu\n", name, (unsigned long long)counter);
+        return 0;
+    }
+    if (!peer->seen || counter > peer->received) {
+        if (!print_datagram(name, plain, (size_t)plain_len)) {
+            return 0;
+        }
+        peer->received = counter;
+        peer->seen = true;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t ack_counter = (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+    peer->acked = (ack_counter > peer->acked) ? ack_counter : peer->acked + 1;
+    // Little-endian on the wire, as the node compares it
+    uint8_t acked[TELEMETRY_ACK_BYTES];
+    for (int i = 0; i < TELEMETRY_ACK_BYTES; i++) {
+        acked[i] = (uint8_t)(counter >> (8 * i));
+    }
+    return telemetry_seal(&key, node, peer->acked, TELEMETRY_FROM_GATEWAY, acked, sizeof(acked), ack, size);
+}
+
+static int listen_udp(int port)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+    static uint8_t frame[65536];
+    uint8_t ack[TELEMETRY_SEAL_OVERHEAD + TELEMETRY_ACK_BYTES];
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (s < 0 || bind(s, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("telemetry_gateway");
+        return 1;
+    }
+    fprintf(stderr, "listening on UDP port %d\n", port);
+    for (;;) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        char node[INET_ADDRSTRLEN];
+        ssize_t len = recvfrom(s, frame, sizeof(frame), 0, (struct sockaddr *)&from, &from_len);
+        if (len <= 0) {
+            continue;
+        }
+        inet_ntop(AF_INET, &from.sin_addr, node, sizeof(node));
+        size_t ack_len = 0;
+        if (sealed) {
+            ack_len = open_sealed(node, frame, (size_t)len, ack, sizeof(ack));
+        } else if (print_datagram(node, frame, (size_t)len)) {
+            // Little-endian on the wire, as the node compares it
+            uint32_t crc = crc32(frame, (size_t)len);
+            ack[0] = crc;
+            ack[1] = crc >> 8;
+            ack[2] = crc >> 16;
+            ack[3] = crc >> 24;
+            ack_len = 4;
+        }
+        if (ack_len > 0) {
+            sendto(s, ack, ack_len, 0, (struct sockaddr *)&from, from_len);
+        }
+    }
+}
+
+static bool parse_key(const char *hex)
+{
+    uint8_t bytes[AES_CCM_KEY_BYTES];
+
+    if (strlen(hex) != 2 * AES_CCM_KEY_BYTES) {
+        return false;
+    }
+    for (int i = 0; i < AES_CCM_KEY_BYTES; i++) {
+        int hi = hex_value(hex[2 * i]), lo = hex_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        bytes[i] = (uint8_t)(hi << 4 | lo);
+    }
+    aes_ccm_init(&key, bytes);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "-") == 0) {
+        return read_console();
+    }
+    if (argc > 2 && strcmp(argv[1], "-k") == 0) {
+        if (!parse_key(argv[2])) {
+            fprintf(stderr, "telemetry_gateway: key must be 32 hex digits\n");
+            return 2;
+        }
+        sealed = true;
+        argc -= 2;
+        argv += 2;
+    }
+    return listen_udp(argc > 1 ? atoi(argv[1]) : DEFAULT_PORT);
+}
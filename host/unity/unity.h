@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// Host stand-in for the part of ESP-IDF's Unity the cases in test_apps/ use, so the
+// same files run on the PC under ctest. TEST_CASE registers the case before main like
+// the IDF runner does, and a failed assertion ends the case and moves on to the next.
+
+typedef void (*unity_case_fn)(void);
+
+void unity_host_register(const char *name, const char *tags, unity_case_fn fn, const char *file, int line);
+__attribute__((noreturn)) void unity_host_fail(const char *file, int line, const char *what);
+
+#define UNITY_JOIN_(a, b)        a##b
+#define UNITY_JOIN(a, b)         UNITY_JOIN_(a, b)
+
+#define TEST_CASE(name, tags)                                                                  \
+    static void UNITY_JOIN(unity_case_, __LINE__)(void);                                       \
+    __attribute__((constructor)) static void UNITY_JOIN(unity_register_, __LINE__)(void)        \
+    {                                                                                          \
+        unity_host_register(name, tags, UNITY_JOIN(unity_case_, __LINE__), __FILE__, __LINE__); \
+    }                                                                                          \
+    static void UNITY_JOIN(unity_case_, __LINE__)(void)
+
+#define UNITY_CHECK(cond, what)                                                                \
+    do {                                                                                       \
+        if (!(cond)) {                                                                         \
+            unity_host_fail(__FILE__, __LINE__, what);                                         \
+        }                                                                                      \
+    } while (0)
+
+#define TEST_ASSERT(cond)                          UNITY_CHECK(cond, #cond)
+#define TEST_ASSERT_TRUE(cond)                     UNITY_CHECK(cond, #cond " is false")
+#define TEST_ASSERT_FALSE(cond)                    UNITY_CHECK(!(cond), #cond " is true")
+#define TEST_ASSERT_NULL(p)                        UNITY_CHECK((p) == NULL, #p " is not NULL")
+#define TEST_ASSERT_NOT_NULL(p)                    UNITY_CHECK((p) != NULL, #p " is NULL")
+#define TEST_ASSERT_EQUAL(expected, actual)        TEST_ASSERT_EQUAL_INT64(expected, actual)
+#define TEST_ASSERT_EQUAL_INT(expected, actual)    TEST_ASSERT_EQUAL_INT64(expected, actual)
+#define TEST_ASSERT_EQUAL_UINT32(expected, actual) TEST_ASSERT_EQUAL_INT64(expected, actual)
+#define TEST_ASSERT_EQUAL_INT64(expected, actual)                                              \
+    UNITY_CHECK((int64_t)(expected) == (int64_t)(actual), #actual " is not " #expected)
+#define TEST_ASSERT_EQUAL_UINT64(expected, actual)                                             \
+    UNITY_CHECK((uint64_t)(expected) == (uint64_t)(actual), #actual " is not " #expected)
+#define TEST_ASSERT_LESS_OR_EQUAL(limit, actual)   TEST_ASSERT_LESS_OR_EQUAL_INT64(limit, actual)
+#define TEST_ASSERT_GREATER_OR_EQUAL(limit, actual) TEST_ASSERT_GREATER_OR_EQUAL_INT64(limit, actual)
+#define TEST_ASSERT_LESS_OR_EQUAL_INT64(limit, actual)                                         \
+    UNITY_CHECK((int64_t)(actual) <= (int64_t)(limit), #actual " is over " #limit)
+#define TEST_ASSERT_GREATER_OR_EQUAL_INT64(limit, actual)                                      \
+    UNITY_CHECK((int64_t)(actual) >= (int64_t)(limit), #actual " is under " #limit)
+#define TEST_ASSERT_EQUAL_MEMORY(expected, actual, len)                                        \
+    UNITY_CHECK(memcmp(expected, actual, len) == 0, #actual " differs from " #expected)
@@ -0,0 +1,69 @@
+// Runs the cases registered through the host unity.h, all of them or those whose tags
+// contain the filter, e.g. "[planner]", and prints one line per case the way the IDF
+// runner does. Exits non-zero if any case failed, for ctest.
+//   unit_tests [filter]
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+
+#define MAX_CASES                128
+
+typedef struct {
+    const char   *name;
+    const char   *tags;
+    unity_case_fn fn;
+    const char   *file;
+    int           line;
+} unity_case_t;
+
+static unity_case_t cases[MAX_CASES];
+static int case_count;
+static jmp_buf abort_case;
+
+void unity_host_register(const char *name, const char *tags, unity_case_fn fn, const char *file, int line)
+{
+    if (case_count == MAX_CASES) {
+        fprintf(stderr, "More than %d cases, raise MAX_CASES\n", MAX_CASES);
+        return;
+    }
+    cases[case_count++] = (unity_case_t){ name, tags, fn, file, line };
+}
+
+void unity_host_fail(const char *file, int line, const char *what)
+{
+    printf("%s:%d: %s\n", file, line, what);
+    longjmp(abort_case, 1);
+}
+
+// Kept apart from the loop so longjmp leaves none of its counters in doubt
+static bool run_case(const unity_case_t *c)
+{
+    if (setjmp(abort_case) != 0) {
+        printf("%s:%d:%s:FAIL\n", c->file, c->line, c->name);
+        return false;
+    }
+    c->fn();
+    printf("%s:%d:%s:PASS\n", c->file, c->line, c->name);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = (argc >= 2) ? argv[1] : NULL;
+    int run = 0, failed = 0;
+
+    for (int i = 0; i < case_count; i++) {
+        const unity_case_t *c = &cases[i];
+        if (filter && !strstr(c->tags, filter) && strcmp(c->name, filter) != 0) {
+            continue;
+        }
+        run++;
+        if (!run_case(c)) {
+            failed++;
+        }
+    }
+    printf("\n-----------------------\n%d Tests %d Failures 0 Ignored\n%s\n", run, failed, failed ? "FAIL" : "OK");
+    return (run == 0 || failed) ? 1 : 0;
+}
@@ -0,0 +1,301 @@
+#include "benchmarks.h"
+
+#include <stdlib.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "mbedtls/ccm.h"
+#include "board_config.h"
+#include "board_hal.h"
+#include "sensors.h"
+#include "telemetry.h"
+#include "telemetry_crypto.h"
+#include "telemetry_link.h"
+#include "water_budget.h"
+
+#define TAG "BENCHMARK"
+#define BENCH_RUNS               20
+#define BENCH_OUTPUT_PIN         LIGHT_PIN         // Built-in LED, harmless to toggle
+#define BENCH_OUTPUT_TOGGLES     10000
+#define BENCH_ADC_READS          1000
+#define BENCH_STORAGE_BYTES      64
+#define BENCH_TIMER_LEAD_US      2000              // Deadline distance for the timer latency runs
+#define BENCH_SLEEP_US           20000             // Light sleep length for the wakeup latency runs
+#define BENCH_LINK_UPLOADS       10
+#define BENCH_LINK_RECORDS       6                 // A typical send-on-delta frame
+#define BENCH_RADIO_MA           120               // Assumed supply current with the radio on, for the energy estimate
+#define BENCH_SUPPLY_MV          3300
+#define BENCH_LZ_FRAMES          48                // A full telemetry store
+#define BENCH_LINK_KBPS          1000              // Assumed effective uplink rate, for the airtime saved
+#define BENCH_CPU_MA             40                // Assumed supply current with the radio off and the CPU busy
+#define BENCH_SEAL_RUNS          50
+
+#if CONFIG_MBEDTLS_HARDWARE_AES
+#define BENCH_AES                "hardware"
+#else
+#define BENCH_AES                "software"
+#endif
+
+static budget_workspace_t budget_ws;
+static budget_zone_t budget_zones[BUDGET_MAX_ZONES];
+static uint32_t budget_alloc[BUDGET_MAX_ZONES];
+static SemaphoreHandle_t timer_fired;
+static volatile int64_t timer_fired_us;
+
+static void bench_water_budget(void)
+{
+    srand(1);
+    for (int n = 1; n <= BUDGET_MAX_ZONES; n *= 2) {
+        int64_t worst_us = 0;
+        int64_t total_us = 0;
+
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            uint32_t total_demand = 0;
+            for (int z = 0; z < n; z++) {
+                budget_zones[z].demand_ml = 1000 + rand() % 20000;
+                budget_zones[z].min_ml = rand() % 2000;
+                budget_zones[z].priority = rand() % 10;
+                total_demand += budget_zones[z].demand_ml;
+            }
+            // Only half the demand fits, so the DP path always runs
+            int64_t t0 = esp_timer_get_time();
+            water_budget_solve(budget_zones, n, total_demand / 2, budget_alloc, &budget_ws);
+            int64_t dt = esp_timer_get_time() - t0;
+            total_us += dt;
+            if (dt > worst_us) {
+                worst_us = dt;
+            }
+        }
+        ESP_LOGI(TAG, "water_budget_solve %2d zones: avg %lld us, worst %lld us",
+                 n, total_us / BENCH_RUNS, worst_us);
+    }
+}
+
+static void on_bench_timer(void *arg)
+{
+    timer_fired_us = hal_time_us();
+    xSemaphoreGive(timer_fired);
+}
+
+// Cost of each HAL call on the chip this was built for. Run once per target and compare
+// the logs; the numbers depend on clock speed, flash cache and the sdkconfig.
+static void bench_hal(void)
+{
+    const char *target = hal_target_name();
+    static uint8_t blob[BENCH_STORAGE_BYTES];
+    int64_t t0, dt, worst_us;
+    int raw;
+
+    hal_output_init(1ULL << BENCH_OUTPUT_PIN);
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < BENCH_OUTPUT_TOGGLES; i++) {
+        hal_output_set(BENCH_OUTPUT_PIN, i & 1);
+    }
+    dt = esp_timer_get_time() - t0;
+    ESP_LOGI(TAG, "[%s] hal_output_set: %lld ns", target, dt * 1000 / BENCH_OUTPUT_TOGGLES);
+
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < BENCH_ADC_READS; i++) {
+        hal_adc_read(BATTERY_CHANNEL, &raw);
+    }
+    dt = esp_timer_get_time() - t0;
+    ESP_LOGI(TAG, "[%s] hal_adc_read: %lld us", target, dt / BENCH_ADC_READS);
+
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < BENCH_ADC_READS; i++) {
+        hal_adc_read_mv(BATTERY_CHANNEL, &raw);
+    }
+    dt = esp_timer_get_time() - t0;
+    ESP_LOGI(TAG, "[%s] hal_adc_read_mv: %lld us", target, dt / BENCH_ADC_READS);
+
+    worst_us = 0;
+    t0 = esp_timer_get_time();
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        int64_t t1 = esp_timer_get_time();
+        size_t len = sizeof(blob);
+        blob[0] = run;
+        hal_storage_write("bench", "blob", blob, sizeof(blob));
+        hal_storage_read("bench", "blob", blob, &len);
+        dt = esp_timer_get_time() - t1;
+        if (dt > worst_us) {
+            worst_us = dt;
+        }
+    }
+    dt = esp_timer_get_time() - t0;
+    ESP_LOGI(TAG, "[%s] hal_storage write+read %d B: avg %lld us, worst %lld us",
+             target, BENCH_STORAGE_BYTES, dt / BENCH_RUNS, worst_us);
+
+    hal_timer_t timer;
+    timer_fired = xSemaphoreCreateBinary();
+    if (timer_fired != NULL && hal_timer_create(on_bench_timer, NULL, "bench", &timer) == HAL_OK) {
+        int64_t total_us = 0;
+        worst_us = 0;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            int64_t at_us = hal_time_us() + BENCH_TIMER_LEAD_US;
+            hal_timer_start_at(timer, at_us);
+            xSemaphoreTake(timer_fired, portMAX_DELAY);
+            dt = timer_fired_us - at_us;
+            total_us += dt;
+            if (dt > worst_us) {
+                worst_us = dt;
+            }
+        }
+        ESP_LOGI(TAG, "[%s] hal_timer lateness: avg %lld us, worst %lld us",
+                 target, total_us / BENCH_RUNS, worst_us);
+    }
+
+    int64_t total_us = 0;
+    worst_us = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        // Let the log drain, the UART stops while asleep
+        vTaskDelay(pdMS_TO_TICKS(10));
+        int64_t at_us = hal_time_us() + BENCH_SLEEP_US;
+        hal_sleep_light_until(at_us);
+        dt = hal_time_us() - at_us;
+        total_us += dt;
+        if (dt > worst_us) {
+            worst_us = dt;
+        }
+    }
+    ESP_LOGI(TAG, "[%s] hal_sleep_light_until wakeup: avg %lld us late, worst %lld us",
+             target, total_us / BENCH_RUNS, worst_us);
+}
+
+// LZ batch of a full telemetry store: synthetic send-on-delta frames, slowly drifting
+// values a few metrics at a time. Compression runs with the radio off, so its energy is
+// CPU time at BENCH_CPU_MA against the airtime it saves at BENCH_RADIO_MA.
+static void bench_lz(void)
+{
+    static uint8_t frames[BENCH_LZ_FRAMES * TELEMETRY_MAX_BYTES];
+    static uint8_t batch[TELEMETRY_BATCH_HEADER_BYTES + BENCH_LZ_FRAMES * TELEMETRY_MAX_BYTES];
+    static telemetry_batch_t b;
+    size_t raw = 0;
+
+    srand(2);
+    for (int f = 0; f < BENCH_LZ_FRAMES; f++) {
+        telemetry_record_t records[4];
+        int n = 1 + rand() % 4;
+        for (int i = 0; i < n; i++) {
+            records[i] = (telemetry_record_t){ .at_s = 600U * f, .value = (int16_t)(400 - f + rand() % 5),
+                                               .metric = (uint8_t)(rand() % 5) };
+        }
+        raw += telemetry_encode(records, n, 600U * f, frames + raw, sizeof(frames) - raw);
+    }
+
+    uint32_t c0 = esp_cpu_get_cycle_count();
+    telemetry_batch_start(&b, batch, sizeof(batch));
+    for (size_t at = 0, len; at < raw; at += len) {
+        len = telemetry_frame_len(frames + at, raw - at);
+        telemetry_batch_add(&b, frames + at, len);
+    }
+    size_t packed = telemetry_batch_finish(&b, 600U * BENCH_LZ_FRAMES);
+    uint32_t cycles = esp_cpu_get_cycle_count() - c0;
+
+    int64_t cpu_us = (int64_t)cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    int64_t saved_us = (int64_t)(raw - packed) * 8 * 1000 / BENCH_LINK_KBPS;
+    ESP_LOGI(TAG, "[%s] LZ batch of %d frames: %u -> %u bytes (%u%%), %lu cycles/byte, %lld us CPU",
+             hal_target_name(), BENCH_LZ_FRAMES, (unsigned)raw, (unsigned)packed, (unsigned)(packed * 100 / raw),
+             (unsigned long)(cycles / raw), cpu_us);
+    ESP_LOGI(TAG, "[%s] LZ energy: %lld uJ CPU against %lld uJ of airtime saved", hal_target_name(),
+             cpu_us * BENCH_CPU_MA * BENCH_SUPPLY_MV / 1000000, saved_us * BENCH_RADIO_MA * BENCH_SUPPLY_MV / 1000000);
+}
+
+// Cold against cached connects to the configured network, best against a local access
+// point (a phone hotspot or a second board in SoftAP mode) with the gateway listening.
+// Radio time includes the upload and its acknowledgement.
+static void bench_link(void)
+{
+    static uint8_t frame[TELEMETRY_HEADER_BYTES + BENCH_LINK_RECORDS * TELEMETRY_RECORD_BYTES];
+    telemetry_link_stats_t stats;
+
+    for (int cached = 0; cached < 2; cached++) {
+        int64_t connect_ms = 0, radio_ms = 0;
+        uint32_t worst_ms = 0;
+        int sent = 0;
+        for (int run = 0; run < BENCH_LINK_UPLOADS; run++) {
+            if (!cached) {
+                telemetry_link_forget();
+            }
+            if (telemetry_link_send(frame, sizeof(frame)) != ESP_OK) {
+                continue;
+            }
+            telemetry_link_stats(&stats);
+            connect_ms += stats.connect_ms;
+            radio_ms += stats.radio_ms;
+            if (stats.radio_ms > worst_ms) {
+                worst_ms = stats.radio_ms;
+            }
+            sent++;
+        }
+        if (sent == 0) {
+            ESP_LOGW(TAG, "[%s] upload: no network or no gateway", hal_target_name());
+            return;
+        }
+        ESP_LOGI(TAG, "[%s] upload %s: %d/%d acked, connect avg %lld ms, radio on avg %lld ms, worst %lu ms, ~%lld mJ",
+                 hal_target_name(), cached ? "cached" : "cold", sent, BENCH_LINK_UPLOADS, connect_ms / sent,
+                 radio_ms / sent, (unsigned long)worst_ms,
+                 radio_ms / sent * BENCH_RADIO_MA * BENCH_SUPPLY_MV / 1000000);
+    }
+}
+
+// Cycles per sealed datagram, a typical frame and a full batch, three ways: the
+// firmware's path (mbedtls AES in whole CBC and CTR runs), mbedtls' own CCM, which
+// goes one block at a time, and the portable aes_ccm.c the gateway uses. The mbedtls
+// paths use the accelerator with CONFIG_MBEDTLS_HARDWARE_AES, so build once with it
+// and once without for software mbedtls. Needs the key in menuconfig, and uses up
+// counters like real uploads.
+static void bench_seal(void)
+{
+    static const size_t sizes[] = { TELEMETRY_HEADER_BYTES + BENCH_LINK_RECORDS * TELEMETRY_RECORD_BYTES,
+                                    LINK_MAX_PAYLOAD };
+    static const uint8_t key[AES_CCM_KEY_BYTES] = { 0 };
+    static uint8_t in[LINK_MAX_PAYLOAD], out[LINK_MAX_DATAGRAM];
+    static aes_ccm_t soft;
+    uint8_t nonce[AES_CCM_NONCE_BYTES] = { 0 };
+    mbedtls_ccm_context ccm;
+
+    if (telemetry_crypto_init() != ESP_OK) {
+        ESP_LOGW(TAG, "[%s] sealing: no key configured", hal_target_name());
+        return;
+    }
+    aes_ccm_init(&soft, key);
+    mbedtls_ccm_init(&ccm);
+    mbedtls_ccm_setkey(&ccm, MBEDTLS_CIPHER_ID_AES, key, 8 * AES_CCM_KEY_BYTES);
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t len = sizes[s], sealed_len;
+        uint64_t counter;
+        uint32_t firmware = 0, mbedtls = 0, portable = 0;
+        for (int run = 0; run < BENCH_SEAL_RUNS; run++) {
+            uint32_t c0 = esp_cpu_get_cycle_count();
+            telemetry_crypto_seal(in, len, out, sizeof(out), &sealed_len, &counter);
+            uint32_t c1 = esp_cpu_get_cycle_count();
+            mbedtls_ccm_encrypt_and_tag(&ccm, len, nonce, sizeof(nonce), out, TELEMETRY_SEAL_HEADER_BYTES, in,
+                                        out + TELEMETRY_SEAL_HEADER_BYTES, out + TELEMETRY_SEAL_HEADER_BYTES + len,
+                                        AES_CCM_TAG_BYTES);
+            uint32_t c2 = esp_cpu_get_cycle_count();
+            telemetry_seal(&soft, 0, counter, TELEMETRY_FROM_NODE, in, len, out, sizeof(out));
+            uint32_t c3 = esp_cpu_get_cycle_count();
+            firmware += c1 - c0;
+            mbedtls += c2 - c1;
+            portable += c3 - c2;
+        }
+        ESP_LOGI(TAG, "[%s] seal %u bytes: firmware (%s AES) %lu, mbedtls CCM %lu, portable %lu cycles/frame",
+                 hal_target_name(), (unsigned)len, BENCH_AES, (unsigned long)(firmware / BENCH_SEAL_RUNS),
+                 (unsigned long)(mbedtls / BENCH_SEAL_RUNS), (unsigned long)(portable / BENCH_SEAL_RUNS));
+    }
+    mbedtls_ccm_free(&ccm);
+}
+
+void benchmarks_run(void)
+{
+    bench_water_budget();
+    bench_hal();
+    bench_lz();
+    bench_seal();
+    bench_link();
+}
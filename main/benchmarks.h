@@ -0,0 +1,5 @@
+#pragma once
+
+// On-target timing of the planning and allocation code paths, the HAL and telemetry
+// uploads. Results go to the log.
+void benchmarks_run(void);
@@ -0,0 +1,102 @@
+#include "button.h"
+
+#include "driver/rtc_io.h"
+#include "esp_check.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
+#include "control.h"
+
+#define TAG "BUTTON"
+
+static QueueHandle_t queue;
+static bool pressed;
+static int64_t edge_us;                            // Time of the last accepted edge
+
+// Level interrupts double as light sleep wakeup, so the pin always waits for the
+// opposite of its current level. Flipping it on every interrupt makes them edges.
+static void wait_for_change(bool down)
+{
+    gpio_wakeup_enable(BUTTON_PIN, down ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+}
+
+// Every edge is timestamped here and the level re-read, so bounce collapses onto the
+// first edge and the press length is known at release without a timer
+static void on_edge(void *arg)
+{
+    int64_t now_us = esp_timer_get_time();
+    bool down = gpio_get_level(BUTTON_PIN) == 0;
+    BaseType_t woken = pdFALSE;
+
+    wait_for_change(down);
+    if (now_us - edge_us < BUTTON_DEBOUNCE_US) {
+        return;
+    }
+    if (down == pressed) {
+        // A release lost in bounce shows up as a second press: restart the press here
+        if (down) {
+            edge_us = now_us;
+        }
+        return;
+    }
+    if (!down) {
+        int64_t held_us = now_us - edge_us;
+        control_event_t ev = {
+            .type = CONTROL_EVENT_BUTTON,
+            .arg = (held_us >= BUTTON_HOLD_PRESS_US) ? BUTTON_HOLD
+                 : (held_us >= BUTTON_LONG_PRESS_US) ? BUTTON_LONG : BUTTON_SHORT,
+        };
+        xQueueSendFromISR(queue, &ev, &woken);
+    }
+    pressed = down;
+    edge_us = now_us;
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+esp_err_t button_init(QueueHandle_t control_queue)
+{
+    const gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << BUTTON_PIN,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+
+    queue = control_queue;
+#if !SOC_GPIO_SUPPORT_DEEPSLEEP_WAKEUP
+    // Deep sleep wakeup hands the pin to the RTC domain, take it back
+    rtc_gpio_deinit(BUTTON_PIN);
+#endif
+    ESP_RETURN_ON_ERROR(gpio_config(&io_conf), TAG, "config");
+
+    // Woken by the button: the press started about when we came out of reset
+    pressed = gpio_get_level(BUTTON_PIN) == 0;
+    edge_us = pressed ? 0 : -BUTTON_DEBOUNCE_US;
+
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return err;
+    }
+    ESP_RETURN_ON_ERROR(gpio_isr_handler_add(BUTTON_PIN, on_edge, NULL), TAG, "isr");
+    ESP_RETURN_ON_ERROR(gpio_wakeup_enable(BUTTON_PIN, pressed ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL),
+                        TAG, "wakeup");
+    return esp_sleep_enable_gpio_wakeup();
+}
+
+esp_err_t button_enable_deep_sleep_wakeup(void)
+{
+#if !SOC_GPIO_SUPPORT_DEEPSLEEP_WAKEUP
+    // ext1 rather than ext0: on the ESP32 ext0 refuses to share deep sleep with the
+    // ULP and touch pad wakeups that flow_ulp and tank_touch arm
+    ESP_RETURN_ON_ERROR(rtc_gpio_pullup_en(BUTTON_PIN), TAG, "pull-up");
+    ESP_RETURN_ON_ERROR(rtc_gpio_pulldown_dis(BUTTON_PIN), TAG, "pull-down");
+    // ext1 does not keep the RTC pads powered the way ext0 does, the pull-up needs them
+    ESP_RETURN_ON_ERROR(esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON), TAG, "rtc power");
+    return esp_sleep_enable_ext1_wakeup(1ULL << BUTTON_PIN, ESP_EXT1_WAKEUP_ALL_LOW);
+#else
+    return esp_deep_sleep_enable_gpio_wakeup(1ULL << BUTTON_PIN, ESP_GPIO_WAKEUP_GPIO_LOW);
+#endif
+}
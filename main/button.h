@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "board_config.h"
+
+// ===== BUTTON CONFIGURATION =====
+#define BUTTON_DEBOUNCE_US       (30 * 1000)       // Edges this close to the last accepted one are bounce
+#define BUTTON_LONG_PRESS_US     (1500 * 1000)     // Held at least this long is a long press
+#define BUTTON_HOLD_PRESS_US     (10000 * 1000)    // Held at least this long calibrates the tank electrodes
+
+typedef enum {
+    BUTTON_SHORT = 0,          // Start a manual cycle, or stop the one running
+    BUTTON_LONG,               // Skip the next planned cycle
+    BUTTON_HOLD,               // Take the tank electrodes as dry, see tank_touch_calibrate_dry
+} button_press_t;
+
+// Classifies presses from timestamped edge interrupts, without any polling timer, and
+// posts CONTROL_EVENT_BUTTON with a button_press_t on release. The same interrupt
+// wakes the chip from light sleep. The pin idles high on the internal pull-up, so no
+// current flows unless the button is held.
+// If we woke from deep sleep on the button, the press in progress is picked up.
+esp_err_t button_init(QueueHandle_t control_queue);
+
+// Make a press wake the chip from deep sleep as well
+esp_err_t button_enable_deep_sleep_wakeup(void);
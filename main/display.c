@@ -0,0 +1,127 @@
+#include "display.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include "esp_log.h"
+#include "epaper.h"
+#include "forecast_store.h"
+#include "framebuffer.h"
+
+#define TAG "DISPLAY"
+#define MARGIN_X                 2
+#define LINE_H                   (FB_GLYPH_H * DISPLAY_TEXT_SCALE + 6)
+#define LABEL_GAP                10
+
+static framebuffer_t frame;                        // Frame being rendered
+static framebuffer_t shown;                        // Frame the panel holds
+static bool shown_valid;
+static bool ready;
+static int partial_count;
+static display_status_t last_status;
+
+esp_err_t display_init(void)
+{
+    esp_err_t err = epaper_init();
+
+    ready = (err == ESP_OK);
+    return err;
+}
+
+// Wall clock time when it has been set, otherwise a time relative to now
+static void format_time(char *buf, size_t size, int64_t at_us, int64_t now_us)
+{
+    struct timeval wall;
+
+    if (at_us == DISPLAY_NEVER) {
+        snprintf(buf, size, "--:--");
+        return;
+    }
+    gettimeofday(&wall, NULL);
+    if (wall.tv_sec >= FORECAST_CLOCK_VALID_S) {
+        struct tm tm;
+        time_t t = wall.tv_sec + (at_us - now_us) / 1000000;
+        localtime_r(&t, &tm);
+        snprintf(buf, size, "%02d:%02d", tm.tm_hour, tm.tm_min);
+        return;
+    }
+    int64_t min = (at_us - now_us) / (60 * 1000000LL);
+    char sign = (min < 0) ? '-' : '+';
+    min = (min < 0) ? -min : min;
+    snprintf(buf, size, "%c%dH%02d", sign, (int)(min / 60), (int)(min % 60));
+}
+
+static void render(const display_status_t *status, int64_t now_us)
+{
+    char text[16];
+    int y = MARGIN_X;
+
+    framebuffer_clear(&frame);
+    const char *state = status->watering ? "WATERING" : "IDLE";
+    if (status->idle_flow) {
+        state = "VALVE LEAK";
+    } else if (status->locked_zones) {
+        state = "FLOW ALARM";
+    }
+    framebuffer_text(&frame, MARGIN_X, y, state, DISPLAY_TEXT_SCALE);
+    y += LINE_H + LABEL_GAP;
+
+    framebuffer_text(&frame, MARGIN_X, y, "LAST", DISPLAY_TEXT_SCALE);
+    format_time(text, sizeof(text), status->last_us, now_us);
+    framebuffer_text(&frame, MARGIN_X, y + LINE_H, text, DISPLAY_TEXT_SCALE);
+    y += 2 * LINE_H + LABEL_GAP;
+
+    framebuffer_text(&frame, MARGIN_X, y, "NEXT", DISPLAY_TEXT_SCALE);
+    format_time(text, sizeof(text), status->next_us, now_us);
+    framebuffer_text(&frame, MARGIN_X, y + LINE_H, text, DISPLAY_TEXT_SCALE);
+    y += 2 * LINE_H + LABEL_GAP;
+
+    framebuffer_text(&frame, MARGIN_X, y, "BATTERY", DISPLAY_TEXT_SCALE);
+    if (status->battery_pct == DISPLAY_BATTERY_UNKNOWN) {
+        snprintf(text, sizeof(text), "--");
+    } else {
+        snprintf(text, sizeof(text), "%d%%", status->battery_pct);
+    }
+    framebuffer_text(&frame, MARGIN_X, y + LINE_H, text, DISPLAY_TEXT_SCALE);
+}
+
+static bool status_changed(const display_status_t *a, const display_status_t *b)
+{
+    return a->last_us != b->last_us || a->next_us != b->next_us || a->watering != b->watering
+        || a->locked_zones != b->locked_zones || a->idle_flow != b->idle_flow
+        || a->battery_pct / DISPLAY_BATTERY_STEP != b->battery_pct / DISPLAY_BATTERY_STEP;
+}
+
+void display_update(const display_status_t *status, int64_t now_us)
+{
+    fb_rect_t rects[FB_MAX_RECTS];
+    esp_err_t err;
+
+    if (!ready || (shown_valid && !status_changed(status, &last_status))) {
+        return;
+    }
+    render(status, now_us);
+
+    if (!shown_valid || partial_count >= DISPLAY_FULL_EVERY) {
+        err = epaper_full_refresh(&frame);
+        partial_count = 0;
+    } else {
+        int count = framebuffer_diff(&frame, &shown, rects, FB_MAX_RECTS);
+        if (count == 0) {
+            last_status = *status;
+            return;
+        }
+        err = epaper_partial_refresh(&frame, rects, count);
+        partial_count++;
+    }
+    if (err != ESP_OK) {
+        // The panel may hold anything now, start over with a full refresh
+        ESP_LOGE(TAG, "Refresh failed: %s", esp_err_to_name(err));
+        shown_valid = false;
+        return;
+    }
+    memcpy(&shown, &frame, sizeof(shown));
+    shown_valid = true;
+    last_status = *status;
+}
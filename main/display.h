@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// ===== DISPLAY CONFIGURATION =====
+#define DISPLAY_TEXT_SCALE       2                 // 5x7 glyphs drawn at 10x14
+#define DISPLAY_FULL_EVERY       20                // Partial refreshes between full ones, clears ghosting
+#define DISPLAY_BATTERY_STEP     5                 // Battery changes smaller than this do not redraw
+#define DISPLAY_BATTERY_UNKNOWN  0xFF
+#define DISPLAY_NEVER            INT64_MAX
+
+typedef struct {
+    int64_t  last_us;          // End of the last watering, DISPLAY_NEVER if none yet
+    int64_t  next_us;          // Next planned start, DISPLAY_NEVER if none in the plan
+    uint8_t  battery_pct;      // DISPLAY_BATTERY_UNKNOWN until first measured
+    bool     watering;
+    uint32_t locked_zones;     // Zones locked out after a flow alarm
+    bool     idle_flow;        // Flow seen with every zone closed
+} display_status_t;
+
+esp_err_t display_init(void);
+
+// Show status if it changed since the last call. Only the regions of the frame that
+// differ from what the panel shows are refreshed, and nothing is drawn or sent at
+// all when the status is unchanged.
+void display_update(const display_status_t *status, int64_t now_us);
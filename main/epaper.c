@@ -0,0 +1,189 @@
+#include "epaper.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+
+#define TAG "EPAPER"
+
+// SSD1680 commands
+#define CMD_DRIVER_OUTPUT        0x01
+#define CMD_DEEP_SLEEP           0x10
+#define CMD_DATA_ENTRY           0x11
+#define CMD_SW_RESET             0x12
+#define CMD_ACTIVATE             0x20
+#define CMD_UPDATE_CTRL1         0x21
+#define CMD_UPDATE_CTRL2         0x22
+#define CMD_WRITE_RAM_BW         0x24
+#define CMD_WRITE_RAM_RED        0x26              // Holds the previous image in partial mode
+#define CMD_BORDER               0x3C
+#define CMD_RAM_X_RANGE          0x44
+#define CMD_RAM_Y_RANGE          0x45
+#define CMD_RAM_X_COUNTER        0x4E
+#define CMD_RAM_Y_COUNTER        0x4F
+#define CMD_TEMP_SENSOR          0x18
+
+#define UPDATE_FULL              0xF7              // Clock, analog, temperature, LUT, display, power off
+#define UPDATE_PARTIAL           0xFF              // As above with display mode 2
+#define DEEP_SLEEP_KEEP_RAM      0x01
+
+static spi_device_handle_t spi;
+static WORD_ALIGNED_ATTR uint8_t tx[sizeof(((framebuffer_t *)0)->px)];
+
+static esp_err_t send(bool data, const uint8_t *bytes, size_t len)
+{
+    spi_transaction_t t = {
+        .length = len * 8,
+        .tx_buffer = bytes,
+    };
+
+    gpio_set_level(EPAPER_DC_PIN, data);
+    return spi_device_polling_transmit(spi, &t);
+}
+
+static esp_err_t command(uint8_t cmd, const uint8_t *args, size_t len)
+{
+    ESP_RETURN_ON_ERROR(send(false, &cmd, 1), TAG, "command 0x%02x", cmd);
+    return len ? send(true, args, len) : ESP_OK;
+}
+
+static esp_err_t wait_idle(void)
+{
+    for (int ms = 0; gpio_get_level(EPAPER_BUSY_PIN); ms += 10) {
+        if (ms >= EPAPER_BUSY_TIMEOUT_MS) {
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return ESP_OK;
+}
+
+static esp_err_t set_window(const fb_rect_t *r)
+{
+    const uint8_t x_range[] = { r->x0, r->x1 - 1 };
+    const uint8_t y_range[] = { r->y0 & 0xFF, r->y0 >> 8, (r->y1 - 1) & 0xFF, (r->y1 - 1) >> 8 };
+    const uint8_t y_counter[] = { r->y0 & 0xFF, r->y0 >> 8 };
+
+    ESP_RETURN_ON_ERROR(command(CMD_RAM_X_RANGE, x_range, sizeof(x_range)), TAG, "x range");
+    ESP_RETURN_ON_ERROR(command(CMD_RAM_Y_RANGE, y_range, sizeof(y_range)), TAG, "y range");
+    ESP_RETURN_ON_ERROR(command(CMD_RAM_X_COUNTER, &r->x0, 1), TAG, "x counter");
+    return command(CMD_RAM_Y_COUNTER, y_counter, sizeof(y_counter));
+}
+
+// Gather a rectangle into the DMA buffer so each RAM write is a single transaction
+static esp_err_t write_rect(uint8_t ram, const framebuffer_t *fb, const fb_rect_t *r)
+{
+    size_t width = r->x1 - r->x0;
+    size_t len = 0;
+
+    for (int y = r->y0; y < r->y1; y++, len += width) {
+        memcpy(&tx[len], &fb->px[y * FB_STRIDE + r->x0], width);
+    }
+    ESP_RETURN_ON_ERROR(set_window(r), TAG, "window");
+    return command(ram, tx, len);
+}
+
+// Hardware reset wakes the controller from deep sleep with its RAM intact. Only a full
+// refresh also resets the controller, since that does not rely on the old image.
+static esp_err_t wake(bool full)
+{
+    const uint8_t driver_output[] = { (FB_HEIGHT - 1) & 0xFF, (FB_HEIGHT - 1) >> 8, 0x00 };
+    const uint8_t data_entry = 0x03;                   // X and Y increment
+    const uint8_t border = 0x05;
+    const uint8_t update_ctrl1[] = { 0x00, 0x80 };
+    const uint8_t internal_sensor = 0x80;
+
+    gpio_set_level(EPAPER_RST_PIN, 0);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    gpio_set_level(EPAPER_RST_PIN, 1);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    if (full) {
+        ESP_RETURN_ON_ERROR(command(CMD_SW_RESET, NULL, 0), TAG, "reset");
+        ESP_RETURN_ON_ERROR(wait_idle(), TAG, "reset");
+    }
+    ESP_RETURN_ON_ERROR(command(CMD_DRIVER_OUTPUT, driver_output, sizeof(driver_output)), TAG, "driver output");
+    ESP_RETURN_ON_ERROR(command(CMD_DATA_ENTRY, &data_entry, 1), TAG, "data entry");
+    ESP_RETURN_ON_ERROR(command(CMD_BORDER, &border, 1), TAG, "border");
+    ESP_RETURN_ON_ERROR(command(CMD_UPDATE_CTRL1, update_ctrl1, sizeof(update_ctrl1)), TAG, "update control");
+    return command(CMD_TEMP_SENSOR, &internal_sensor, 1);
+}
+
+static esp_err_t refresh(uint8_t mode)
+{
+    ESP_RETURN_ON_ERROR(command(CMD_UPDATE_CTRL2, &mode, 1), TAG, "update mode");
+    ESP_RETURN_ON_ERROR(command(CMD_ACTIVATE, NULL, 0), TAG, "activate");
+    return wait_idle();
+}
+
+static esp_err_t sleep(void)
+{
+    const uint8_t mode = DEEP_SLEEP_KEEP_RAM;
+
+    return command(CMD_DEEP_SLEEP, &mode, 1);
+}
+
+esp_err_t epaper_init(void)
+{
+    const spi_bus_config_t bus_cfg = {
+        .mosi_io_num = EPAPER_MOSI_PIN,
+        .miso_io_num = -1,
+        .sclk_io_num = EPAPER_SCLK_PIN,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = sizeof(tx),
+    };
+    const spi_device_interface_config_t dev_cfg = {
+        .clock_speed_hz = EPAPER_CLOCK_HZ,
+        .mode = 0,
+        .spics_io_num = EPAPER_CS_PIN,
+        .queue_size = 1,
+    };
+    const gpio_config_t out_conf = {
+        .pin_bit_mask = (1ULL << EPAPER_DC_PIN) | (1ULL << EPAPER_RST_PIN),
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE
+    };
+    const gpio_config_t busy_conf = {
+        .pin_bit_mask = 1ULL << EPAPER_BUSY_PIN,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE
+    };
+
+    ESP_RETURN_ON_ERROR(gpio_config(&out_conf), TAG, "control pins");
+    ESP_RETURN_ON_ERROR(gpio_config(&busy_conf), TAG, "busy pin");
+    gpio_set_level(EPAPER_RST_PIN, 1);
+    ESP_RETURN_ON_ERROR(spi_bus_initialize(EPAPER_SPI_HOST, &bus_cfg, SPI_DMA_CH_AUTO), TAG, "spi bus");
+    return spi_bus_add_device(EPAPER_SPI_HOST, &dev_cfg, &spi);
+}
+
+esp_err_t epaper_full_refresh(const framebuffer_t *fb)
+{
+    const fb_rect_t all = { .x0 = 0, .x1 = FB_STRIDE, .y0 = 0, .y1 = FB_HEIGHT };
+
+    ESP_RETURN_ON_ERROR(wake(true), TAG, "wake");
+    ESP_RETURN_ON_ERROR(write_rect(CMD_WRITE_RAM_BW, fb, &all), TAG, "write");
+    ESP_RETURN_ON_ERROR(write_rect(CMD_WRITE_RAM_RED, fb, &all), TAG, "write previous");
+    ESP_RETURN_ON_ERROR(refresh(UPDATE_FULL), TAG, "refresh");
+    return sleep();
+}
+
+esp_err_t epaper_partial_refresh(const framebuffer_t *fb, const fb_rect_t *rects, int count)
+{
+    ESP_RETURN_ON_ERROR(wake(false), TAG, "wake");
+    for (int i = 0; i < count; i++) {
+        ESP_RETURN_ON_ERROR(write_rect(CMD_WRITE_RAM_BW, fb, &rects[i]), TAG, "write");
+    }
+    ESP_RETURN_ON_ERROR(refresh(UPDATE_PARTIAL), TAG, "refresh");
+
+    // The panel now shows the new image: make it the reference for the next partial refresh
+    for (int i = 0; i < count; i++) {
+        ESP_RETURN_ON_ERROR(write_rect(CMD_WRITE_RAM_RED, fb, &rects[i]), TAG, "write previous");
+    }
+    return sleep();
+}
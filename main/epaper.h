@@ -0,0 +1,25 @@
+#pragma once
+
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "board_config.h"
+#include "framebuffer.h"
+
+// ===== E-PAPER CONFIGURATION =====
+// 2.13" 122x250 panel with an SSD1680 controller
+#define EPAPER_SPI_HOST          SPI2_HOST
+#define EPAPER_CLOCK_HZ          (4 * 1000 * 1000)
+#define EPAPER_BUSY_TIMEOUT_MS   5000              // A full refresh takes about 2 s
+
+esp_err_t epaper_init(void);
+
+// Write the whole frame to both controller RAMs and run a full refresh
+esp_err_t epaper_full_refresh(const framebuffer_t *fb);
+
+// Write only the given regions and run a partial refresh. The controller keeps the
+// previous image, so it must still hold the frame the rectangles were diffed against.
+esp_err_t epaper_partial_refresh(const framebuffer_t *fb, const fb_rect_t *rects, int count);
+
+// Both refreshes end with the controller in deep sleep, holding its RAM. The image
+// stays on the panel with no power drawn.
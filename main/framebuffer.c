@@ -0,0 +1,117 @@
+#include "framebuffer.h"
+
+#include <string.h>
+
+#define FONT_FIRST               ' '
+#define FONT_LAST                'Z'
+
+// Column-major 5x7 glyphs, LSB at the top. Kept const so they stay in flash.
+static const uint8_t font[FONT_LAST - FONT_FIRST + 1][FB_GLYPH_W] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 }, // ' ' !
+    { 0x00, 0x07, 0x00, 0x07, 0x00 }, { 0x14, 0x7F, 0x14, 0x7F, 0x14 }, // " #
+    { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 }, // $ %
+    { 0x36, 0x49, 0x56, 0x20, 0x50 }, { 0x00, 0x08, 0x07, 0x03, 0x00 }, // & '
+    { 0x00, 0x1C, 0x22, 0x41, 0x00 }, { 0x00, 0x41, 0x22, 0x1C, 0x00 }, // ( )
+    { 0x2A, 0x1C, 0x7F, 0x1C, 0x2A }, { 0x08, 0x08, 0x3E, 0x08, 0x08 }, // * +
+    { 0x00, 0x80, 0x70, 0x30, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, // , -
+    { 0x00, 0x00, 0x60, 0x60, 0x00 }, { 0x20, 0x10, 0x08, 0x04, 0x02 }, // . /
+    { 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 }, // 0 1
+    { 0x72, 0x49, 0x49, 0x49, 0x46 }, { 0x21, 0x41, 0x49, 0x4D, 0x33 }, // 2 3
+    { 0x18, 0x14, 0x12, 0x7F, 0x10 }, { 0x27, 0x45, 0x45, 0x45, 0x39 }, // 4 5
+    { 0x3C, 0x4A, 0x49, 0x49, 0x31 }, { 0x41, 0x21, 0x11, 0x09, 0x07 }, // 6 7
+    { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x46, 0x49, 0x49, 0x29, 0x1E }, // 8 9
+    { 0x00, 0x00, 0x14, 0x00, 0x00 }, { 0x00, 0x40, 0x34, 0x00, 0x00 }, // : ;
+    { 0x00, 0x08, 0x14, 0x22, 0x41 }, { 0x14, 0x14, 0x14, 0x14, 0x14 }, // < =
+    { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x59, 0x09, 0x06 }, // > ?
+    { 0x3E, 0x41, 0x5D, 0x59, 0x4E }, { 0x7C, 0x12, 0x11, 0x12, 0x7C }, // @ A
+    { 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 }, // B C
+    { 0x7F, 0x41, 0x41, 0x41, 0x3E }, { 0x7F, 0x49, 0x49, 0x49, 0x41 }, // D E
+    { 0x7F, 0x09, 0x09, 0x09, 0x01 }, { 0x3E, 0x41, 0x41, 0x51, 0x73 }, // F G
+    { 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 }, // H I
+    { 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 }, // J K
+    { 0x7F, 0x40, 0x40, 0x40, 0x40 }, { 0x7F, 0x02, 0x1C, 0x02, 0x7F }, // L M
+    { 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E }, // N O
+    { 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E }, // P Q
+    { 0x7F, 0x09, 0x19, 0x29, 0x46 }, { 0x26, 0x49, 0x49, 0x49, 0x32 }, // R S
+    { 0x03, 0x01, 0x7F, 0x01, 0x03 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F }, // T U
+    { 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x3F, 0x40, 0x38, 0x40, 0x3F }, // V W
+    { 0x63, 0x14, 0x08, 0x14, 0x63 }, { 0x03, 0x04, 0x78, 0x04, 0x03 }, // X Y
+    { 0x61, 0x59, 0x49, 0x4D, 0x43 },                                   // Z
+};
+
+static void set_black(framebuffer_t *fb, int x, int y)
+{
+    if (x >= 0 && x < FB_WIDTH && y >= 0 && y < FB_HEIGHT) {
+        fb->px[y * FB_STRIDE + x / 8] &= ~(0x80 >> (x % 8));
+    }
+}
+
+void framebuffer_clear(framebuffer_t *fb)
+{
+    memset(fb->px, 0xFF, sizeof(fb->px));
+}
+
+int framebuffer_text(framebuffer_t *fb, int x, int y, const char *text, int scale)
+{
+    for (; *text; text++, x += FB_GLYPH_ADVANCE * scale) {
+        char c = (*text >= 'a' && *text <= 'z') ? *text - 'a' + 'A' : *text;
+        if (c < FONT_FIRST || c > FONT_LAST) {
+            continue;
+        }
+        const uint8_t *glyph = font[c - FONT_FIRST];
+        for (int col = 0; col < FB_GLYPH_W; col++) {
+            for (int row = 0; row < 8; row++) {
+                if (!(glyph[col] & (1 << row))) {
+                    continue;
+                }
+                for (int dy = 0; dy < scale; dy++) {
+                    for (int dx = 0; dx < scale; dx++) {
+                        set_black(fb, x + col * scale + dx, y + row * scale + dy);
+                    }
+                }
+            }
+        }
+    }
+    return x;
+}
+
+int framebuffer_diff(const framebuffer_t *cur, const framebuffer_t *prev, fb_rect_t *rects, int max)
+{
+    int count = 0;
+    bool open = false;
+
+    for (int y = 0; y < FB_HEIGHT; y++) {
+        const uint8_t *a = &cur->px[y * FB_STRIDE];
+        const uint8_t *b = &prev->px[y * FB_STRIDE];
+        int x0 = 0;
+        int x1 = FB_STRIDE;
+
+        while (x0 < FB_STRIDE && a[x0] == b[x0]) {
+            x0++;
+        }
+        if (x0 == FB_STRIDE) {
+            open = false;
+            continue;
+        }
+        while (a[x1 - 1] == b[x1 - 1]) {
+            x1--;
+        }
+
+        // A changed row directly below the current band extends it. Out of rectangles,
+        // the last one grows down to cover later bands as well.
+        if ((open || count == max) && count > 0) {
+            fb_rect_t *r = &rects[count - 1];
+            r->x0 = (x0 < r->x0) ? x0 : r->x0;
+            r->x1 = (x1 > r->x1) ? x1 : r->x1;
+            r->y1 = y + 1;
+            open = true;
+            continue;
+        }
+        if (count == max) {
+            break;
+        }
+        rects[count++] = (fb_rect_t){ .x0 = x0, .x1 = x1, .y0 = y, .y1 = y + 1 };
+        open = true;
+    }
+    return count;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== FRAMEBUFFER CONFIGURATION =====
+#define FB_WIDTH                 128               // Pixels per row in panel RAM, 122 are visible
+#define FB_HEIGHT                250
+#define FB_STRIDE                (FB_WIDTH / 8)
+#define FB_MAX_RECTS             4                 // Dirty rectangles per update, more are merged
+#define FB_GLYPH_W               5
+#define FB_GLYPH_H               7
+#define FB_GLYPH_ADVANCE         (FB_GLYPH_W + 1)
+
+// 1 bit per pixel, MSB first, in panel polarity: 1 = white, 0 = black
+typedef struct {
+    uint8_t px[FB_STRIDE * FB_HEIGHT];
+} framebuffer_t;
+
+// Changed region. X is in bytes of 8 pixels as the panel addresses RAM; ends are exclusive.
+typedef struct {
+    uint8_t  x0, x1;
+    uint16_t y0, y1;
+} fb_rect_t;
+
+void framebuffer_clear(framebuffer_t *fb);
+
+// Draw text with the built-in 5x7 font scaled by scale. Lower case is drawn as upper
+// case and characters outside the font as blanks. Returns the x after the last glyph.
+int framebuffer_text(framebuffer_t *fb, int x, int y, const char *text, int scale);
+
+// Rectangles covering every byte that differs between cur and prev, at most max.
+// Rows that changed are grouped into bands; each band spans the columns changed in it.
+int framebuffer_diff(const framebuffer_t *cur, const framebuffer_t *prev, fb_rect_t *rects, int max);
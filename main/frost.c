@@ -0,0 +1,38 @@
+#include "frost.h"
+
+static bool update_cold(const frost_config_t *cfg, frost_state_t *state, int16_t temp_dc)
+{
+    if (temp_dc < cfg->postpone_below_dc) {
+        state->cold = true;
+    } else if (temp_dc >= cfg->resume_above_dc) {
+        state->cold = false;
+    }
+    return state->cold;
+}
+
+frost_action_t frost_check_start(const frost_config_t *cfg, frost_state_t *state, int zone,
+                                 int16_t temp_dc, int64_t now_us)
+{
+    uint32_t bit = 1U << zone;
+
+    if (!update_cold(cfg, state, temp_dc)) {
+        state->held &= ~bit;
+        return FROST_WATER;
+    }
+    if (!(state->held & bit)) {
+        state->held |= bit;
+        state->held_since_us[zone] = now_us;
+    }
+    // Skip if the next retry would land past the longest allowed hold
+    int64_t held_us = now_us - state->held_since_us[zone] + (int64_t)cfg->retry_s * 1000000;
+    if (held_us > (int64_t)cfg->max_postpone_s * 1000000) {
+        state->held &= ~bit;
+        return FROST_SKIP;
+    }
+    return FROST_POSTPONE;
+}
+
+bool frost_protecting(const frost_config_t *cfg, int16_t temp_dc)
+{
+    return cfg->circulate_s > 0 && temp_dc < cfg->circulate_below_dc;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== FROST PROTECTION CONFIGURATION =====
+#define FROST_MAX_ZONES          8
+
+typedef enum {
+    FROST_WATER = 0,           // Warm enough, water as planned
+    FROST_POSTPONE,            // Too cold, try again after retry_s
+    FROST_SKIP,                // Cold for longer than max_postpone_s, give up on this cycle
+} frost_action_t;
+
+// Temperatures are in tenths of a degree Celsius
+typedef struct {
+    int16_t  postpone_below_dc;    // Cycles do not start below this
+    int16_t  resume_above_dc;      // ...and stay held until it is at least this warm again
+    int16_t  circulate_below_dc;   // Run the pump briefly below this to keep lines from freezing
+    uint32_t retry_s;              // Delay before a postponed cycle is tried again
+    uint32_t max_postpone_s;       // Cycles held longer than this are skipped
+    uint32_t circulate_s;          // Length of one anti-freeze circulation run, 0 = disabled
+    uint32_t check_s;              // Re-check period while frost protection is active
+} frost_config_t;
+
+typedef struct {
+    bool     cold;                                 // Hysteresis state
+    uint32_t held;                                 // Zones whose cycle is being held
+    int64_t  held_since_us[FROST_MAX_ZONES];
+} frost_state_t;
+
+// Decide what to do with a cycle that is due to start, given the epoch's temperature
+frost_action_t frost_check_start(const frost_config_t *cfg, frost_state_t *state, int zone,
+                                 int16_t temp_dc, int64_t now_us);
+
+// True while cold enough that idle lines should be circulated and temperature re-checked.
+// Never with circulate_s 0: held cycles are retried from the plan, so the frost gate
+// alone costs no wakeups of its own.
+bool frost_protecting(const frost_config_t *cfg, int16_t temp_dc);
@@ -6,92 +6,286 @@
 
 #include <stdio.h>
 #include <inttypes.h>
+#include <sys/time.h>
 #include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/timers.h"
-#include "driver/gpio.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
-#include "esp_sleep.h"
+#include "esp_attr.h"
+#include "benchmarks.h"
+#include "board_config.h"
+#include "button.h"
+#include "control.h"
+#include "cycle_soak.h"
+#include "display.h"
+#include "flow_meter.h"
+#include "flow_ulp.h"
+#include "forecast_store.h"
+#include "frost.h"
+#include "board_hal.h"
+#include "journal_store.h"
+#include "leak_detect.h"
+#include "moisture_track.h"
+#include "planner.h"
+#include "pressure.h"
+#include "sensors.h"
+#include "tank_touch.h"
+#include "telemetry.h"
+#include "telemetry_link.h"
+#include "telemetry_store.h"
+#include "timer_service.h"
+#include "water_budget.h"
 
-// #define DEBUG
+// #define BENCHMARK
 
 
 // ===== CONFIGURABLE SETTINGS =====
-#define MOTOR_DRIVER_PIN         GPIO_NUM_14        // GPIO pin for motor driver control
-#define LIGHT_PIN                GPIO_NUM_2        // GPIO pin for built-in LED light
-#ifdef DEBUG
-#define WATERING_INTERVAL_HOURS  0.1                 // Hours between watering cycles
-#define WATERING_DURATION_MIN    1                // Minutes to keep water flowing
-#else
-#define WATERING_INTERVAL_HOURS  8  
-#define WATERING_DURATION_MIN    10                // Minutes to keep water flowing
-#endif
-#define WATERING_DURATION_MS     (WATERING_DURATION_MIN * 60 * 1000)  // Convert to milliseconds
-#define WATERING_INTERVAL_MS     (WATERING_INTERVAL_HOURS * 60 * 60 * 1000)  // Convert to milliseconds
+// Pins, zones and watering times live in board_config.h
+#define PUMP_FLOW_ML_PER_MIN     2000              // Delivery rate used to turn volumes into run time
+#define TANK_RESERVE_ML          10000             // Never pump the tank below this
+#define TANK_CHECK_S             15                // Tank poll while pumping, chips without the ADC monitor
+#define FLOW_SAMPLE_MS           1000              // Flow check period while the pump runs
+#define PUMP_SLEEP_CHECK_S       30                // Once flow has settled, sleep and check this often, 0 stays awake
+#define PUMP_BURST_CHECK_S       5                 // The same without the ULP watching for bursts in sleep
+#define PUMP_BURST_WAKE_PCT      125               // One ULP window this far over the expected flow wakes the CPU
+#define PUMP_ALERT_SAMPLES       10                // Short samples after a burst wake, enough for the leak detector
+#define PUMP_EARLY_TARGET_PCT    80                // A volume target reached in less of its expected time is a leak
+#define PUMP_SLEEP_MIN_MS        200               // Shorter gaps are not worth a light sleep
+#define SUPPLY_RETRY_S           (10 * 60)         // Re-check interval while supply pressure is low
+#define SUPPLY_MAX_WAIT_S        (2 * 60 * 60)     // Skip the cycle if the supply stays low this long
+#define RESUME_MIN_S             30                // Interrupted cycles with less than this left count as done
+#define REPORT_HEARTBEAT_S       (6 * 60 * 60)     // Every metric is reported at least this often
+#define REPORT_TANK_DL           50                // Deadbands, changes smaller than these are not reported
+#define REPORT_TEMP_DC           10
+#define REPORT_BATTERY_PCT       3
+#define REPORT_MOISTURE_PCT      3
+#define ZONE_ALL                 ((uint32_t)((1ULL << ZONE_COUNT) - 1))
 
 // ===== SYSTEM CONFIGURATION =====
 #define TAG "IRRIGATION_SYSTEM"
 #define STACK_SIZE               4096
 #define PRIORITY                 5
-#define TIMER_PERIOD_MS          1000              // Check every second instead of using very long timers
 
 // ===== GLOBAL VARIABLES =====
-static TimerHandle_t watering_timer;
-static TimerHandle_t check_timer;
+static QueueHandle_t control_queue;
+static wheel_timer_t plan_timer;
 static bool is_watering = false;
-static uint32_t seconds_since_last_watering = 0;
+static uint32_t running_zones;
+static RTC_DATA_ATTR plan_t plan;
+static budget_workspace_t budget_ws;
+static wheel_timer_t flow_timer;
+static leak_detector_t leak_detector;
+static uint32_t watched_zones;
+static uint32_t flow_last_pulses;
+static uint32_t flow_samples;
+static int64_t flow_last_us;
+static bool flow_window_open;                      // Sampling flow, PCNT must keep counting
+static bool flow_ulp_ready;                        // The ULP counts flow through light sleep
+static uint32_t flow_alert_samples;                // Short samples still owed after a burst wake
+static wheel_timer_t tank_timer;
+static bool tank_polled;                           // No ADC monitor, the tank is read on tank_timer
+static bool tank_touch_ready;                      // Electrodes gate the pump and wake on a refill
+static bool button_wakes_deep;                     // A press wakes the node from deep sleep
+static wheel_timer_t sense_timer;
+static RTC_DATA_ATTR moisture_track_t moisture_track[ZONE_COUNT];
+static RTC_DATA_ATTR int64_t early_at_us[ZONE_COUNT];  // Cycle last brought forward, 0 for never
+static RTC_DATA_ATTR int64_t skipped_at_us[ZONE_COUNT];  // Start of the cycle last skipped by hand
+
+#define REPORT_METRICS           (TELEMETRY_MOISTURE_PCT + ZONE_COUNT)
+static const telemetry_policy_t report_policy[REPORT_METRICS] = {
+    [TELEMETRY_TANK_DL] = { .deadband = REPORT_TANK_DL, .max_silence_s = REPORT_HEARTBEAT_S },
+    [TELEMETRY_TEMP_DC] = { .deadband = REPORT_TEMP_DC, .max_silence_s = REPORT_HEARTBEAT_S },
+    [TELEMETRY_BATTERY_PCT] = { .deadband = REPORT_BATTERY_PCT, .max_silence_s = REPORT_HEARTBEAT_S },
+    [TELEMETRY_FLOW_ALARM] = { .deadband = 0, .max_silence_s = REPORT_HEARTBEAT_S },
+    [TELEMETRY_MOISTURE_PCT ... REPORT_METRICS - 1] = { .deadband = REPORT_MOISTURE_PCT, .max_silence_s = REPORT_HEARTBEAT_S },
+};
+static RTC_DATA_ATTR telemetry_metric_t reported[REPORT_METRICS];
+static telemetry_record_t report[REPORT_METRICS];  // Waiting for the link, newest epoch only
+static int report_count;
+static bool link_ready;                            // Wi-Fi configured, otherwise reports go to the console
+static int64_t pump_on_us;
+static int64_t pump_slept_us;
+static uint32_t pump_wakeups;
+static RTC_DATA_ATTR leak_baseline_t leak_baseline;
+static RTC_DATA_ATTR uint32_t leak_zones;         // Zones locked out after a flow alarm
+static RTC_DATA_ATTR bool idle_flow_seen;         // Flow with every zone closed, locks out all zones
+static wheel_timer_t frost_timer;
+static RTC_DATA_ATTR frost_state_t frost_state;
+static RTC_DATA_ATTR bool supply_waiting;
+static RTC_DATA_ATTR int64_t supply_wait_since_us;
+static int64_t last_watered_us = DISPLAY_NEVER;
+static RTC_NOINIT_ATTR journal_t journal;         // Survives every reset except a power cut
+static bool journal_dirty;
+static uint8_t battery_pct = DISPLAY_BATTERY_UNKNOWN;
+
+typedef struct {
+    uint8_t  target_pct;       // Moisture a full cycle brings the zone back to
+    uint8_t  dry_pct;          // At or below this the zone needs a full cycle
+    uint8_t  priority;         // Share of a short tank, higher wins
+    uint32_t min_ml;           // Smaller doses are skipped as useless
+    uint32_t pulse_s;          // Longest run before runoff starts, 0 = water in one block
+    uint32_t soak_s;           // Rest between pulses so the water soaks in
+} zone_water_t;
+
+_Static_assert(ZONE_COUNT <= SENSORS_MAX_ZONES && ZONE_COUNT <= BUDGET_MAX_ZONES, "Too many zones in board_config.h");
+
+// Expanded from BOARD_ZONES, which board_config.h has already checked
+#define ZONE_RULE(period_min, duration_min, offset_min, ...) \
+    { .enabled = true, .interval_s = (period_min) * 60, .duration_s = (duration_min) * 60, .offset_s = (offset_min) * 60 },
+#define ZONE_MOISTURE(period_min, duration_min, offset_min, gpio, ...) \
+    BOARD_ADC1_CHANNEL(gpio),
+#define ZONE_WATER(period_min, duration_min, offset_min, gpio, target, dry, prio, min, pulse, soak) \
+    { .target_pct = (target), .dry_pct = (dry), .priority = (prio), .min_ml = (min), .pulse_s = (pulse), .soak_s = (soak) },
+
+static const zone_rule_t zone_rules[ZONE_COUNT] = { BOARD_ZONES(ZONE_RULE) };
+static const adc_channel_t moisture_channels[ZONE_COUNT] = { BOARD_ZONES(ZONE_MOISTURE) };
+static const zone_water_t zone_water[ZONE_COUNT] = { BOARD_ZONES(ZONE_WATER) };
+
+static const frost_config_t frost_config = {
+    .postpone_below_dc = 30,                       // 3.0 C
+    .resume_above_dc = 50,                         // 5.0 C
+    .circulate_below_dc = 5,                       // 0.5 C
+    .retry_s = 60 * 60,
+    .max_postpone_s = 6 * 60 * 60,
+    .circulate_s = 0,                              // e.g. 30 to keep exposed lines moving
+    .check_s = 30 * 60,
+};
+
+static const pressure_config_t pressure_config = {
+    .min_start_kpa = 80,
+    .min_running_kpa = 50,
+    .blocked_kpa = 400,
+    .low_flow_pct = 50,
+    .min_flow_ml_per_min = 300,
+};
+
+// Skip cycles with rain likely in the next 6 hours and shorten them as it gets likelier
+static const forecast_policy_t forecast_policy = {
+    .shrink_rain_pct = 30,
+    .skip_rain_pct = 70,
+    .min_keep_pct = 40,
+    .lookahead_h = 6,
+    .cool_c = 15,
+    .cool_keep_pct = 75,
+};
 
 // ===== FUNCTION DECLARATIONS =====
 static void start_watering(void);
 static void stop_watering(void);
-static void watering_timer_callback(TimerHandle_t xTimer);
-static void check_timer_callback(TimerHandle_t xTimer);
+static void start_zone(int zone);
+static void stop_zone(int zone);
+static void start_zones(uint32_t mask, int64_t now_us);
+static void start_soak(uint32_t mask, const soak_zone_t *soak, int64_t now_us);
+static void update_pump(void);
+static uint32_t frost_gate(uint32_t mask, const uint32_t *planned_s, int16_t temp_dc, int64_t now_us);
+static void frost_watch(int16_t temp_dc, bool pumping, int64_t now_us);
+static void check_frost(void);
+static bool postpone_cycle(int zone, uint32_t delay_s, uint32_t run_s, int64_t now_us);
+static void skip_cycle(int zone);
+static uint32_t supply_gate(uint32_t mask, const uint32_t *planned_s, int64_t now_us);
+static void abort_zones(uint32_t mask, bool lock_out, int64_t now_us);
+static void idle_flow_alarm(void);
+static void watch_flow(int64_t now_us);
+static void check_flow(void);
+static void check_tank(void);
+static void check_sensors(void);
+static void use_epoch(const sensor_epoch_t *epoch);
+static void report_epoch(const sensor_epoch_t *epoch);
+static void send_report(void);
+static size_t prepare_backlog(uint8_t *datagram, size_t size, int *frames);
+static void tank_at_reserve(void);
+static void apply_forecast(int64_t now_us, uint32_t zones);
+static void handle_button(button_press_t press);
+static void run_due_events(void);
+// Cheap unless something shown on the panel changed
+static void refresh_display(void);
+static void sleep_through_pulse(void);
+static void sleep_while_empty(void);
+static uint32_t pulse_volume_target(int64_t now_us);
+static uint32_t pulse_burst_target(void);
+static void pulse_target_reached(uint32_t pulses, int64_t counted_us, int64_t now_us);
+static void recover_cycles(int64_t now_us);
 static void irrigation_task(void* pvParameters);
 
 void app_main(void)
 {
-    ESP_LOGI(TAG, "Starting Irrigation System...");
+    // Everything kept in RTC memory is timed on this clock, so it goes first
+    hal_time_init();
+    
+    ESP_LOGI(TAG, "Starting Irrigation System on %s...", hal_target_name());
     ESP_LOGI(TAG, "Configuration:");
     ESP_LOGI(TAG, "  Motor Driver Pin: GPIO %d", MOTOR_DRIVER_PIN);
     ESP_LOGI(TAG, "  Built-in Light Pin: GPIO %d", LIGHT_PIN);
-    ESP_LOGI(TAG, "  Watering Interval: %d hours", WATERING_INTERVAL_HOURS);
+    ESP_LOGI(TAG, "  Watering Interval: %d minutes", WATERING_INTERVAL_MIN);
     ESP_LOGI(TAG, "  Watering Duration: %d minutes", WATERING_DURATION_MIN);
     
-    // Configure GPIO pins for motor driver and light
-    gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << MOTOR_DRIVER_PIN) | (1ULL << LIGHT_PIN),
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE
-    };
-    gpio_config(&io_conf);
-    
-    // Initialize motor driver pin to OFF state and light to OFF state
-    gpio_set_level(MOTOR_DRIVER_PIN, 0);
-    gpio_set_level(LIGHT_PIN, 0);
+    // Configure the motor driver and light outputs, both start OFF
+    hal_output_init((1ULL << MOTOR_DRIVER_PIN) | (1ULL << LIGHT_PIN));
     ESP_LOGI(TAG, "Motor driver pin initialized to OFF state");
     ESP_LOGI(TAG, "Built-in light initialized to OFF state");
     
-    // Create timers
-    watering_timer = xTimerCreate("watering_timer", 
-                                 pdMS_TO_TICKS(WATERING_DURATION_MS),
-                                 pdFALSE,  // One-shot timer
-                                 NULL, 
-                                 watering_timer_callback);
+    if (sensors_init(moisture_channels, ZONE_COUNT) != ESP_OK) {
+        ESP_LOGW(TAG, "Sensors unavailable, watering on the fixed schedule only");
+    }
+    
+    if (hal_storage_init() != ESP_OK || forecast_store_start_console() != ESP_OK) {
+        ESP_LOGW(TAG, "Forecast upload unavailable");
+    }
     
-    check_timer = xTimerCreate("check_timer",
-                              pdMS_TO_TICKS(TIMER_PERIOD_MS),
-                              pdTRUE,   // Auto-reload timer
-                              NULL,
-                              check_timer_callback);
+    // Calibration keeps the dry readings in storage, so this comes after it
+    tank_touch_ready = (tank_touch_init() == ESP_OK);
+    if (!tank_touch_ready) {
+        ESP_LOGI(TAG, "No tank electrodes, the level sensor alone guards the reserve");
+    }
     
-    if (watering_timer == NULL || check_timer == NULL) {
+    // So does the cached access point
+    link_ready = (telemetry_link_init() == ESP_OK);
+    if (!link_ready) {
+        ESP_LOGI(TAG, "No Wi-Fi network configured, telemetry goes to the console");
+    }
+    // Stored frames are timed on a clock the power cut restarted
+    if (hal_reset_reason() == HAL_RESET_POWER_ON && telemetry_store_count() > 0) {
+        telemetry_store_clear();
+    }
+    
+#ifdef BENCHMARK
+    benchmarks_run();
+#endif
+    
+    // The plan only survives a deep sleep wakeup; anything else starts a fresh schedule
+    if (hal_reset_reason() != HAL_RESET_DEEP_SLEEP) {
+        planner_invalidate(&plan);
+    }
+    
+    // All timers run off one timing wheel that posts into the control queue
+    control_queue = xQueueCreate(CONTROL_QUEUE_LENGTH, sizeof(control_event_t));
+    if (control_queue == NULL || timer_service_init(control_queue) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to create timers");
         return;
     }
     
+    if (flow_meter_init(control_queue) == ESP_OK) {
+        flow_meter_set_idle(true);
+        flow_ulp_ready = (flow_ulp_init() == ESP_OK);
+    } else {
+        ESP_LOGW(TAG, "Flow meter unavailable, leak detection disabled");
+    }
+    
+    if (button_init(control_queue) != ESP_OK) {
+        ESP_LOGW(TAG, "Manual button unavailable");
+    } else {
+        esp_err_t err = button_enable_deep_sleep_wakeup();
+        button_wakes_deep = (err == ESP_OK);
+        if (!button_wakes_deep) {
+            ESP_LOGE(TAG, "Button cannot wake deep sleep (%s), staying in light sleep", esp_err_to_name(err));
+        }
+    }
+    
+    if (display_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Display unavailable");
+    }
+    
     // Create irrigation task
     xTaskCreate(irrigation_task, "irrigation_task", STACK_SIZE, NULL, PRIORITY, NULL);
     
@@ -102,26 +296,1019 @@ static void irrigation_task(void* pvParameters)
 {
     ESP_LOGI(TAG, "Irrigation task started");
     
-    // Start the first watering cycle immediately
-    start_watering();
-    
-    // Start the check timer
-    xTimerStart(check_timer, 0);
+    recover_cycles(hal_time_us());
     
-    // Task main loop - just keep the task alive
+    // Each wakeup pops whatever is due from the plan and sleeps until the next entry
+    run_due_events();
+    check_sensors();
+    refresh_display();
+    send_report();
+    sleep_while_empty();
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(1000)); // Sleep for 1 second
+        control_event_t ev;
+        xQueueReceive(control_queue, &ev, portMAX_DELAY);
+        
+        switch (ev.type) {
+        case CONTROL_EVENT_PLAN:
+            run_due_events();
+            break;
+        case CONTROL_EVENT_FLOW_SAMPLE:
+            check_flow();
+            break;
+        case CONTROL_EVENT_FROST_CHECK:
+            check_frost();
+            break;
+        case CONTROL_EVENT_BUTTON:
+            handle_button(ev.arg);
+            break;
+        case CONTROL_EVENT_TANK_CHECK:
+            check_tank();
+            break;
+        case CONTROL_EVENT_TANK_LOW:
+            tank_at_reserve();
+            break;
+        case CONTROL_EVENT_SENSE:
+            check_sensors();
+            break;
+        case CONTROL_EVENT_IDLE_FLOW:
+            idle_flow_alarm();
+            break;
+        default:
+            ESP_LOGW(TAG, "Unknown control event %d", ev.type);
+            break;
+        }
         
-        // Log system status every hour
-        static uint32_t hour_counter = 0;
-        hour_counter++;
-        if (hour_counter >= 3600) { // 3600 seconds = 1 hour
-            hour_counter = 0;
-            uint32_t hours_until_next = (WATERING_INTERVAL_MS - seconds_since_last_watering * 1000) / (60 * 60 * 1000);
-            ESP_LOGI(TAG, "System running - Next watering in %d hours", 
-                     is_watering ? WATERING_DURATION_MIN : hours_until_next);
+        // Cycle boundaries reach flash once per event, the checkpoints in between stay in RTC memory
+        if (journal_dirty && journal_store_save(&journal) == ESP_OK) {
+            journal_dirty = false;
+        }
+        refresh_display();
+        send_report();
+        sleep_through_pulse();
+        sleep_while_empty();
+    }
+}
+
+// While a pulse runs, nothing needs the CPU until the next timer: latch the pump and
+// light outputs and light sleep until then. PCNT stops with the APB clock, so on its own
+// this never happens inside a flow sample window. Where the ULP takes over the count it
+// can, and the ULP also ends a pulse on volume or wakes the CPU early if flow stalls.
+// The button still wakes the chip.
+static void sleep_through_pulse(void)
+{
+    int64_t now_us = hal_time_us();
+    int64_t wake_us = timer_service_next_us();
+    bool counting = false;
+    uint32_t pulses;
+    
+    if (PUMP_SLEEP_CHECK_S == 0 || !is_watering
+        || uxQueueMessagesWaiting(control_queue) > 0 || wake_us - now_us < PUMP_SLEEP_MIN_MS * 1000LL) {
+        return;
+    }
+    int64_t slept_from_us = now_us;
+    if (flow_ulp_ready) {
+        flow_meter_suspend();
+        counting = (flow_ulp_start(pulse_volume_target(now_us), pulse_burst_target()) == ESP_OK);
+        if (!counting) {
+            flow_meter_resume(0);
+        }
+    }
+    if (flow_window_open && !counting) {
+        return;
+    }
+    hal_output_hold(MOTOR_DRIVER_PIN, true);
+    hal_output_hold(LIGHT_PIN, true);
+    hal_sleep_light_until(wake_us);
+    hal_output_hold(MOTOR_DRIVER_PIN, false);
+    hal_output_hold(LIGHT_PIN, false);
+    pump_slept_us += hal_time_us() - now_us;
+    pump_wakeups++;
+    if (!counting) {
+        return;
+    }
+    
+    flow_ulp_status_t status = flow_ulp_stop(&pulses);
+    flow_meter_resume(pulses);
+    now_us = hal_time_us();
+    if (status == FLOW_ULP_TARGET) {
+        pulse_target_reached(pulses, now_us - slept_from_us, now_us);
+    } else if (status == FLOW_ULP_BURST) {
+        // Measure afresh rather than average the burst into the whole sleep
+        ESP_LOGW(TAG, "Flow burst in sleep on zones 0x%" PRIx32, running_zones);
+        flow_last_pulses = flow_meter_pulses();
+        flow_last_us = now_us;
+        flow_alert_samples = PUMP_ALERT_SAMPLES;
+        timer_service_start(&flow_timer, now_us + FLOW_SAMPLE_MS * 1000,
+                            (control_event_t){ .type = CONTROL_EVENT_FLOW_SAMPLE });
+    } else if (status == FLOW_ULP_STALLED) {
+        // The leak detector decides what the stall means, on fresh samples
+        ESP_LOGW(TAG, "No flow pulses for %d ms on zones 0x%" PRIx32, FLOW_ULP_STALL_MS, running_zones);
+        timer_service_start(&flow_timer, now_us, (control_event_t){ .type = CONTROL_EVENT_FLOW_SAMPLE });
+    }
+}
+
+// Pulses the running zone still owes until its scheduled stop at PUMP_FLOW_ML_PER_MIN,
+// the rate its run time was worked out from. Only for a single zone whose stop is the
+// next plan event; 0 leaves the stop to the clock.
+static uint32_t pulse_volume_target(int64_t now_us)
+{
+    const plan_event_t *next = planner_peek(&plan);
+    
+    if (next == NULL || next->type != PLAN_EVENT_STOP || running_zones != (1U << next->zone)
+        || next->at_us <= now_us) {
+        return 0;
+    }
+    uint32_t ml = (uint32_t)((next->at_us - now_us) * PUMP_FLOW_ML_PER_MIN / (60 * 1000000LL));
+    return ml * FLOW_PULSES_PER_L / 1000;
+}
+
+// The ULP counted the zone's volume before its stop. Those pulses are one flow sample
+// for the leak detector, and a volume that arrived well ahead of the zone's learned flow
+// went somewhere other than through its emitters: the zone is locked out rather than
+// counted as watered.
+static void pulse_target_reached(uint32_t pulses, int64_t counted_us, int64_t now_us)
+{
+    int zone = __builtin_ctz(running_zones);
+    uint32_t ml = flow_meter_pulses_to_ml(pulses);
+    uint32_t expected = leak_detect_expected(&leak_detector);
+    
+    journal_checkpoint(&journal, running_zones, now_us);
+    uint32_t flow = (counted_us > 0) ? (uint32_t)((int64_t)ml * 60 * 1000000 / counted_us) : 0;
+    leak_status_t status = leak_detect_sample(&leak_detector, flow);
+    flow_samples++;
+    flow_last_pulses = flow_meter_pulses();
+    flow_last_us = now_us;
+    
+    int64_t expected_us = expected ? (int64_t)ml * 60 * 1000000 / expected : 0;
+    if (status == LEAK_BURST || counted_us * 100 < expected_us * PUMP_EARLY_TARGET_PCT) {
+        ESP_LOGE(TAG, "Zone %d: %" PRIu32 " ml in %lld s, expected %lld s at %" PRIu32 " ml/min - stopping", zone, ml,
+                 counted_us / 1000000, expected_us / 1000000, expected);
+        abort_zones(running_zones, true, now_us);
+        return;
+    }
+    ESP_LOGI(TAG, "Zone %d delivered its volume ahead of its stop", zone);
+    planner_trim_cycle(&plan, zone, now_us);
+    timer_service_start(&plan_timer, now_us, (control_event_t){ .type = CONTROL_EVENT_PLAN });
+}
+
+// Pulses in one FLOW_ULP_WINDOW_MS window that are PUMP_BURST_WAKE_PCT of the flow the
+// leak detector expects, 0 while it is still learning and could not call a burst anyway
+static uint32_t pulse_burst_target(void)
+{
+    uint64_t expected = leak_detect_expected(&leak_detector);
+    uint64_t scale = 100ULL * 1000 * 60 * 1000;
+    
+    return (uint32_t)((expected * PUMP_BURST_WAKE_PCT * FLOW_PULSES_PER_L * FLOW_ULP_WINDOW_MS + scale - 1) / scale);
+}
+
+// An empty tank has nothing to pump, so instead of waking for cycles that could only
+// be skipped the node deep sleeps until a refill covers the upper electrode, the button
+// is pressed or the heartbeat report is due. The plan is kept in RTC memory and the
+// cycles missed meanwhile are dropped when it is popped after the wakeup. Without the
+// button or refill wakeup a press or refill could go unanswered for hours, so the node
+// then stays in light sleep.
+static void sleep_while_empty(void)
+{
+    if (!tank_touch_ready || !button_wakes_deep || is_watering
+        || uxQueueMessagesWaiting(control_queue) > 0 || !tank_touch_low() || !tank_touch_wake_armed()) {
+        return;
+    }
+    ESP_LOGW(TAG, "Tank below the electrode band, deep sleep until it is refilled");
+    hal_sleep_deep_until(hal_time_us() + REPORT_HEARTBEAT_S * 1000000LL);
+}
+
+static void refresh_display(void)
+{
+    display_status_t status = {
+        .last_us = last_watered_us,
+        .next_us = planner_next_start_us(&plan),
+        .battery_pct = battery_pct,
+        .watering = is_watering,
+        .locked_zones = leak_zones,
+        .idle_flow = idle_flow_seen,
+    };
+    
+    display_update(&status, hal_time_us());
+}
+
+// After any reset but a deep sleep wakeup, finish the cycles the reset cut short from
+// where the journal left off, rather than repeating or dropping them
+static void recover_cycles(int64_t now_us)
+{
+    if (hal_reset_reason() == HAL_RESET_DEEP_SLEEP && journal_valid(&journal)) {
+        return;
+    }
+    // RTC memory is lost with power, the flash copy is then as of the last boundary
+    if (!journal_valid(&journal) && journal_store_load(&journal) != ESP_OK) {
+        journal_reset(&journal);
+        return;
+    }
+    
+    uint32_t resume = 0;
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        uint32_t remaining = journal_remaining_s(&journal, z);
+        if (remaining >= RESUME_MIN_S && !(leak_zones & (1U << z))) {
+            resume |= 1U << z;
+        } else if (remaining) {
+            journal_done(&journal, z);
+        }
+    }
+    journal_dirty = true;
+    if (resume == 0) {
+        return;
+    }
+    
+    planner_build(&plan, zone_rules, ZONE_COUNT, now_us);
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        if (!(resume & (1U << z))) {
+            continue;
+        }
+        // Regular cycles carry on one interval after the interrupted one began
+        int64_t began_us = now_us - (int64_t)journal_delivered_s(&journal, z) * 1000000;
+        planner_set_anchor(&plan, z, began_us - (int64_t)zone_rules[z].offset_s * 1000000);
+        planner_replan_zone(&plan, zone_rules, z, now_us);
+    }
+    apply_forecast(now_us, ~0U);
+    
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        if (!(resume & (1U << z))) {
+            continue;
         }
+        uint32_t remaining = journal_remaining_s(&journal, z);
+        plan_event_t rest[2] = {
+            { now_us, z, PLAN_EVENT_PULSE },
+            { now_us + (int64_t)remaining * 1000000, z, PLAN_EVENT_STOP },
+        };
+        if (planner_replace_cycles(&plan, 1U << z, rest, 2)) {
+            ESP_LOGW(TAG, "Zone %d: resuming cycle %d after a reset, %" PRIu32 " of %" PRIu32 " s left", z,
+                     journal.zone[z].cycle, remaining, journal.zone[z].planned_s);
+        } else {
+            journal_done(&journal, z);
+        }
+    }
+}
+
+typedef struct {
+    const forecast_t *forecast;
+    int64_t           wall_offset_s;  // Wall clock seconds minus plan time seconds
+    uint32_t          zones;          // Zones whose cycles are not scaled yet
+} forecast_ctx_t;
+
+static uint8_t forecast_scale(const plan_event_t *start, void *arg)
+{
+    const forecast_ctx_t *ctx = arg;
+    if (!(ctx->zones & (1U << start->zone))) {
+        return 100;
+    }
+    int64_t at_s = start->at_us / 1000000 + ctx->wall_offset_s;
+    uint8_t keep = forecast_keep_pct(ctx->forecast, &forecast_policy, (uint32_t)at_s);
+    
+    if (keep < 100) {
+        ESP_LOGI(TAG, "Zone %d cycle in %lld minutes: %s by forecast", start->zone,
+                 (start->at_us - hal_time_us()) / (60 * 1000000LL), keep ? "shortened" : "skipped");
     }
+    return keep;
+}
+
+// Scale the freshly compiled cycles of the given zones by the stored forecast. Runs
+// once per planning pass or replan, so wakeups in between never touch flash or the
+// forecast. Other zones were scaled already and must not be scaled twice.
+static void apply_forecast(int64_t now_us, uint32_t zones)
+{
+    static forecast_t forecast;
+    struct timeval wall;
+    
+    gettimeofday(&wall, NULL);
+    if (wall.tv_sec < FORECAST_CLOCK_VALID_S || forecast_store_load(&forecast) != ESP_OK) {
+        return;
+    }
+    forecast_ctx_t ctx = { .forecast = &forecast, .wall_offset_s = wall.tv_sec - now_us / 1000000, .zones = zones };
+    planner_scale_cycles(&plan, plan.epoch_us, forecast_scale, &ctx);
+}
+
+static uint8_t skip_next_cycle(const plan_event_t *start, void *arg)
+{
+    uint32_t *skipped = arg;
+    uint32_t bit = 1U << start->zone;
+    
+    if (*skipped & bit) {
+        return 100;
+    }
+    *skipped |= bit;
+    skipped_at_us[start->zone] = start->at_us;
+    return 0;
+}
+
+// Manual override from the field. A short press starts every zone for its planned
+// duration, or stops whatever is running. A long press skips the next planned cycle.
+// Holding it for 10 s takes the tank electrodes as dry.
+static void handle_button(button_press_t press)
+{
+    int64_t now_us = hal_time_us();
+    
+    if (press == BUTTON_HOLD) {
+        if (!tank_touch_ready || tank_touch_calibrate_dry() != ESP_OK) {
+            ESP_LOGW(TAG, "Tank electrodes not calibrated");
+        }
+    } else if (press == BUTTON_LONG) {
+        uint32_t skipped = 0;
+        planner_scale_cycles(&plan, now_us, skip_next_cycle, &skipped);
+        ESP_LOGI(TAG, "Manual skip of the next cycle on zones 0x%" PRIx32, skipped);
+    } else if (running_zones) {
+        ESP_LOGI(TAG, "Manual stop of zones 0x%" PRIx32, running_zones);
+        abort_zones(running_zones, false, now_us);
+    } else {
+        // Pulses start zones without a budget solve: the operator asked for water
+        plan_event_t manual[2 * ZONE_COUNT];
+        uint32_t mask = 0;
+        int n = 0;
+        for (int z = 0; z < ZONE_COUNT; z++) {
+            if (!(leak_zones & (1U << z))) {
+                manual[n++] = (plan_event_t){ now_us, z, PLAN_EVENT_PULSE };
+                manual[n++] = (plan_event_t){ now_us + (int64_t)zone_rules[z].duration_s * 1000000, z, PLAN_EVENT_STOP };
+                mask |= 1U << z;
+            }
+        }
+        if (n == 0 || !planner_replace_cycles(&plan, mask, manual, n)) {
+            ESP_LOGW(TAG, "Manual start refused");
+            return;
+        }
+        for (int z = 0; z < ZONE_COUNT; z++) {
+            if (mask & (1U << z)) {
+                journal_intent(&journal, z, zone_rules[z].duration_s);
+            }
+        }
+        ESP_LOGI(TAG, "Manual start of zones 0x%" PRIx32, mask);
+    }
+    run_due_events();
+}
+
+static void run_due_events(void)
+{
+    int64_t now_us = hal_time_us();
+    
+    // Rules are compiled once per planning window instead of on every wakeup
+    if (planner_needs_build(&plan, now_us)) {
+        int64_t t0 = hal_time_us();
+        planner_build(&plan, zone_rules, ZONE_COUNT, now_us);
+        ESP_LOGI(TAG, "Compiled plan: %d events in %lld us", plan.count, hal_time_us() - t0);
+        apply_forecast(now_us, ~0U);
+    }
+    
+    // Zones starting together share one sensor epoch and one budget solve. Starting
+    // them can add events that are due right away, so drain again until nothing starts.
+    uint32_t starting;
+    do {
+        starting = 0;
+        plan_event_t ev;
+        while (planner_pop_due(&plan, now_us, &ev)) {
+            switch (ev.type) {
+            case PLAN_EVENT_START:
+                starting |= 1U << ev.zone;
+                break;
+            case PLAN_EVENT_PULSE:
+                start_zone(ev.zone);
+                break;
+            default:
+                // A cycle missed whole, in deep sleep say, never opened its zone
+                if (starting & (1U << ev.zone)) {
+                    starting &= ~(1U << ev.zone);
+                } else {
+                    stop_zone(ev.zone);
+                }
+                break;
+            }
+        }
+        if (starting) {
+            start_zones(starting, now_us);
+        }
+    } while (starting);
+    
+    // The pump only changes state once per batch, so a pulse handing over to the
+    // next zone keeps it running
+    update_pump();
+    watch_flow(now_us);
+    
+    int64_t next_us = planner_next_wake_us(&plan);
+    ESP_LOGI(TAG, "Next event in %lld minutes", (next_us - now_us) / (60 * 1000000LL));
+    timer_service_start(&plan_timer, next_us, (control_event_t){ .type = CONTROL_EVENT_PLAN });
+}
+
+static void start_zones(uint32_t mask, int64_t now_us)
+{
+    sensor_epoch_t epoch;
+    budget_zone_t demand[ZONE_COUNT];
+    uint32_t alloc_ml[ZONE_COUNT];
+    uint32_t planned_s[ZONE_COUNT] = { 0 };
+    
+    // Zones that raised a flow alarm stay off until someone has looked at them
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        if (mask & leak_zones & (1U << z)) {
+            ESP_LOGW(TAG, "Zone %d locked out after a flow alarm, skipping cycle", z);
+            skip_cycle(z);
+        }
+    }
+    mask &= ~leak_zones;
+    if (mask == 0) {
+        return;
+    }
+    
+    // The cycle as planned, with forecast scaling and a late start already applied to its stop
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        if (mask & (1U << z)) {
+            int64_t stop_us = planner_next_stop_us(&plan, z);
+            planned_s[z] = (stop_us > now_us && stop_us != INT64_MAX) ? (uint32_t)((stop_us - now_us) / 1000000) : 0;
+        }
+    }
+    
+    // Without readings fall back to the fixed schedule
+    if (sensors_sample(&epoch) != ESP_OK) {
+        for (int z = 0; z < ZONE_COUNT; z++) {
+            if (mask & (1U << z)) {
+                journal_intent(&journal, z, planned_s[z]);
+                start_zone(z);
+            }
+        }
+        return;
+    }
+    use_epoch(&epoch);
+    
+    // Temperature comes from the same epoch, so the frost gate costs no extra wakeup
+    if (epoch.temp_dc != TEMP_INVALID_DC) {
+        mask = frost_gate(mask, planned_s, epoch.temp_dc, now_us);
+        frost_watch(epoch.temp_dc, mask != 0, now_us);
+        if (mask == 0) {
+            return;
+        }
+    }
+    mask = supply_gate(mask, planned_s, now_us);
+    if (mask == 0) {
+        return;
+    }
+    
+    uint32_t available_ml = (epoch.tank_ml > TANK_RESERVE_ML) ? epoch.tank_ml - TANK_RESERVE_ML : 0;
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        uint32_t full_ml = planned_s[z] * PUMP_FLOW_ML_PER_MIN / 60;
+        demand[z] = (budget_zone_t){
+            .demand_ml = (mask & (1U << z)) ? water_budget_demand_ml(epoch.moisture_pct[z], zone_water[z].target_pct,
+                                                                     zone_water[z].dry_pct, full_ml) : 0,
+            .min_ml = zone_water[z].min_ml,
+            .priority = zone_water[z].priority,
+        };
+    }
+    water_budget_solve(demand, ZONE_COUNT, available_ml, alloc_ml, &budget_ws);
+    
+    soak_zone_t soak[ZONE_COUNT] = { 0 };
+    uint32_t soak_mask = 0;
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        if (!(mask & (1U << z))) {
+            continue;
+        }
+        uint32_t run_s = alloc_ml[z] * 60 / PUMP_FLOW_ML_PER_MIN;
+        ESP_LOGI(TAG, "Zone %d: moisture %d%%, demand %" PRIu32 " ml, allocated %" PRIu32 " ml of %" PRIu32 " ml available", z,
+                 epoch.moisture_pct[z], demand[z].demand_ml, alloc_ml[z], available_ml);
+        if (run_s == 0) {
+            skip_cycle(z);
+            continue;
+        }
+        journal_intent(&journal, z, run_s);
+        if (zone_water[z].pulse_s && run_s > zone_water[z].pulse_s) {
+            soak[z] = (soak_zone_t){ .run_s = run_s, .pulse_s = zone_water[z].pulse_s, .soak_s = zone_water[z].soak_s };
+            soak_mask |= 1U << z;
+            continue;
+        }
+        if (run_s < planned_s[z]) {
+            planner_trim_cycle(&plan, z, now_us + (int64_t)run_s * 1000000);
+        }
+        start_zone(z);
+    }
+    if (soak_mask) {
+        start_soak(soak_mask, soak, now_us);
+    }
+}
+
+// Replace the zones' single block with interleaved pulses. Every pulse boundary is a
+// plan event, so the controller wakes only when a valve has to change.
+static void start_soak(uint32_t mask, const soak_zone_t *soak, int64_t now_us)
+{
+    static soak_pulse_t pulses[SOAK_MAX_PULSES];
+    static plan_event_t events[2 * SOAK_MAX_PULSES];
+    int n = cycle_soak_plan(soak, ZONE_COUNT, pulses, SOAK_MAX_PULSES);
+    
+    for (int p = 0; p < n; p++) {
+        int64_t start_us = now_us + (int64_t)pulses[p].start_s * 1000000;
+        events[2 * p] = (plan_event_t){ start_us, pulses[p].zone, PLAN_EVENT_PULSE };
+        events[2 * p + 1] = (plan_event_t){ start_us + (int64_t)pulses[p].length_s * 1000000,
+                                            pulses[p].zone, PLAN_EVENT_STOP };
+    }
+    if (n > 0 && planner_replace_cycles(&plan, mask, events, 2 * n)) {
+        ESP_LOGI(TAG, "Pulse-and-soak: %d pulses over %" PRIu32 " minutes", n,
+                 (pulses[n - 1].start_s + pulses[n - 1].length_s) / 60);
+        return;
+    }
+    
+    // No room in the plan, water the zones in one block instead
+    ESP_LOGW(TAG, "Pulse-and-soak plan does not fit, watering continuously");
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        if (mask & (1U << z)) {
+            planner_trim_cycle(&plan, z, now_us + (int64_t)soak[z].run_s * 1000000);
+            start_zone(z);
+        }
+    }
+}
+
+static void start_zone(int zone)
+{
+    running_zones |= 1U << zone;
+    journal_pulse_start(&journal, zone, hal_time_us());
+    journal_dirty = true;
+}
+
+static void stop_zone(int zone)
+{
+    running_zones &= ~(1U << zone);
+    journal_pulse_stop(&journal, zone, hal_time_us());
+    moisture_track_disturb(&moisture_track[zone]);
+    if (!planner_cycle_continues(&plan, zone)) {
+        journal_done(&journal, zone);
+    }
+    journal_dirty = true;
+}
+
+static void update_pump(void)
+{
+    if (running_zones && !is_watering) {
+        start_watering();
+    } else if (!running_zones && is_watering) {
+        stop_watering();
+        last_watered_us = hal_time_us();
+        ESP_LOGI(TAG, "Watering cycle completed");
+    }
+}
+
+// Hold cycles while it is too cold, re-trying after a while and giving up if the
+// cold lasts. Returns the zones that may start now.
+static uint32_t frost_gate(uint32_t mask, const uint32_t *planned_s, int16_t temp_dc, int64_t now_us)
+{
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        uint32_t bit = 1U << z;
+        if (!(mask & bit)) {
+            continue;
+        }
+        frost_action_t action = frost_check_start(&frost_config, &frost_state, z, temp_dc, now_us);
+        if (action == FROST_WATER) {
+            continue;
+        }
+        mask &= ~bit;
+        
+        if (action == FROST_POSTPONE && postpone_cycle(z, frost_config.retry_s, planned_s[z], now_us)) {
+            ESP_LOGW(TAG, "Zone %d: %.1f C, cycle postponed %" PRIu32 " minutes", z,
+                     temp_dc / 10.0f, frost_config.retry_s / 60);
+        } else {
+            ESP_LOGW(TAG, "Zone %d: %.1f C for too long, cycle skipped", z, temp_dc / 10.0f);
+            skip_cycle(z);
+        }
+    }
+    return mask;
+}
+
+// Re-plan the rest of a zone's cycle, run_s of it, as a fresh start delay_s from now
+static bool postpone_cycle(int zone, uint32_t delay_s, uint32_t run_s, int64_t now_us)
+{
+    int64_t retry_us = now_us + (int64_t)delay_s * 1000000;
+    plan_event_t retry[2] = {
+        { retry_us, zone, PLAN_EVENT_START },
+        { retry_us + (int64_t)run_s * 1000000, zone, PLAN_EVENT_STOP },
+    };
+    
+    return planner_replace_cycles(&plan, 1U << zone, retry, 2);
+}
+
+// Drop the rest of a cycle whose valve never opened. Trimming its stop to now would
+// still run stop_zone for it, as if the zone had been watered.
+static void skip_cycle(int zone)
+{
+    planner_replace_cycles(&plan, 1U << zone, NULL, 0);
+}
+
+// One pressure burst just before the pump would start. With low supply pressure the
+// zones are held and retried rather than pumping against a dry line.
+static uint32_t supply_gate(uint32_t mask, const uint32_t *planned_s, int64_t now_us)
+{
+    uint16_t kpa;
+    
+    // Already pumping, or no reading: pressure has nothing to add
+    if (is_watering || sensors_pressure_burst(&kpa) != ESP_OK) {
+        return mask;
+    }
+    if (pressure_check_start(&pressure_config, kpa) == PRESSURE_OK) {
+        supply_waiting = false;
+        return mask;
+    }
+    if (!supply_waiting) {
+        supply_waiting = true;
+        supply_wait_since_us = now_us;
+    }
+    
+    bool give_up = now_us - supply_wait_since_us + SUPPLY_RETRY_S * 1000000LL > SUPPLY_MAX_WAIT_S * 1000000LL;
+    ESP_LOGW(TAG, "Supply pressure %d kPa too low, %s", kpa, give_up ? "skipping cycle" : "waiting");
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        if ((mask & (1U << z)) && (give_up || !postpone_cycle(z, SUPPLY_RETRY_S, planned_s[z], now_us))) {
+            skip_cycle(z);
+        }
+    }
+    if (give_up) {
+        supply_waiting = false;
+    }
+    return 0;
+}
+
+// While it is freezing, circulate idle lines briefly and keep re-checking the
+// temperature. Outside frost conditions this schedules nothing.
+static void frost_watch(int16_t temp_dc, bool pumping, int64_t now_us)
+{
+    if (!frost_protecting(&frost_config, temp_dc)) {
+        timer_service_cancel(&frost_timer);
+        return;
+    }
+    if (!pumping && !is_watering) {
+        plan_event_t run[2] = {
+            { now_us, FROST_CIRCULATION_ZONE, PLAN_EVENT_PULSE },
+            { now_us + (int64_t)frost_config.circulate_s * 1000000, FROST_CIRCULATION_ZONE, PLAN_EVENT_STOP },
+        };
+        if (planner_replace_cycles(&plan, 1U << FROST_CIRCULATION_ZONE, run, 2)) {
+            ESP_LOGI(TAG, "%.1f C, circulating zone %d for %" PRIu32 " s", temp_dc / 10.0f,
+                     FROST_CIRCULATION_ZONE, frost_config.circulate_s);
+        }
+    }
+    timer_service_start(&frost_timer, now_us + (int64_t)frost_config.check_s * 1000000,
+                        (control_event_t){ .type = CONTROL_EVENT_FROST_CHECK });
+}
+
+static void check_frost(void)
+{
+    sensor_epoch_t epoch;
+    
+    if (sensors_sample(&epoch) != ESP_OK || epoch.temp_dc == TEMP_INVALID_DC) {
+        return;
+    }
+    use_epoch(&epoch);
+    frost_watch(epoch.temp_dc, false, epoch.at_us);
+    run_due_events();
+}
+
+// Sample the probes only as often as the soil is changing: every few minutes after
+// watering or rain, hours apart while it dries slowly. A zone whose estimate reaches
+// dry before its next cycle has that cycle brought forward, once per interval, unless
+// it is soaking between pulses or the operator skipped its next cycle. The new cycles
+// are scaled by the forecast like the rest of the window.
+static void check_sensors(void)
+{
+    sensor_epoch_t epoch;
+    int64_t now_us = hal_time_us();
+    uint32_t next_s = TRACK_MAX_S;
+    
+    // The pump and valves skew the probes, the sample after the cycle sees the result
+    if (is_watering) {
+        timer_service_start(&sense_timer, now_us + TRACK_MIN_S * 1000000LL,
+                            (control_event_t){ .type = CONTROL_EVENT_SENSE });
+        return;
+    }
+    if (sensors_sample(&epoch) == ESP_OK) {
+        use_epoch(&epoch);
+        
+        uint32_t early = 0;
+        for (int z = 0; z < ZONE_COUNT; z++) {
+            const moisture_track_t *t = &moisture_track[z];
+            int64_t interval_us = (int64_t)zone_rules[z].interval_s * 1000000;
+            if (!t->valid || t->pct > zone_water[z].dry_pct || !zone_rules[z].enabled
+                || ((leak_zones | running_zones) & (1U << z)) || planner_cycle_continues(&plan, z)
+                || skipped_at_us[z] > now_us
+                || (early_at_us[z] != 0 && now_us - early_at_us[z] < interval_us)) {
+                continue;
+            }
+            ESP_LOGI(TAG, "Zone %d: %.1f%% and drying %.2f%%/h, bringing the cycle forward", z, t->pct, -t->rate);
+            early_at_us[z] = now_us;
+            planner_set_anchor(&plan, z, now_us - (int64_t)zone_rules[z].offset_s * 1000000);
+            planner_replan_zone(&plan, zone_rules, z, now_us);
+            early |= 1U << z;
+        }
+        if (early) {
+            apply_forecast(now_us, early);
+            run_due_events();
+        }
+        
+        for (int z = 0; z < ZONE_COUNT; z++) {
+            uint32_t s = moisture_track_next_s(&moisture_track[z], zone_water[z].dry_pct);
+            next_s = (s < next_s) ? s : next_s;
+        }
+    }
+    timer_service_start(&sense_timer, now_us + (int64_t)next_s * 1000000,
+                        (control_event_t){ .type = CONTROL_EVENT_SENSE });
+}
+
+// Every sensor epoch, whatever woke the node for it, feeds the moisture trackers and telemetry
+static void use_epoch(const sensor_epoch_t *epoch)
+{
+    battery_pct = epoch->battery_pct;
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        moisture_track_update(&moisture_track[z], epoch->moisture_pct[z], epoch->at_us);
+    }
+    report_epoch(epoch);
+}
+
+// Send-on-delta: a frame goes out only when some metric moved past its deadband or is
+// due a heartbeat, and then carries every metric that is half way there as well. A
+// newer epoch replaces a frame still waiting to go out.
+static void report_epoch(const sensor_epoch_t *epoch)
+{
+    int32_t value[REPORT_METRICS];
+    telemetry_verdict_t verdict[REPORT_METRICS];
+    bool send = false;
+    
+    report_count = 0;
+    value[TELEMETRY_TANK_DL] = (int32_t)(epoch->tank_ml / 100);
+    value[TELEMETRY_TEMP_DC] = epoch->temp_dc;
+    value[TELEMETRY_BATTERY_PCT] = epoch->battery_pct;
+    value[TELEMETRY_FLOW_ALARM] = (leak_zones ? 1 : 0) | (idle_flow_seen ? 2 : 0);
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        value[TELEMETRY_MOISTURE_PCT + z] = epoch->moisture_pct[z];
+    }
+    for (int m = 0; m < REPORT_METRICS; m++) {
+        verdict[m] = telemetry_check(&reported[m], &report_policy[m], value[m], epoch->at_us);
+        if (m == TELEMETRY_TEMP_DC && epoch->temp_dc == TEMP_INVALID_DC) {
+            verdict[m] = TELEMETRY_QUIET;
+        }
+        send |= (verdict[m] == TELEMETRY_SEND);
+    }
+    if (!send) {
+        return;
+    }
+    
+    for (int m = 0; m < REPORT_METRICS; m++) {
+        if (verdict[m] != TELEMETRY_QUIET) {
+            report[report_count++] = (telemetry_record_t){ .at_s = (uint32_t)(epoch->at_us / 1000000),
+                                                           .value = (int16_t)value[m], .metric = m };
+        }
+    }
+}
+
+// Uploads block for up to a scan and DHCP, so they wait until the pump is off. Over
+// Wi-Fi when configured, otherwise as "telemetry <hex>" lines on the console UART. A
+// frame the gateway does not acknowledge goes to flash and follows with a later upload.
+static void send_report(void)
+{
+    static uint8_t batch[LINK_MAX_PAYLOAD];
+    uint8_t frame[TELEMETRY_MAX_BYTES];
+    int64_t now_us = hal_time_us();
+    
+    if (report_count == 0 || is_watering) {
+        return;
+    }
+    size_t len = telemetry_encode(report, report_count, (uint32_t)(now_us / 1000000), frame, sizeof(frame));
+    if (len == 0) {
+        report_count = 0;
+        return;
+    }
+    if (link_ready) {
+        // Compressing takes CPU time, so it happens before the radio goes on
+        int stored = 0;
+        size_t batch_len = prepare_backlog(batch, sizeof(batch), &stored);
+        
+        esp_err_t err = telemetry_link_open();
+        if (err == ESP_OK) {
+            err = telemetry_link_put(frame, len);
+            if (err == ESP_OK && stored > 0 && telemetry_link_put(batch, batch_len) == ESP_OK) {
+                telemetry_store_drop(stored);
+                ESP_LOGI(TAG, "Caught up on %d stored frames in %u bytes", stored, (unsigned)batch_len);
+            }
+            telemetry_link_close();
+        }
+        if (err != ESP_OK && telemetry_store_push(frame, len) != ESP_OK) {
+            // Not even stored, so the next epoch puts these metrics in its frame again
+            report_count = 0;
+            return;
+        }
+    } else {
+        printf(TELEMETRY_CONSOLE_PREFIX);
+        for (size_t i = 0; i < len; i++) {
+            printf("%02x", frame[i]);
+        }
+        printf("\n");
+    }
+    
+    // Only what the receiver got or will get from the store counts as reported
+    for (int i = 0; i < report_count; i++) {
+        telemetry_mark_sent(&reported[report[i].metric], report[i].value, (int64_t)report[i].at_s * 1000000);
+    }
+    report_count = 0;
+}
+
+// As many stored frames, oldest first, as compress into one datagram. They stream from
+// flash into the encoder one at a time.
+static size_t prepare_backlog(uint8_t *datagram, size_t size, int *frames)
+{
+    static telemetry_batch_t batch;                // Encoder state, kept off the task stack
+    uint8_t frame[TELEMETRY_MAX_BYTES];
+    int count = telemetry_store_count();
+    int n = 0;
+    
+    if (count == 0) {
+        *frames = 0;
+        return 0;
+    }
+    telemetry_batch_start(&batch, datagram, size);
+    for (; n < count; n++) {
+        size_t len = sizeof(frame);
+        if (telemetry_store_read(n, frame, &len) != ESP_OK || !telemetry_batch_add(&batch, frame, len)) {
+            break;
+        }
+    }
+    if (n == 0) {
+        // Unreadable, skip it rather than stall the whole store behind it
+        telemetry_store_drop(1);
+    }
+    *frames = n;
+    return telemetry_batch_finish(&batch, (uint32_t)(hal_time_us() / 1000000));
+}
+
+// Follow the open zones with the leak detector while pumping, and hand over to the
+// PCNT idle watch point once the pump is off
+static void watch_flow(int64_t now_us)
+{
+    if (!is_watering) {
+        if (watched_zones) {
+            watched_zones = 0;
+            timer_service_cancel(&flow_timer);
+            flow_meter_set_idle(true);
+        }
+        return;
+    }
+    if (running_zones == watched_zones) {
+        return;
+    }
+    if (watched_zones == 0) {
+        flow_meter_set_idle(false);
+    }
+    watched_zones = running_zones;
+    flow_samples = 0;
+    flow_alert_samples = 0;
+    leak_detect_begin(&leak_detector, &leak_baseline, watched_zones);
+    uint32_t unlearned = leak_detect_unlearned(&leak_baseline) & watched_zones;
+    if (unlearned) {
+        ESP_LOGW(TAG, "Zones 0x%" PRIx32 " never run alone: no flow baseline, leaks go unchecked", unlearned);
+    }
+    flow_last_pulses = flow_meter_pulses();
+    flow_last_us = now_us;
+    flow_window_open = true;
+    timer_service_start(&flow_timer, now_us + FLOW_SAMPLE_MS * 1000,
+                        (control_event_t){ .type = CONTROL_EVENT_FLOW_SAMPLE });
+}
+
+static void check_flow(void)
+{
+    int64_t now_us = hal_time_us();
+    uint32_t pulses = flow_meter_pulses();
+    
+    if (!is_watering || now_us <= flow_last_us) {
+        return;
+    }
+    // First wakeup after sleeping through the pulse: PCNT missed the sleep, so measure
+    // afresh. Pulses the ULP counted through it make a valid sample as they are.
+    if (!flow_window_open && !flow_ulp_ready) {
+        flow_last_pulses = pulses;
+        flow_last_us = now_us;
+        flow_window_open = true;
+        timer_service_start(&flow_timer, now_us + FLOW_SAMPLE_MS * 1000,
+                            (control_event_t){ .type = CONTROL_EVENT_FLOW_SAMPLE });
+        return;
+    }
+    journal_checkpoint(&journal, running_zones, now_us);
+    uint32_t ml = flow_meter_pulses_to_ml(pulses - flow_last_pulses);
+    uint32_t flow = (uint32_t)((int64_t)ml * 60 * 1000000 / (now_us - flow_last_us));
+    flow_last_pulses = pulses;
+    flow_last_us = now_us;
+    
+    leak_status_t status = leak_detect_sample(&leak_detector, flow);
+    uint32_t expected = leak_detect_expected(&leak_detector);
+    flow_samples++;
+    
+    // Pressure bursts are tied to pump events: once the line has settled after a valve
+    // change, and whenever flow drops, to tell a blockage from a failing supply
+    if (flow_samples == LEAK_SETTLE_SAMPLES + 1 || status == LEAK_LOW_FLOW) {
+        uint16_t kpa;
+        if (sensors_pressure_burst(&kpa) == ESP_OK) {
+            pressure_status_t pressure = pressure_check_running(&pressure_config, kpa, flow, expected);
+            if (pressure == PRESSURE_BLOCKED) {
+                ESP_LOGE(TAG, "Blockage on zones 0x%" PRIx32 ": %d kPa at %" PRIu32 " ml/min - stopping",
+                         watched_zones, kpa, flow);
+                abort_zones(watched_zones, true, now_us);
+                return;
+            }
+            if (pressure == PRESSURE_LOW_SUPPLY) {
+                uint32_t zones = watched_zones;
+                uint32_t remaining_s[ZONE_COUNT];
+                ESP_LOGW(TAG, "Supply pressure dropped to %d kPa - pausing zones 0x%" PRIx32, kpa, zones);
+                // Only what the cycles still owe is retried, runs outside a cycle owe nothing
+                journal_checkpoint(&journal, zones, now_us);
+                for (int z = 0; z < ZONE_COUNT; z++) {
+                    remaining_s[z] = journal_remaining_s(&journal, z);
+                }
+                abort_zones(zones, false, now_us);
+                for (int z = 0; z < ZONE_COUNT; z++) {
+                    if ((zones & (1U << z)) && remaining_s[z]) {
+                        postpone_cycle(z, SUPPLY_RETRY_S, remaining_s[z], now_us);
+                    }
+                }
+                timer_service_start(&plan_timer, planner_next_wake_us(&plan),
+                                    (control_event_t){ .type = CONTROL_EVENT_PLAN });
+                return;
+            }
+        }
+    }
+    if (status == LEAK_BURST || status == LEAK_LOW_FLOW) {
+        ESP_LOGE(TAG, "%s on zones 0x%" PRIx32 ": %" PRIu32 " ml/min, expected %" PRIu32 " ml/min - stopping",
+                 status == LEAK_BURST ? "Burst" : "Low flow", watched_zones, flow, expected);
+        abort_zones(watched_zones, true, now_us);
+        return;
+    }
+    // Settled and checked: from here on a short sample every PUMP_SLEEP_CHECK_S is enough
+    // while the ULP wakes the CPU on a burst in between. PCNT stops in light sleep, so
+    // without the ULP nothing watches the flow there and the checks stay close together.
+    if (flow_alert_samples) {
+        flow_alert_samples--;
+    } else if (PUMP_SLEEP_CHECK_S && flow_samples > LEAK_SETTLE_SAMPLES) {
+        int64_t check_s = flow_ulp_ready ? PUMP_SLEEP_CHECK_S : PUMP_BURST_CHECK_S;
+        flow_window_open = false;
+        timer_service_start(&flow_timer, now_us + check_s * 1000000,
+                            (control_event_t){ .type = CONTROL_EVENT_FLOW_SAMPLE });
+        return;
+    }
+    timer_service_start(&flow_timer, now_us + FLOW_SAMPLE_MS * 1000,
+                        (control_event_t){ .type = CONTROL_EVENT_FLOW_SAMPLE });
+}
+
+// Software stand-in for the ADC monitor, one reading every TANK_CHECK_S while pumping
+static void check_tank(void)
+{
+    uint32_t ml;
+    
+    if (!is_watering || !tank_polled) {
+        return;
+    }
+    if (sensors_tank_ml(&ml) == ESP_OK && ml < TANK_RESERVE_ML) {
+        tank_at_reserve();
+        return;
+    }
+    timer_service_start(&tank_timer, hal_time_us() + TANK_CHECK_S * 1000000LL,
+                        (control_event_t){ .type = CONTROL_EVENT_TANK_CHECK });
+}
+
+// The tank is not broken, so the zones are not locked out and water again once refilled
+static void tank_at_reserve(void)
+{
+    if (!is_watering) {
+        return;
+    }
+    ESP_LOGW(TAG, "Tank down to the %d ml reserve - stopping zones 0x%" PRIx32, TANK_RESERVE_ML, running_zones);
+    abort_zones(running_zones, false, hal_time_us());
+}
+
+// Stop zones mid-cycle and drop the rest of their cycle. Locked out zones stay off
+// until the controller is reset.
+static void abort_zones(uint32_t mask, bool lock_out, int64_t now_us)
+{
+    if (lock_out) {
+        leak_zones |= mask;
+    }
+    planner_replace_cycles(&plan, mask, NULL, 0);
+    for (int z = 0; z < ZONE_COUNT; z++) {
+        if (mask & (1U << z)) {
+            stop_zone(z);
+        }
+    }
+    update_pump();
+    watch_flow(now_us);
+}
+
+// Flow with every zone closed is a valve stuck open or a burst line, so no zone opens
+// again until the controller is reset. The alarm stays armed to log the flow going on.
+static void idle_flow_alarm(void)
+{
+    // Posted just before a zone opened, the flow is that zone's
+    if (is_watering) {
+        return;
+    }
+    if (!idle_flow_seen) {
+        ESP_LOGE(TAG, "Flow with every zone closed - check valves and supply line, all zones locked out");
+        idle_flow_seen = true;
+        leak_zones = ZONE_ALL;
+        // Report it now rather than at the next epoch
+        check_sensors();
+    } else {
+        ESP_LOGE(TAG, "Flow with every zone closed continues");
+    }
+    flow_meter_set_idle(true);
 }
 
 static void start_watering(void)
@@ -131,15 +1318,29 @@ static void start_watering(void)
         return;
     }
     
+    // Every path that opens a zone ends here, resumed and manual cycles included
+    if (tank_touch_ready && tank_touch_low()) {
+        ESP_LOGW(TAG, "Tank below the electrode band, not starting zones 0x%" PRIx32, running_zones);
+        abort_zones(running_zones, false, hal_time_us());
+        return;
+    }
+    
     ESP_LOGI(TAG, "Starting watering cycle - Duration: %d minutes", WATERING_DURATION_MIN);
     
     // Turn on motor driver and light
-    gpio_set_level(MOTOR_DRIVER_PIN, 1);
-    gpio_set_level(LIGHT_PIN, 1);
+    hal_output_set(MOTOR_DRIVER_PIN, true);
+    hal_output_set(LIGHT_PIN, true);
     is_watering = true;
+    pump_on_us = hal_time_us();
+    pump_slept_us = 0;
+    pump_wakeups = 0;
     
-    // Start timer to stop watering
-    xTimerStart(watering_timer, 0);
+    // The budget kept the reserve at the last epoch, this holds it against what is pumped
+    tank_polled = (sensors_watch_tank(TANK_RESERVE_ML, control_queue) != ESP_OK);
+    if (tank_polled) {
+        timer_service_start(&tank_timer, pump_on_us + TANK_CHECK_S * 1000000LL,
+                            (control_event_t){ .type = CONTROL_EVENT_TANK_CHECK });
+    }
 }
 
 static void stop_watering(void)
@@ -152,29 +1353,14 @@ static void stop_watering(void)
     ESP_LOGI(TAG, "Stopping watering cycle");
     
     // Turn off motor driver and light
-    gpio_set_level(MOTOR_DRIVER_PIN, 0);
-    gpio_set_level(LIGHT_PIN, 0);
+    hal_output_set(MOTOR_DRIVER_PIN, false);
+    hal_output_set(LIGHT_PIN, false);
     is_watering = false;
+    sensors_unwatch_tank();
+    timer_service_cancel(&tank_timer);
     
-    // Reset the counter for next watering cycle
-    seconds_since_last_watering = 0;
-}
-
-static void watering_timer_callback(TimerHandle_t xTimer)
-{
-    stop_watering();
-    ESP_LOGI(TAG, "Watering cycle completed");
-}
-
-static void check_timer_callback(TimerHandle_t xTimer)
-{
-    if (!is_watering) {
-        seconds_since_last_watering++;
-        
-        // Check if it's time for the next watering cycle
-        if (seconds_since_last_watering * 1000 >= WATERING_INTERVAL_MS) {
-            ESP_LOGI(TAG, "Interval reached - Starting new watering cycle");
-            start_watering();
-        }
-    }
+    // CPU energy per cycle scales with the awake share, compare against PUMP_SLEEP_CHECK_S 0
+    int64_t on_us = hal_time_us() - pump_on_us;
+    ESP_LOGI(TAG, "Pump ran %lld s, CPU awake %lld ms, asleep %lld ms over %" PRIu32 " light sleeps",
+             on_us / 1000000, (on_us - pump_slept_us) / 1000, pump_slept_us / 1000, pump_wakeups);
 }
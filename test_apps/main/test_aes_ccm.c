@@ -0,0 +1,68 @@
+#include <string.h>
+#include "unity.h"
+#include "aes_ccm.h"
+#include "telemetry.h"
+
+// RFC 3610 packet vector #1
+static const uint8_t key[AES_CCM_KEY_BYTES] = {
+    0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB, 0xCC, 0xCD, 0xCE, 0xCF,
+};
+static const uint8_t nonce[AES_CCM_NONCE_BYTES] = {
+    0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5,
+};
+static const uint8_t sealed[23] = {
+    0x58, 0x8C, 0x97, 0x9A, 0x61, 0xC6, 0x63, 0xD2, 0xF0, 0x66, 0xD0, 0xC2,
+    0xC0, 0xF9, 0x89, 0x80, 0x6D, 0x5F, 0x6B, 0x61, 0xDA, 0xC3, 0x84,
+};
+static const uint8_t sealed_tag[AES_CCM_TAG_BYTES] = { 0x17, 0xE8, 0xD1, 0x2C, 0xFD, 0xF9, 0x26, 0xE0 };
+
+static aes_ccm_t ccm;
+
+TEST_CASE("AES-CCM matches RFC 3610", "[aes_ccm]")
+{
+    uint8_t aad[8], msg[23], out[23], back[23], tag[AES_CCM_TAG_BYTES];
+
+    for (int i = 0; i < 8; i++) {
+        aad[i] = (uint8_t)i;
+    }
+    for (int i = 0; i < 23; i++) {
+        msg[i] = (uint8_t)(8 + i);
+    }
+    aes_ccm_init(&ccm, key);
+    aes_ccm_seal(&ccm, nonce, aad, sizeof(aad), msg, sizeof(msg), out, tag);
+    TEST_ASSERT_EQUAL_MEMORY(sealed, out, sizeof(sealed));
+    TEST_ASSERT_EQUAL_MEMORY(sealed_tag, tag, sizeof(sealed_tag));
+
+    TEST_ASSERT_TRUE(aes_ccm_open(&ccm, nonce, aad, sizeof(aad), out, sizeof(out), back, tag));
+    TEST_ASSERT_EQUAL_MEMORY(msg, back, sizeof(msg));
+    tag[0] ^= 1;
+    TEST_ASSERT_FALSE(aes_ccm_open(&ccm, nonce, aad, sizeof(aad), out, sizeof(out), back, tag));
+}
+
+TEST_CASE("sealed datagrams open only in their direction and untampered", "[aes_ccm]")
+{
+    const uint8_t payload[] = "zone 3 watered 420 s";
+    uint8_t wire[sizeof(payload) + TELEMETRY_SEAL_OVERHEAD];
+    uint8_t back[sizeof(payload)];
+    uint32_t node;
+    uint64_t counter;
+
+    aes_ccm_init(&ccm, key);
+    size_t len = telemetry_seal(&ccm, 0x1234, 99, TELEMETRY_FROM_NODE, payload, sizeof(payload), wire, sizeof(wire));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(wire), len);
+    TEST_ASSERT_EQUAL_UINT32(0, telemetry_seal(&ccm, 0x1234, 99, TELEMETRY_FROM_NODE, payload, sizeof(payload), wire,
+                                               sizeof(wire) - 1));
+
+    TEST_ASSERT_EQUAL_INT(sizeof(payload),
+                          telemetry_open(&ccm, TELEMETRY_FROM_NODE, wire, len, back, sizeof(back), &node, &counter));
+    TEST_ASSERT_EQUAL_MEMORY(payload, back, sizeof(payload));
+    TEST_ASSERT_EQUAL_UINT32(0x1234, node);
+    TEST_ASSERT_EQUAL_UINT64(99, counter);
+
+    // The nonce carries the direction, so an echo back to the node does not open
+    TEST_ASSERT_EQUAL_INT(-1, telemetry_open(&ccm, TELEMETRY_FROM_GATEWAY, wire, len, back, sizeof(back), &node,
+                                             &counter));
+    wire[TELEMETRY_SEAL_HEADER_BYTES + 2] ^= 0x40;
+    TEST_ASSERT_EQUAL_INT(-1, telemetry_open(&ccm, TELEMETRY_FROM_NODE, wire, len, back, sizeof(back), &node,
+                                             &counter));
+}
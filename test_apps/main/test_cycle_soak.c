@@ -0,0 +1,50 @@
+#include "unity.h"
+#include "cycle_soak.h"
+
+TEST_CASE("a run longer than a pulse is split around soaks", "[cycle_soak]")
+{
+    const soak_zone_t zone = { .run_s = 500, .pulse_s = 200, .soak_s = 600 };
+    soak_pulse_t pulses[SOAK_MAX_PULSES];
+
+    TEST_ASSERT_EQUAL_INT(3, cycle_soak_plan(&zone, 1, pulses, SOAK_MAX_PULSES));
+    TEST_ASSERT_EQUAL_UINT32(0, pulses[0].start_s);
+    TEST_ASSERT_EQUAL_UINT32(200, pulses[0].length_s);
+    TEST_ASSERT_EQUAL_UINT32(800, pulses[1].start_s);
+    TEST_ASSERT_EQUAL_UINT32(1600, pulses[2].start_s);
+    TEST_ASSERT_EQUAL_UINT32(100, pulses[2].length_s);
+}
+
+TEST_CASE("one zone's pulse fills another's soak", "[cycle_soak]")
+{
+    const soak_zone_t zones[] = {
+        { .run_s = 400, .pulse_s = 200, .soak_s = 200 },
+        { .run_s = 300, .pulse_s = 200, .soak_s = 200 },
+        { .run_s = 0 },
+    };
+    soak_pulse_t pulses[SOAK_MAX_PULSES];
+    uint32_t run[3] = { 0 };
+    uint32_t pump_free = 0;
+
+    int n = cycle_soak_plan(zones, 3, pulses, SOAK_MAX_PULSES);
+    TEST_ASSERT_EQUAL_INT(4, n);
+    for (int i = 0; i < n; i++) {
+        // One pump: pulses never overlap and come in time order
+        TEST_ASSERT_GREATER_OR_EQUAL(pump_free, pulses[i].start_s);
+        TEST_ASSERT_LESS_OR_EQUAL(200, pulses[i].length_s);
+        pump_free = pulses[i].start_s + pulses[i].length_s;
+        run[pulses[i].zone] += pulses[i].length_s;
+    }
+    TEST_ASSERT_EQUAL_UINT32(400, run[0]);
+    TEST_ASSERT_EQUAL_UINT32(300, run[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, run[2]);
+    // Interleaved, the pump never waits
+    TEST_ASSERT_EQUAL_UINT32(700, pump_free);
+}
+
+TEST_CASE("too many pulses for the table fail", "[cycle_soak]")
+{
+    const soak_zone_t zone = { .run_s = 1000, .pulse_s = 10, .soak_s = 10 };
+    soak_pulse_t pulses[SOAK_MAX_PULSES];
+
+    TEST_ASSERT_EQUAL_INT(-1, cycle_soak_plan(&zone, 1, pulses, SOAK_MAX_PULSES));
+}
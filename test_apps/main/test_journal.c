@@ -0,0 +1,47 @@
+#include <string.h>
+#include "unity.h"
+#include "journal.h"
+
+#define S_US                     1000000LL
+
+static journal_t journal;
+
+TEST_CASE("an interrupted cycle owes what was not delivered", "[journal]")
+{
+    journal_reset(&journal);
+    TEST_ASSERT_TRUE(journal_valid(&journal));
+
+    journal_intent(&journal, 1, 600);
+    TEST_ASSERT_EQUAL_UINT32(600, journal_remaining_s(&journal, 1));
+    journal_pulse_start(&journal, 1, 100 * S_US);
+    journal_checkpoint(&journal, 1U << 1, 250 * S_US);
+    TEST_ASSERT_EQUAL_UINT32(150, journal_delivered_s(&journal, 1));
+    journal_pulse_stop(&journal, 1, 300 * S_US);
+    TEST_ASSERT_EQUAL_UINT32(400, journal_remaining_s(&journal, 1));
+
+    // A second pulse carries on from what the first delivered
+    journal_pulse_start(&journal, 1, 1000 * S_US);
+    journal_checkpoint(&journal, 0xFF, 1100 * S_US);
+    TEST_ASSERT_EQUAL_UINT32(300, journal_remaining_s(&journal, 1));
+
+    journal_done(&journal, 1);
+    TEST_ASSERT_EQUAL_UINT32(0, journal_remaining_s(&journal, 1));
+}
+
+TEST_CASE("pulses outside a cycle are not journaled", "[journal]")
+{
+    journal_reset(&journal);
+    journal_pulse_start(&journal, 0, 0);
+    journal_pulse_stop(&journal, 0, 100 * S_US);
+    TEST_ASSERT_EQUAL_UINT32(0, journal_remaining_s(&journal, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, journal_delivered_s(&journal, 0));
+}
+
+TEST_CASE("power-on garbage is not a journal", "[journal]")
+{
+    memset(&journal, 0xA5, sizeof(journal));
+    TEST_ASSERT_FALSE(journal_valid(&journal));
+    journal_reset(&journal);
+    journal.zone[3].state = JOURNAL_PAUSED + 1;
+    TEST_ASSERT_FALSE(journal_valid(&journal));
+}
@@ -0,0 +1,72 @@
+#include "unity.h"
+#include "leak_detect.h"
+
+#define FLOW_ML_PER_MIN          2000
+
+static leak_baseline_t baseline;
+static leak_detector_t det;
+
+static void learn_zone(int zone)
+{
+    leak_detect_begin(&det, &baseline, 1U << zone);
+    for (int i = 0; i < LEAK_SETTLE_SAMPLES + LEAK_LEARN_SAMPLES; i++) {
+        TEST_ASSERT_EQUAL_INT(LEAK_LEARNING, leak_detect_sample(&det, FLOW_ML_PER_MIN));
+    }
+}
+
+TEST_CASE("a zone is learned before it is judged", "[leak_detect]")
+{
+    baseline = (leak_baseline_t){ 0 };
+    learn_zone(0);
+    TEST_ASSERT_EQUAL_UINT32(FLOW_ML_PER_MIN, leak_detect_expected(&det));
+    TEST_ASSERT_EQUAL_INT(LEAK_OK, leak_detect_sample(&det, FLOW_ML_PER_MIN + 50));
+
+    // Zone 1 still learning, so the pair has no expected flow yet
+    leak_detect_begin(&det, &baseline, 0x3);
+    TEST_ASSERT_EQUAL_UINT32(0, leak_detect_expected(&det));
+}
+
+TEST_CASE("sustained high and low flow raise their alarms", "[leak_detect]")
+{
+    leak_status_t status = LEAK_OK;
+    int samples;
+
+    baseline = (leak_baseline_t){ 0 };
+    learn_zone(2);
+
+    leak_detect_begin(&det, &baseline, 1U << 2);
+    for (samples = 0; samples < 20 && status != LEAK_BURST; samples++) {
+        status = leak_detect_sample(&det, 2 * FLOW_ML_PER_MIN);
+    }
+    TEST_ASSERT_EQUAL_INT(LEAK_BURST, status);
+    // Settling, then a few samples of double flow, not the whole window
+    TEST_ASSERT_LESS_OR_EQUAL(LEAK_SETTLE_SAMPLES + 3, samples);
+
+    status = LEAK_OK;
+    leak_detect_begin(&det, &baseline, 1U << 2);
+    for (samples = 0; samples < 20 && status != LEAK_LOW_FLOW; samples++) {
+        status = leak_detect_sample(&det, FLOW_ML_PER_MIN / 4);
+    }
+    TEST_ASSERT_EQUAL_INT(LEAK_LOW_FLOW, status);
+    // The baseline did not learn the fault
+    TEST_ASSERT_EQUAL_UINT32(FLOW_ML_PER_MIN, leak_detect_expected(&det));
+}
+
+TEST_CASE("a zone that never runs alone is reported unlearned", "[leak_detect]")
+{
+    baseline = (leak_baseline_t){ 0 };
+    learn_zone(0);
+
+    for (int run = 0; run < LEAK_UNLEARNED_RUNS; run++) {
+        TEST_ASSERT_EQUAL_UINT32(0, leak_detect_unlearned(&baseline));
+        leak_detect_begin(&det, &baseline, 0x3);
+        for (int i = 0; i < LEAK_SETTLE_SAMPLES + LEAK_LEARN_SAMPLES; i++) {
+            leak_detect_sample(&det, 2 * FLOW_ML_PER_MIN);
+        }
+    }
+    // Zone 0 learned alone earlier, zone 1 has only ever shared its runs
+    TEST_ASSERT_EQUAL_UINT32(0x2, leak_detect_unlearned(&baseline));
+
+    learn_zone(1);
+    TEST_ASSERT_EQUAL_UINT32(0, leak_detect_unlearned(&baseline));
+}
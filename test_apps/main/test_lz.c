@@ -0,0 +1,64 @@
+#include <string.h>
+#include "unity.h"
+#include "lz.h"
+
+#define INPUT_BYTES              1024
+
+static lz_encoder_t encoder;
+static uint8_t input[INPUT_BYTES];
+static uint8_t packed[INPUT_BYTES * 2];
+static uint8_t unpacked[INPUT_BYTES];
+
+// Streamed in uneven chunks, as frames come out of flash
+static size_t pack(size_t len)
+{
+    lz_encoder_start(&encoder, packed, sizeof(packed));
+    for (size_t at = 0; at < len; at += 37) {
+        size_t n = (len - at < 37) ? len - at : 37;
+        TEST_ASSERT_TRUE(lz_encoder_fits(&encoder, n));
+        lz_encoder_write(&encoder, input + at, n);
+    }
+    return lz_encoder_finish(&encoder);
+}
+
+TEST_CASE("repeated frames round trip and shrink", "[lz]")
+{
+    size_t out_len;
+
+    // Telemetry frames differ in a few bytes from one to the next
+    for (int i = 0; i < INPUT_BYTES; i++) {
+        input[i] = (i % 24 < 20) ? (uint8_t)(i % 24) : (uint8_t)(i / 24);
+    }
+    size_t len = pack(INPUT_BYTES);
+
+    TEST_ASSERT_LESS_OR_EQUAL(INPUT_BYTES / 2, len);
+    TEST_ASSERT_TRUE(lz_decode(packed, len, unpacked, sizeof(unpacked), &out_len));
+    TEST_ASSERT_EQUAL_UINT32(INPUT_BYTES, out_len);
+    TEST_ASSERT_EQUAL_MEMORY(input, unpacked, INPUT_BYTES);
+}
+
+TEST_CASE("noise round trips at no more than 9 bits a byte", "[lz]")
+{
+    uint32_t seed = 7;
+    size_t out_len;
+
+    for (int i = 0; i < INPUT_BYTES; i++) {
+        seed = seed * 1103515245 + 12345;
+        input[i] = (uint8_t)(seed >> 16);
+    }
+    size_t len = pack(INPUT_BYTES);
+
+    TEST_ASSERT_LESS_OR_EQUAL((INPUT_BYTES * 9 + 7) / 8, len);
+    TEST_ASSERT_TRUE(lz_decode(packed, len, unpacked, sizeof(unpacked), &out_len));
+    TEST_ASSERT_EQUAL_UINT32(INPUT_BYTES, out_len);
+    TEST_ASSERT_EQUAL_MEMORY(input, unpacked, INPUT_BYTES);
+}
+
+TEST_CASE("a stream that does not fit is refused", "[lz]")
+{
+    size_t out_len;
+
+    memset(input, 'x', INPUT_BYTES);
+    size_t len = pack(INPUT_BYTES);
+    TEST_ASSERT_FALSE(lz_decode(packed, len, unpacked, INPUT_BYTES - 1, &out_len));
+}
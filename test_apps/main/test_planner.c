@@ -0,0 +1,145 @@
+#include "unity.h"
+#include "planner.h"
+
+#define MIN_US                   (60 * 1000000LL)
+#define HOUR_US                  (60 * MIN_US)
+#define DAY_US                   (24 * HOUR_US)
+
+static plan_t plan;
+
+// Pop everything due at now_us the way run_due_events does, returning the count
+static int pop_due(int64_t now_us, uint32_t *starts)
+{
+    plan_event_t ev;
+    int popped = 0;
+
+    while (planner_pop_due(&plan, now_us, &ev)) {
+        if (ev.type == PLAN_EVENT_START) {
+            starts[ev.zone]++;
+        }
+        popped++;
+    }
+    return popped;
+}
+
+TEST_CASE("cycles follow the zone rules", "[planner]")
+{
+    const zone_rule_t rules[] = {
+        { .enabled = true, .interval_s = 6 * 60 * 60, .duration_s = 10 * 60, .offset_s = 0 },
+        { .enabled = true, .interval_s = 8 * 60 * 60, .duration_s = 5 * 60, .offset_s = 60 * 60 },
+        { .enabled = false, .interval_s = 60 * 60, .duration_s = 60 },
+    };
+    int64_t now_us = 1000 * 1000000LL;
+
+    planner_invalidate(&plan);
+    TEST_ASSERT_TRUE(planner_needs_build(&plan, now_us));
+    planner_build(&plan, rules, 3, now_us);
+
+    // Four cycles of zone 0 and three of zone 1 in the day, a start and a stop each
+    TEST_ASSERT_EQUAL_INT(14, plan.count);
+    TEST_ASSERT_EQUAL_INT64(now_us + DAY_US, plan.end_us);
+    for (int i = 1; i < plan.count; i++) {
+        TEST_ASSERT_LESS_OR_EQUAL_INT64(plan.events[i].at_us, plan.events[i - 1].at_us);
+        TEST_ASSERT(plan.events[i].zone != 2);
+    }
+    TEST_ASSERT_EQUAL_INT64(now_us, planner_next_start_us(&plan));
+    TEST_ASSERT_EQUAL_INT64(now_us + 10 * MIN_US, planner_next_stop_us(&plan, 0));
+    TEST_ASSERT_EQUAL_INT64(now_us + HOUR_US + 5 * MIN_US, planner_next_stop_us(&plan, 1));
+    TEST_ASSERT_EQUAL_INT64(INT64_MAX, planner_next_stop_us(&plan, 2));
+}
+
+TEST_CASE("stops sort before starts at the same instant", "[planner]")
+{
+    const zone_rule_t rule = { .enabled = true, .interval_s = 60 * 60, .duration_s = 60 * 60 };
+    plan_event_t ev;
+
+    planner_invalidate(&plan);
+    planner_build(&plan, &rule, 1, 0);
+
+    TEST_ASSERT_TRUE(planner_pop_due(&plan, 0, &ev));
+    TEST_ASSERT_EQUAL_INT(PLAN_EVENT_START, ev.type);
+    TEST_ASSERT_FALSE(planner_pop_due(&plan, HOUR_US - 1, &ev));
+    TEST_ASSERT_TRUE(planner_pop_due(&plan, HOUR_US, &ev));
+    TEST_ASSERT_EQUAL_INT(PLAN_EVENT_STOP, ev.type);
+    TEST_ASSERT_TRUE(planner_pop_due(&plan, HOUR_US, &ev));
+    TEST_ASSERT_EQUAL_INT(PLAN_EVENT_START, ev.type);
+}
+
+TEST_CASE("a late rebuild keeps the running cycle and drops ended ones", "[planner]")
+{
+    const zone_rule_t rule = { .enabled = true, .interval_s = 60 * 60, .duration_s = 20 * 60 };
+    uint32_t starts[1] = { 0 };
+
+    planner_invalidate(&plan);
+    planner_build(&plan, &rule, 1, 0);
+    pop_due(DAY_US, starts);
+    TEST_ASSERT_EQUAL_UINT32(24, starts[0]);
+
+    // Woken 2 h 10 min past the window: the 24 h and 25 h cycles are over, the 26 h
+    // one runs until 26 h 20 min
+    int64_t now_us = DAY_US + 2 * HOUR_US + 10 * MIN_US;
+    TEST_ASSERT_TRUE(planner_needs_build(&plan, now_us));
+    planner_build(&plan, &rule, 1, now_us);
+
+    const plan_event_t *ev = planner_peek(&plan);
+    TEST_ASSERT_NOT_NULL(ev);
+    TEST_ASSERT_EQUAL_INT(PLAN_EVENT_START, ev->type);
+    TEST_ASSERT_EQUAL_INT64(DAY_US + 2 * HOUR_US, ev->at_us);
+    TEST_ASSERT_EQUAL_INT64(DAY_US + 2 * HOUR_US + 20 * MIN_US, planner_next_stop_us(&plan, 0));
+    TEST_ASSERT_EQUAL_INT64(now_us + DAY_US, plan.end_us);
+}
+
+TEST_CASE("skipping a cycle drops its start and stop only", "[planner]")
+{
+    const zone_rule_t rules[] = {
+        { .enabled = true, .interval_s = 6 * 60 * 60, .duration_s = 10 * 60 },
+        { .enabled = true, .interval_s = 6 * 60 * 60, .duration_s = 10 * 60 },
+    };
+    plan_event_t ev;
+
+    planner_invalidate(&plan);
+    planner_build(&plan, rules, 2, 0);
+    int count = plan.count;
+
+    TEST_ASSERT_TRUE(planner_pop_due(&plan, 0, &ev));
+    TEST_ASSERT_TRUE(planner_replace_cycles(&plan, 1U << ev.zone, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(count - 1, plan.count);
+    TEST_ASSERT_EQUAL_INT64(6 * HOUR_US + 10 * MIN_US, planner_next_stop_us(&plan, ev.zone));
+
+    TEST_ASSERT_TRUE(planner_trim_cycle(&plan, 1 - ev.zone, 5 * MIN_US));
+    TEST_ASSERT_EQUAL_INT64(5 * MIN_US, planner_next_stop_us(&plan, 1 - ev.zone));
+}
+
+// Every wakeup costs a light sleep exit, so the controller may only wake for plan
+// events and once per window to compile the next one
+TEST_CASE("a week of plan wakeups all have events to pop", "[planner][power]")
+{
+    const zone_rule_t rules[] = {
+        { .enabled = true, .interval_s = 6 * 60 * 60, .duration_s = 10 * 60 },
+        { .enabled = true, .interval_s = 8 * 60 * 60, .duration_s = 15 * 60, .offset_s = 30 * 60 },
+        { .enabled = true, .interval_s = 7 * 60 * 60, .duration_s = 20 * 60, .offset_s = 7 * 60 },
+    };
+    const int days = 7;
+    uint32_t starts[3] = { 0 };
+    int wakeups = 0, idle = 0;
+    int64_t now_us = 0;
+
+    planner_invalidate(&plan);
+    while (now_us < days * DAY_US) {
+        if (planner_needs_build(&plan, now_us)) {
+            planner_build(&plan, rules, 3, now_us);
+        }
+        if (pop_due(now_us, starts) == 0) {
+            idle++;
+        }
+        wakeups++;
+        now_us = planner_next_wake_us(&plan);
+    }
+
+    // Window boundaries neither drop nor repeat a cycle
+    TEST_ASSERT_EQUAL_UINT32(days * 4, starts[0]);
+    TEST_ASSERT_EQUAL_UINT32(days * 3, starts[1]);
+    TEST_ASSERT_EQUAL_UINT32(days * 24 / 7, starts[2]);
+    TEST_ASSERT_LESS_OR_EQUAL(days, idle);
+    TEST_ASSERT_LESS_OR_EQUAL(2 * (days * 4 + days * 3 + days * 24 / 7) + days, wakeups);
+}
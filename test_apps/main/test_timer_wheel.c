@@ -0,0 +1,104 @@
+#include "unity.h"
+#include "timer_wheel.h"
+
+#define TIMER_COUNT              200
+#define TICKS_PER_HOUR           (60 * 60 * 100)  // 10 ms ticks, as on target
+
+static timer_wheel_t wheel;
+static wheel_timer_t timers[TIMER_COUNT];
+static uint32_t fired;
+static uint32_t wrong_tick;
+
+static void on_expire(wheel_timer_t *timer, void *ctx)
+{
+    timer_wheel_t *w = ctx;
+
+    if (w->now != timer->expires) {
+        wrong_tick++;
+    }
+    fired++;
+}
+
+static void reset(uint64_t now_tick)
+{
+    timer_wheel_init(&wheel, now_tick, on_expire, &wheel);
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        timers[i] = (wheel_timer_t){ .event = i };
+    }
+    fired = 0;
+    wrong_tick = 0;
+}
+
+// Jump straight to the next expiry the way the one-shot does, counting the jumps
+static uint32_t drain(void)
+{
+    uint32_t wakeups = 0;
+    uint64_t tick;
+
+    while ((tick = timer_wheel_next_tick(&wheel)) != WHEEL_NEVER) {
+        timer_wheel_advance(&wheel, tick);
+        wakeups++;
+    }
+    return wakeups;
+}
+
+TEST_CASE("timers fire on their tick and cancelled ones never", "[timer_wheel]")
+{
+    uint32_t seed = 1;
+
+    reset(12345);
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        seed = seed * 1103515245 + 12345;
+        timer_wheel_add(&wheel, &timers[i], wheel.now + (seed >> 8) % (48 * TICKS_PER_HOUR));
+    }
+    for (int i = 0; i < TIMER_COUNT; i += 4) {
+        timer_wheel_cancel(&wheel, &timers[i]);
+    }
+    // Cancelling one that already fired or was never added is harmless
+    timer_wheel_cancel(&wheel, &timers[0]);
+    drain();
+
+    TEST_ASSERT_EQUAL_UINT32(TIMER_COUNT - TIMER_COUNT / 4, fired);
+    TEST_ASSERT_EQUAL_UINT32(0, wrong_tick);
+    TEST_ASSERT_EQUAL_UINT32(0, wheel.pending);
+}
+
+TEST_CASE("a timer in the past fires on the next advance", "[timer_wheel]")
+{
+    reset(1000);
+    timer_wheel_add(&wheel, &timers[0], 10);
+    TEST_ASSERT_EQUAL_UINT64(1000, timer_wheel_next_tick(&wheel));
+    TEST_ASSERT_EQUAL_UINT32(1, timer_wheel_advance(&wheel, 1000));
+    TEST_ASSERT_EQUAL_UINT64(WHEEL_NEVER, timer_wheel_next_tick(&wheel));
+}
+
+// Each expiry is a hardware one-shot, so within the first level every wakeup must
+// dispatch something
+TEST_CASE("no wakeups between expiries in the first level", "[timer_wheel][power]")
+{
+    const uint64_t at[] = { 3, 3, 7, 20, 20, 20, 41, 63 };
+    const uint32_t distinct = 5;
+
+    reset(0);
+    for (int i = 0; i < (int)(sizeof(at) / sizeof(at[0])); i++) {
+        timer_wheel_add(&wheel, &timers[i], at[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(distinct, drain());
+    TEST_ASSERT_EQUAL_UINT32(sizeof(at) / sizeof(at[0]), fired);
+}
+
+// A timer further out is moved down a level at a time, one wakeup per level it
+// starts above the first. More than that is a power regression.
+TEST_CASE("a timer costs at most one wakeup per level", "[timer_wheel][power]")
+{
+    const uint64_t delta[] = { 100, 3000, 6 * TICKS_PER_HOUR, 30 * 24 * TICKS_PER_HOUR };
+
+    for (int i = 0; i < (int)(sizeof(delta) / sizeof(delta[0])); i++) {
+        reset(777);
+        timer_wheel_add(&wheel, &timers[0], wheel.now + delta[i]);
+        uint32_t levels = (63 - __builtin_clzll(delta[i])) / WHEEL_LEVEL_BITS;
+        TEST_ASSERT_LESS_OR_EQUAL(levels + 1, drain());
+        TEST_ASSERT_EQUAL_UINT32(1, fired);
+        TEST_ASSERT_EQUAL_UINT32(0, wrong_tick);
+    }
+}
@@ -0,0 +1,45 @@
+#include "unity.h"
+#include "water_budget.h"
+
+static budget_workspace_t ws;
+
+TEST_CASE("demand scales from dry to target moisture", "[water_budget]")
+{
+    TEST_ASSERT_EQUAL_UINT32(0, water_budget_demand_ml(40, 40, 10, 1000));
+    TEST_ASSERT_EQUAL_UINT32(0, water_budget_demand_ml(60, 40, 10, 1000));
+    TEST_ASSERT_EQUAL_UINT32(1000, water_budget_demand_ml(5, 40, 10, 1000));
+    TEST_ASSERT_EQUAL_UINT32(500, water_budget_demand_ml(25, 40, 10, 1000));
+    // A target at or below dry makes no sense, so it asks for nothing
+    TEST_ASSERT_EQUAL_UINT32(0, water_budget_demand_ml(5, 10, 10, 1000));
+}
+
+TEST_CASE("every zone gets its demand when the tank covers it", "[water_budget]")
+{
+    const budget_zone_t zones[] = {
+        { .demand_ml = 700, .priority = 1 },
+        { .demand_ml = 300, .min_ml = 200, .priority = 0 },
+    };
+    uint32_t alloc[2];
+
+    TEST_ASSERT_EQUAL_UINT32(1000, water_budget_solve(zones, 2, 1000, alloc, &ws));
+    TEST_ASSERT_EQUAL_UINT32(700, alloc[0]);
+    TEST_ASSERT_EQUAL_UINT32(300, alloc[1]);
+}
+
+TEST_CASE("a short tank goes to priority and never below a minimum dose", "[water_budget]")
+{
+    const budget_zone_t zones[] = {
+        { .demand_ml = 1000, .priority = 1 },
+        { .demand_ml = 1000, .priority = 3 },
+        { .demand_ml = 800, .min_ml = 600, .priority = 2 },
+    };
+    uint32_t alloc[3];
+
+    uint32_t total = water_budget_solve(zones, 3, 1200, alloc, &ws);
+
+    TEST_ASSERT_LESS_OR_EQUAL(1200, total);
+    TEST_ASSERT_EQUAL_UINT32(alloc[0] + alloc[1] + alloc[2], total);
+    TEST_ASSERT_GREATER_OR_EQUAL(alloc[0], alloc[1]);
+    TEST_ASSERT(alloc[2] == 0 || alloc[2] >= 600);
+    TEST_ASSERT_EQUAL_UINT32(0, water_budget_solve(zones, 3, 0, alloc, &ws));
+}
@@ -0,0 +1,21 @@
+# Runs every Unity case in the test app on a board, or on the ESP32 in QEMU:
+#   idf.py -C test_apps set-target esp32 build
+#   pytest test_apps --target esp32 --embedded-services esp,idf -m "not qemu"
+#   pytest test_apps --target esp32 --embedded-services idf,qemu -m qemu
+import pytest
+from pytest_embedded import Dut
+
+
+@pytest.mark.esp32
+@pytest.mark.esp32s3
+@pytest.mark.esp32c6
+@pytest.mark.generic
+def test_unit(dut: Dut) -> None:
+    dut.run_all_single_board_cases()
+
+
+@pytest.mark.esp32
+@pytest.mark.qemu
+@pytest.mark.host_test
+def test_unit_qemu(dut: Dut) -> None:
+    dut.run_all_single_board_cases()